@@ -24,6 +24,7 @@
 
 #define USE_TYPED_RSET    // Shut up about rset already!
 #include "adsAsynPortDriver.h"
+#include "adsAsynPortDriverTrace.h"
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -32,7 +33,11 @@
 #include <stdio.h>
 #include <errno.h>
 #include <math.h>
+#include <algorithm>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 #include <epicsTypes.h>
 #include <epicsTime.h>
@@ -48,10 +53,17 @@
 #include <alarm.h>
 
 static const char *driverName="adsAsynPortDriver";
-static adsAsynPortDriver *adsAsynPortObj;
+static adsAsynPortDriver *adsAsynPortObj;  //Last configured driver (iocsh commands)
+static adsAsynPortDriver *adsAsynPortObjs[ADS_MAX_DRIVERS];  //All drivers, index in hUser of ADS notifications
+static int adsAsynPortObjCount=0;
+static int initHookRegistered=0;
 static long oldTimeStamp=0;
 static struct timeval oldTime={0};
 static int allowCallbackEpicsState=0;
+// Trace one event per callback. Off in the bulk read thread: one event per
+// sum read (and one per failed element) so that the trace ring is not
+// overwritten by the elements of one cycle.
+static thread_local bool traceCallbacks=true;
 static initHookState currentEpicsState=initHookAtIocBuild;
 
 
@@ -82,17 +94,21 @@ static void getEpicsState(initHookState state)
         gettimeofday(&now, NULL);
         timersub(&now, &start, &diff);
         printf("Database initialization took %ld.%05ld seconds.\n", diff.tv_sec, (long)diff.tv_usec);
+        //Params found in the symbol cache (or created before connection) are resolved in batches here
+        for(int i=0;i<adsAsynPortObjCount;i++){
+          adsAsynPortObjs[i]->refreshParamsLock(0);
+          adsAsynPortObjs[i]->bulkOK = 0;  //Bulk reads start after scan init
+          adsAsynPortObjs[i]->writeSymbolCacheLock();
+        }
         break;
     case initHookAfterScanInit:
       allowCallbackEpicsState=1;
 
       //make all callbacks if data arrived from callback before interrupts were registered (before allowCallbackEpicsState==1)
-      if(!adsAsynPortObj){
-        printf("%s:%s: ERROR: adsAsynPortObj==NULL\n", driverName, functionName);
-        return;
+      for(int i=0;i<adsAsynPortObjCount;i++){
+        adsAsynPortObjs[i]->fireAllCallbacksLock();
+        adsAsynPortObjs[i]->bulkOK = 1;
       }
-      adsAsynPortObj->fireAllCallbacksLock();
-      adsAsynPortObj->bulkOK = 1;
       printf("Begin polling PLC!\n");
       break;
     default:
@@ -108,9 +124,26 @@ static void getEpicsState(initHookState state)
  */
 int initHook(void)
 {
+  if(initHookRegistered){  //Once for all drivers
+    return 0;
+  }
+  initHookRegistered=1;
   return(initHookRegister(getEpicsState));
 }
 
+/** Get driver from hUser of an ADS notification.
+ * \param[in] hUser Driver index (upper 8 bits) and index.
+ * \return driver or NULL.
+ */
+static adsAsynPortDriver *getDriverFromHUser(uint32_t hUser)
+{
+  uint32_t driverIndex=ADS_HUSER_DRIVER(hUser);
+  if(driverIndex>=(uint32_t)adsAsynPortObjCount){
+    return NULL;
+  }
+  return adsAsynPortObjs[driverIndex];
+}
+
 /** Callback from ads lib for symbols changed in PLC.
  * \param[in] pAddr AmsAddr of the system generating the callback.
  * \param[in] pNotification Data structure containing the updated data and timestamp information.
@@ -122,16 +155,39 @@ static void adsSymbolsChangedCallback(const AmsAddr* pAddr, const AdsNotificatio
 {
   const char* functionName = "adsSymbolsChangedCallback";
 
-  if(!adsAsynPortObj){
-    printf("%s:%s: ERROR: adsAsynPortObj==NULL\n", driverName, functionName);
+  adsAsynPortDriver *driver=getDriverFromHUser(hUser);
+  if(!driver){
+    printf("%s:%s: ERROR: No driver for hUser 0x%x\n", driverName, functionName,hUser);
     return;
   }
 
-  asynUser *asynTraceUser=adsAsynPortObj->getTraceAsynUser();
+  asynUser *asynTraceUser=driver->getTraceAsynUser();
   asynPrint(asynTraceUser, ASYN_TRACE_INFO , "%s:%s: Symbols changed for Ams-port %u.\n", driverName, functionName,pAddr->port);
 
-  adsAsynPortObj->invalidateParamsLock(pAddr->port);
-  adsAsynPortObj->refreshParamsLock(pAddr->port);
+  driver->refreshChangedParamsLock(pAddr->port);
+}
+
+/** Callback from ads lib for changed ads state of an ams port.
+ * \param[in] pAddr AmsAddr of the system generating the callback.
+ * \param[in] pNotification Data structure containing the ads state.
+ * \param[in] hUser Driver index and ams port.
+ * \return void
+ */
+static void adsStateCallback(const AmsAddr* pAddr, const AdsNotificationHeader* pNotification, uint32_t hUser)
+{
+  const char* functionName = "adsStateCallback";
+
+  adsAsynPortDriver *driver=getDriverFromHUser(hUser);
+  if(!driver){
+    printf("%s:%s: ERROR: No driver for hUser 0x%x\n", driverName, functionName,hUser);
+    return;
+  }
+  if(pNotification->cbSampleSize<sizeof(uint16_t)){
+    return;
+  }
+  uint16_t adsState=0;
+  memcpy(&adsState,pNotification+1,sizeof(adsState));
+  driver->adsStateNotify((uint16_t)ADS_HUSER_INDEX(hUser),adsState);
 }
 
 /** Callback from ads lib for updated data.
@@ -145,55 +201,78 @@ static void adsDataCallback(const AmsAddr* pAddr, const AdsNotificationHeader* p
 {
   const char* functionName = "adsDataCallback";
 
-  if(!adsAsynPortObj){
-    printf("%s:%s: ERROR: adsAsynPortObj==NULL\n", driverName, functionName);
+  adsAsynPortDriver *driver=getDriverFromHUser(hUser);
+  if(!driver){
+    printf("%s:%s: ERROR: No driver for hUser 0x%x\n", driverName, functionName,hUser);
     return;
   }
+  uint32_t paramIndex=ADS_HUSER_INDEX(hUser);
 
-  asynUser *asynTraceUser=adsAsynPortObj->getTraceAsynUser();
-  asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER , "%s:%s:\n", driverName, functionName);
-
+  asynUser *asynTraceUser=driver->getTraceAsynUser();
   const uint8_t* data = reinterpret_cast<const uint8_t*>(pNotification + 1);
-  struct timeval newTime;
-  gettimeofday(&newTime, NULL);
-
-  asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"TIME %ld.%06ld\n",(long) newTime.tv_sec, (long) newTime.tv_usec);
-
-  long secs_used=(newTime.tv_sec - oldTime.tv_sec); //avoid overflow by subtracting first
-  long micros_used= ((secs_used*1000000) + newTime.tv_usec) - (oldTime.tv_usec);
-  oldTime=newTime;
+  adsTrace(ADS_TRACE_NOTIFICATION,driver->getDriverIndex(),(int32_t)paramIndex,pNotification->cbSampleSize,0,pNotification->nTimeStamp);
 
   //Ensure hUser is within range
-  if(hUser>(uint32_t)(adsAsynPortObj->getParamTableSize()-1)){
-    asynPrint(asynTraceUser, ASYN_TRACE_ERROR, "%s:%s: hUser out of range: %u.\n", driverName, functionName,hUser);
+  if(paramIndex>(uint32_t)(driver->getParamTableSize()-1)){
+    asynPrint(asynTraceUser, ASYN_TRACE_ERROR, "%s:%s: hUser out of range: 0x%x.\n", driverName, functionName,hUser);
     return;
   }
 
-  //Get paramInfo
-  adsParamInfo *paramInfo=adsAsynPortObj->getAdsParamInfo(hUser);
-  if(!paramInfo){
-    asynPrint(asynTraceUser, ASYN_TRACE_ERROR, "%s:%s: getAdsParamInfo() for hUser %u failed\n", driverName, functionName,hUser);
+  //Get hot parameter data (metadata in hot->info only needed for diagnostics)
+  adsParamHot *hot=driver->getAdsParamHot(paramIndex);
+  if(!hot){
+    asynPrint(asynTraceUser, ASYN_TRACE_ERROR, "%s:%s: getAdsParamHot() for hUser 0x%x failed\n", driverName, functionName,hUser);
     return;
   }
 
-  asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"Callback for parameter %s (%d).\n",paramInfo->drvInfo,paramInfo->paramIndex);
-  asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"hUser 0x%x, data size[b]: %d.\n", hUser,pNotification->cbSampleSize);
-  asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"time stamp [100ns]: %" PRIuMAX ", since last plc [ms]: %4.2lf, since last ioc [ms]: %4.2lf.\n",
-            (uintmax_t)pNotification->nTimeStamp,
-            ((double)(pNotification->nTimeStamp-oldTimeStamp))/10000.0,
-            (((double)(micros_used))/1000.0));
-  oldTimeStamp=pNotification->nTimeStamp;
+  // Verbose trace only when enabled (adsTraceDump shows the always-on binary trace)
+  if(pasynTrace->getTraceMask(asynTraceUser) & ASYN_TRACEIO_DRIVER){
+    struct timeval newTime;
+    gettimeofday(&newTime, NULL);
+    long secs_used=(newTime.tv_sec - oldTime.tv_sec); //avoid overflow by subtracting first
+    long micros_used= ((secs_used*1000000) + newTime.tv_usec) - (oldTime.tv_usec);
+    oldTime=newTime;
+    asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"%s:%s: TIME %ld.%06ld\n", driverName, functionName,(long) newTime.tv_sec, (long) newTime.tv_usec);
+    asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"Callback for parameter %s (%d).\n",hot->info->drvInfo,hot->paramIndex);
+    asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"hUser 0x%x, data size[b]: %d.\n", hUser,pNotification->cbSampleSize);
+    asynPrint(asynTraceUser, ASYN_TRACEIO_DRIVER,"time stamp [100ns]: %" PRIuMAX ", since last plc [ms]: %4.2lf, since last ioc [ms]: %4.2lf.\n",
+              (uintmax_t)pNotification->nTimeStamp,
+              ((double)(pNotification->nTimeStamp-oldTimeStamp))/10000.0,
+              (((double)(micros_used))/1000.0));
+    oldTimeStamp=pNotification->nTimeStamp;
+  }
 
   //Ensure hUser is equal to parameter index
-  if(hUser!=(uint32_t)(paramInfo->paramIndex)){
-    asynPrint(asynTraceUser, ASYN_TRACE_ERROR, "%s:%s: hUser not equal to parameter index (%u vs %d).\n", driverName, functionName,hUser,paramInfo->paramIndex);
+  if(paramIndex!=(uint32_t)(hot->paramIndex)){
+    asynPrint(asynTraceUser, ASYN_TRACE_ERROR, "%s:%s: hUser not equal to parameter index (%u vs %d).\n", driverName, functionName,paramIndex,hot->paramIndex);
     return;
   }
 
-  paramInfo->plcTimeStampRaw=pNotification->nTimeStamp;
-  paramInfo->lastCallbackSize=pNotification->cbSampleSize;
+  // Samples of one notification frame share the same time stamp: convert once
+  static thread_local uint64_t lastPlcTime=0;
+  static thread_local epicsTimeStamp lastPlcTimeStamp;
+  if(pNotification->nTimeStamp!=lastPlcTime){
+    windowsToEpicsTimeStamp(pNotification->nTimeStamp,&lastPlcTimeStamp);
+    lastPlcTime=pNotification->nTimeStamp;
+  }
+  // One IOC time per notification for the clock model and the statistics
+  int64_t hostNs=adsClockHostNs();
+  adsSetParamPlcTime(hot,pNotification->nTimeStamp,&lastPlcTimeStamp);
+  adsClockModelAddSample(driver->getClockModel(),pNotification->nTimeStamp,hostNs,false);
+  hot->lastCallbackSize=pNotification->cbSampleSize;
+  adsParamStatsUpdate(hot->stats,ADS_PATH_NOTIFICATION,pNotification->cbSampleSize,(uint64_t)(hostNs/1000));
+
+  driver->adsUpdateParameterLock(hot,data,hot->lastCallbackSize);
+}
 
-  adsAsynPortObj->adsUpdateParameterLock(paramInfo,data);
+/** Start thread that connects to the PLC after driver construction.
+ * \param[in] drvPvt adsAsynPortDriver object
+ * \return void
+ */
+void connectThread(void *drvPvt)
+{
+  adsAsynPortDriver *pPvt = (adsAsynPortDriver *)drvPvt;
+  pPvt->connectThread();
 }
 
 /** Start cyclic thread for supervision of connection.
@@ -216,6 +295,26 @@ void bulkReadThread(void *drvPvt)
   pPvt->bulkReadThread();
 }
 
+/** Start write queue thread.
+ * \param[in] drvPvt adsAsynPortDriver object
+ * \return void
+ */
+void writeQueueThread(void *drvPvt)
+{
+  adsAsynPortDriver *pPvt = (adsAsynPortDriver *)drvPvt;
+  pPvt->writeQueueThread();
+}
+
+/** Start write-behind thread.
+ * \param[in] drvPvt adsAsynPortDriver object
+ * \return void
+ */
+void writeBehindThread(void *drvPvt)
+{
+  adsAsynPortDriver *pPvt = (adsAsynPortDriver *)drvPvt;
+  pPvt->writeBehindThread();
+}
+
 /** Constructor for the adsAsynPortDriver class.
  * \param[in] portName Asyn port name.
  * \param[in] ipAddr Ip address of PLC.
@@ -271,6 +370,8 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
 
   pAdsParamArray_= new adsParamInfo*[paramTableSize];
   memset(pAdsParamArray_,0,sizeof(*pAdsParamArray_));
+  pAdsParamHot_= new adsParamHot[paramTableSize];
+  memset(pAdsParamHot_,0,sizeof(adsParamHot)*paramTableSize);
   adsParamArrayCount_=0;
   paramTableSize_=paramTableSize;
   ipaddr_=strdup(ipaddr);
@@ -288,13 +389,29 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
   oneAmsConnectionOKold_=0;
 
   //Octet interface
-  octetAsciiBuffer_.bufferSize = ADS_CMD_BUFFER_SIZE;
-  octetAsciiBuffer_.bytesUsed=0;
-  memset(&octetBinaryBuffer_,0,ADS_CMD_BUFFER_SIZE);
-  octetReturnVarName_=0;
+  octetSessions_.clear();
+  octetBufferSize_=ADS_CMD_BUFFER_SIZE;
+  octetSessionCounter_=0;
+
+  //Array stores (see adsFreeRetiredArrayStores())
+  arrayPublishers_=0;
+
+  //Shared subscriptions (see adsUpdateFollowers())
+  sharedPendingCount_=0;
+
+  //Driver registry (identifies the driver in ADS notifications)
+  driverIndex_=adsAsynPortObjCount;
+  adsAsynPortObjs[adsAsynPortObjCount++]=this;
+
+  recordIndexBuilt_=false;
+  linkCount_=0;
+  linkStart_.tv_sec=0;
+  linkStart_.tv_usec=0;
+  linkCreateParamS_=0;
 
   //ADS
   adsPort_=0; //handle
+  adsPriorityLockInit(&adsMutex);
   remoteNetId_={0,0,0,0,0,0};
   amsPortList_.clear();
 
@@ -335,6 +452,9 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
   }
   adsParamInfo *paramInfo=new adsParamInfo();
   memset(paramInfo,0,sizeof(adsParamInfo));
+  paramInfo->hot=&pAdsParamHot_[0];
+  paramInfo->hot->info=paramInfo;
+  paramInfo->hot->stats=new adsParamStats();
   paramInfo->recordName=strdup("Any record");
   paramInfo->recordType=strdup("No type");
   paramInfo->scan=strdup("No scan");
@@ -344,9 +464,12 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
   paramInfo->drvInfo=strdup("No drvinfo");
   paramInfo->asynType=asynParamNotDefined;
   paramInfo->paramIndex=index;  //also used as hUser for ads callback
+  paramInfo->hot->paramIndex=index;
   paramInfo->plcAdrStr=strdup("No adr str");
+  paramInfo->sharedLeader=-1;
   pAdsParamArray_[0]=paramInfo;
   adsParamArrayCount_++;
+  paramIndexMap_["Default access"]=index;
 
   if(status!=asynSuccess){
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: createParam for default access failed.\n", driverName, functionName);
@@ -364,9 +487,13 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
     return;
   }
 
-  for (int i = 0; i < MAXBULK; i++)
+  for (int i = 0; i < MAXBULK; i++) {
       bulk[i].cnt = 0;            // Entry is currently unused!!
+      bulk[i].tsSlots = 0;
+  }
   bulkTScnt = 0;
+  bulkCycle = 0;
+  adsClockModelReset(&clockModel_);
   if (defaultSampleTimeMS_ < 1000) {
       printf("Default Sample Time of %d ms is too small, defaulting to 1Hz.\n",
              defaultSampleTimeMS_);
@@ -379,6 +506,40 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
   bulkdata = (uint8_t *) malloc(bulkdatasize);
   bulkOK = 0;
   bulk_elapsed_us = 0;
+  chunkSize_ = ADS_DEFAULT_CHUNK_SIZE;
+  chunkedPoll_ = false;
+  chunkedPollList_.clear();
+  writeQueue_.clear();
+  writeQueued_ = new std::atomic<int>[paramTableSize];
+  for (int i = 0; i < paramTableSize; i++)
+      writeQueued_[i] = 0;
+  writeQueueEvent_ = epicsEventMustCreate(epicsEventEmpty);
+  writeCoalesceWindowMS_ = 0;
+  writeCoalesceMaxEntries_ = BULKSIZ;
+  writeFlushRequested_ = false;
+  writeQueueFirstUs_ = 0;
+  writeQueueBatches_ = 0;
+  writeQueueEntries_ = 0;
+  writeQueueErrors_ = 0;
+  writeBehindPendingList_.clear();
+  writeBehindEvent_ = epicsEventMustCreate(epicsEventEmpty);
+  writeBehindSent_ = 0;
+  writeBehindFailed_ = 0;
+  writeBehindCollapsed_ = 0;
+  symbolCachePath_ = NULL;
+  symbolCacheMap_ = NULL;
+  symbolCacheMapSize_ = 0;
+  heartbeatMS_ = ADS_DEFAULT_HEARTBEAT_MS;
+  clockReadMS_ = ADS_DEFAULT_CLOCK_READ_MS;
+  clockReadAmsPort_ = ADS_CLOCK_READ_AMSPORT;
+  clockReadGroup_ = ADS_CLOCK_READ_GROUP;
+  clockReadOffset_ = ADS_CLOCK_READ_OFFSET;
+  clockReadNextNs_ = 0;
+  clockReadError_ = 0;
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  statsStartUs_ = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+  cyclicEvent_ = epicsEventMustCreate(epicsEventEmpty);
 
   //* Create the thread that does the bulk reads */
   status = (asynStatus)(epicsThreadCreate("adsAsynPortDriverBulkReadThread",
@@ -390,30 +551,37 @@ adsAsynPortDriver::adsAsynPortDriver(const char *portName,
     printf("%s:%s: epicsThreadCreate failure\n", driverName, functionName);
     return;
   }
-  //try to connect, and hang until we succeed!
-  for (;;) {
-      if (connect(pasynUserSelf) != asynSuccess) {
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-                    "%s:%s: connect failed for port %s.\n",
-                    driverName, functionName, portName);
-          epicsThreadSleep(1.0);
-          continue;
-      }
-      long error = 0;
-      uint16_t adsState = 0;
-      if (adsReadStateLock(amsport,&adsState,true,&error) != asynSuccess) {
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-                    "%s:%s: adsReadStateLock failed for port %s.\n",
-                    driverName, functionName, portName);
-          disconnect(pasynUserSelf);
-          continue;
-      }
-      if (adsState == ADSSTATE_RUN) {
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-                    "%s:%s: connection established for port %s.\n",
-                    driverName, functionName, portName);
-          return;
-      }
+
+  //* Create the thread that sends coalesced writes */
+  status = (asynStatus)(epicsThreadCreate("adsAsynPortDriverWriteQueueThread",
+                                          epicsThreadPriorityMedium,
+                                          epicsThreadGetStackSize(epicsThreadStackMedium),
+                                          (EPICSTHREADFUNC)::writeQueueThread,this) == NULL);
+
+  if(status){
+    printf("%s:%s: epicsThreadCreate failure\n", driverName, functionName);
+    return;
+  }
+
+  //* Create the thread that sends write-behind values */
+  status = (asynStatus)(epicsThreadCreate("adsAsynPortDriverWriteBehindThread",
+                                          epicsThreadPriorityMedium,
+                                          epicsThreadGetStackSize(epicsThreadStackMedium),
+                                          (EPICSTHREADFUNC)::writeBehindThread,this) == NULL);
+
+  if(status){
+    printf("%s:%s: epicsThreadCreate failure\n", driverName, functionName);
+    return;
+  }
+  //* Create the thread that connects to the PLC (construction does not wait for the PLC) */
+  status = (asynStatus)(epicsThreadCreate("adsAsynPortDriverConnectThread",
+                                          epicsThreadPriorityMedium,
+                                          epicsThreadGetStackSize(epicsThreadStackMedium),
+                                          (EPICSTHREADFUNC)::connectThread,this) == NULL);
+
+  if(status){
+    printf("%s:%s: epicsThreadCreate failure\n", driverName, functionName);
+    return;
   }
 }
 
@@ -427,6 +595,10 @@ adsAsynPortDriver::~adsAsynPortDriver()
 
   free(ipaddr_);
   free(amsaddr_);
+  for(std::map<const asynUser*,adsOctetSession*>::iterator it=octetSessions_.begin();it!=octetSessions_.end();++it){
+    octetSessionFree(it->second);
+  }
+  octetSessions_.clear();
 
   for(int i=0;i<adsParamArrayCount_;i++){
     if(!pAdsParamArray_[i]){
@@ -442,16 +614,82 @@ adsAsynPortDriver::~adsAsynPortDriver()
     free(pAdsParamArray_[i]->out);
     free(pAdsParamArray_[i]->drvInfo);
     free(pAdsParamArray_[i]->plcAdrStr);
-    if(pAdsParamArray_[i]->plcDataIsArray){
-      free(pAdsParamArray_[i]->arrayDataBuffer);
-    }
+    adsArrayStoreDestroy(pAdsParamArray_[i]->hot->arrayStore);
+    free(pAdsParamArray_[i]->writeBehindBuffer);
+    free(pAdsParamArray_[i]->arrayConvBuffer);
+    free(pAdsParamArray_[i]->sharedPending);
+    delete pAdsParamArray_[i]->hot->stats;
     delete pAdsParamArray_[i];
   }
   delete pAdsParamArray_;
+  delete[] pAdsParamHot_;
+  delete[] writeQueued_;
+  for(adsArrayStore *store : retiredArrayStores_){
+    adsArrayStoreDestroy(store);
+  }
 
   for(amsPortInfo *port : amsPortList_){
     delete port;
   }
+
+  unloadSymbolCache();
+  free(symbolCachePath_);
+}
+
+/** Connect thread. Connects to the PLC in the background after driver
+ * construction so that the IOC start is not blocked by an unreachable PLC
+ * and several drivers connect (and resolve symbols) in parallel.
+ * Parameters created before the connection are kept in COMM_ALARM and
+ * refreshed here (in batches) when the default ams port is in RUN.
+ * \return void
+ */
+void adsAsynPortDriver::connectThread()
+{
+  const char* functionName = "connectThread";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
+
+  for (;;) {
+      // Connect once, then only poll the state until RUN (a reconnect
+      // would delete and re-add the route of a live connection)
+      lock();
+      int connected=connectedAds_;
+      unlock();
+      if (!connected && connectLock(pasynUserSelf) != asynSuccess) {
+          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: connect failed for port %s.\n",
+                    driverName, functionName, portName);
+          epicsThreadSleep(1.0);
+          continue;
+      }
+      long error = 0;
+      uint16_t adsState = 0;
+      if (adsReadStateLock(amsportDefault_,&adsState,true,&error) != asynSuccess ||
+          adsState != ADSSTATE_RUN) {
+          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: Ams-port %u of port %s not in RUN.\n",
+                    driverName, functionName, amsportDefault_, portName);
+          epicsThreadSleep(1.0);
+          continue;
+      }
+      break;
+  }
+
+  asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+            "%s:%s: connection established for port %s.\n",
+            driverName, functionName, portName);
+
+  // Resolve params created while not connected and subscribe to symbol
+  // changes. Left overs are retried by cyclicThread().
+  lock();
+  for(amsPortInfo *port : amsPortList_){
+    port->refreshNeeded=true;
+  }
+  unlock();
+  if(refreshParamsLock(0)!=asynSuccess){
+    for(amsPortInfo *port : amsPortList_){
+      port->refreshNeeded=true;
+    }
+  }
 }
 
 /** Cyclic thread for supervision of connection.
@@ -462,22 +700,51 @@ adsAsynPortDriver::~adsAsynPortDriver()
 void adsAsynPortDriver::cyclicThread()
 {
   const char* functionName = "cyclicThread";
-  double sampleTime=0.5;
   while (1){
+    double sampleTime=heartbeatMS_/1000.0;
     asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Sample time [s]= %lf.\n",driverName,functionName,sampleTime);
 
-    epicsThreadSleep(sampleTime);
+    // Woken directly by adsStateNotify() on ads state changes
+    epicsEventWaitWithTimeout(cyclicEvent_,sampleTime);
     if(!allowCallbackEpicsState){
       continue; //Epics not started
     }
 
+    // Data of shared subscriptions held back by the sample time of a follower
+    lock();
+    adsFlushFollowers();
+    unlock();
+
     uint16_t adsState=0;
-    //Check state of all used ams ports
+    //Check state of all used ams ports. The link is supervised with one read
+    //state (heartbeat), the state of the ams ports comes from notifications.
     bool oneAmsConnectionOK=false;
     if(connectedAds_){
+      long heartbeatError=0;
+      uint16_t heartbeatState=0;
+      bool linkOK=adsReadState(amsportDefault_,&heartbeatState,true,&heartbeatError)==asynSuccess;
       for(amsPortInfo *port : amsPortList_){
         long error=0;
-        asynStatus stat=adsReadStateLock(port->amsPort,&adsState,true,&error);
+        asynStatus stat=asynSuccess;
+        if(!linkOK){
+          stat=asynError;
+          if(port->bStateNotifyValid){
+            adsDelStateCallback(port);
+          }
+        }
+        else if(port->amsPort==amsportDefault_){
+          adsState=heartbeatState;
+        }
+        else if(port->bStateNotifyValid){
+          adsState=(uint16_t)port->adsStateNotified;
+        }
+        else{
+          stat=adsReadState(port->amsPort,&adsState,true,&error);
+        }
+        if(linkOK && stat==asynSuccess && !port->bStateNotifyValid){
+          port->adsStateNotified=adsState;  //Until first notification
+          adsAddStateCallback(port);
+        }
         bool portConnected=(stat==asynSuccess && adsState == ADSSTATE_RUN);
         port->adsStateOld=port->adsState;
         if(stat==asynSuccess){
@@ -493,17 +760,48 @@ void adsAsynPortDriver::cyclicThread()
 
         oneAmsConnectionOK=oneAmsConnectionOK || portConnected;
 
-        if(port->connected && port->refreshNeeded){
-          refreshParamsLock(port->amsPort);
+        // Recovery: refresh until all params of the port are valid again
+        if(port->connected && (port->refreshNeeded || port->recovering)){
+          asynStatus refreshStat=asynError;
+          // Fast path: same symbol version and handles, only resubscribe
+          if(port->recovering && adsSymbolsUnchanged(port)){
+            refreshStat=restoreParamsLock(port->amsPort);
+            if(refreshStat==asynSuccess){
+              port->fastRecoveryCount++;
+            }
+          }
+          if(refreshStat!=asynSuccess){
+            refreshStat=refreshParamsLock(port->amsPort);
+            if(refreshStat==asynSuccess){
+              writeSymbolCacheLock();
+            }
+          }
+          if(refreshStat==asynSuccess && port->recovering){
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            port->lastRecoveryUs=(uint64_t)now.tv_sec * 1000000 + now.tv_usec - port->disconnectTimeUs;
+            port->recoveryCount++;
+            port->recovering=false;
+            asynPrint(pasynUserSelf, ASYN_TRACE_INFO,
+                      "%s:%s: Ams-port %u recovered in %.3lf s.\n",
+                      driverName, functionName, port->amsPort, port->lastRecoveryUs/1E6);
+          }
         }
         if(port->connectedOld && !port->connected){
+          // Records stay in COMM_ALARM until the port is refreshed
           invalidateParamsLock(port->amsPort);
           port->refreshNeeded=true;
           setAlarmPortLock(port->amsPort,COMM_ALARM,INVALID_ALARM);
+          if(!port->recovering){
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            port->disconnectTimeUs=(uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+            port->recovering=true;
+          }
+          port->disconnectCount++;
           asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-                    "%s:%s: connection failed for port %s.\n",
-                    driverName, functionName, portName);
-          exit(-1);
+                    "%s:%s: connection failed for port %s (ams-port %u). Trying to recover...\n",
+                    driverName, functionName, portName, port->amsPort);
         }
         if(!port->connectedOld && port->connected){
           adsReadVersion(port);
@@ -529,6 +827,13 @@ void adsAsynPortDriver::cyclicThread()
     }
 
 
+    // PLC clock model: explicit time read, independent of PLC time variables
+    // and notifications (period at least the heartbeat period)
+    if(oneAmsConnectionOK && clockReadMS_>0 && adsClockHostNs()>=clockReadNextNs_){
+      clockReadNextNs_=adsClockHostNs()+(int64_t)clockReadMS_*1000000;
+      adsReadPlcClock();
+    }
+
     if(!oneAmsConnectionOK){
       notConnectedCounter_++;
       if (notConnectedCounter_ < 100 || notConnectedCounter_ % 100 == 0) {
@@ -562,13 +867,19 @@ void adsAsynPortDriver::bulkReadThread()
     long status;
     uint32_t cnt, readSize;
     asynUser *asynTraceUser=getTraceAsynUser();
+    std::vector<uint8_t> reply;      // Copy of the reply, decoded without adsMutex
+    std::vector<bulkPlanEntry> plan; // Copy of the decode plan
 
+    traceCallbacks = false;
     gettimeofday(&now, NULL);
     while (1) {
         start = now;
-        adsLock();
-        for (int i = 0; bulk[i].cnt; i++) {
+        bulkCycle++;
+        /* Lock per sum read so that writes only wait for one request. */
+        for (int i = 0; i < MAXBULK; i++) {
+            adsLock(ADS_LANE_POLL);
             if (!bulkOK || !bulk[i].cnt) {
+                adsUnlock();
                 break;
             }
 #ifdef MCB_DEBUG
@@ -582,25 +893,35 @@ void adsAsynPortDriver::bulkReadThread()
             cnt = bulk[i].cnt;
             readSize = bulk[i].readSize;
             AmsAddr amsServer={remoteNetId_,bulk[i].amsPort};
+            int64_t requestNs = adsClockHostNs();
             status = AdsSyncReadWriteReqEx2(adsPort_, &amsServer,
                                             ADSIGRP_SUMUP_READ, cnt,
                                             readSize, bulkdata,
                                             sizeof(bulk[i].sum[0]) * cnt, &bulk[i].sum,
                                             &bytesRead);
+            requestNs += (adsClockHostNs() - requestNs) / 2;
+            adsTrace(ADS_TRACE_BULK_READ, driverIndex_, i, bytesRead, (int32_t)status, 0);
             if (status) {
                 printf("Sum read %d failed: status %ld\n", i, status);
+                adsUnlock();
                 continue;
             }
 
             uint32_t *stat = (uint32_t *)bulkdata;
-            uint8_t  *srd  = bulkdata + cnt * sizeof(uint32_t);
+            uint8_t  *data = bulkdata + cnt * sizeof(uint32_t);
             uint64_t nTimeStamp = 0;
-            /* The first *two* bulk parameters might be the timestamp! */
-            if (!stat[0] && !stat[1] && bulk[i].sum[0].iGroup == ADSIGRP_SYM_VALBYHND) {
-                nTimeStamp = ((uint32_t *)srd)[0];
-                nTimeStamp = (nTimeStamp << 32) | ((uint32_t *)srd)[1];
-            } else {
+            uint32_t tsSlots = bulk[i].tsSlots;
+            struct tsentry *ts = &bulkTS[bulk[i].tsIndex];
+            /* The first read of a port carries the time stamp of the port for this cycle */
+            if (!tsSlots && ts->cycle == bulkCycle) {
+                nTimeStamp = ts->cycleTimeStamp;
+            } else if (tsSlots && !stat[0] && !stat[1] && bulk[i].sum[0].iGroup == ADSIGRP_SYM_VALBYHND) {
+                nTimeStamp = ((uint32_t *)data)[0];
+                nTimeStamp = (nTimeStamp << 32) | ((uint32_t *)data)[1];
+                adsClockModelAddSample(&clockModel_, nTimeStamp, requestNs, true);
+            } else if (adsClockModelPlcTime(&clockModel_, requestNs, &nTimeStamp) != 0) {
                 /*
+                 * No PLC time variables and no PLC clock model yet (no notifications).
                  * Sigh.  now has the time since 1970-01-01 00:00:00 UTC, but
                  * we want 100ns increments since 1601-01-01!! So we grab the constant
                  * from adsAsynPortDriverUtils.cpp and convert.
@@ -609,32 +930,56 @@ void adsAsynPortDriver::bulkReadThread()
                 nTimeStamp = now.tv_sec + SEC_TO_UNIX_EPOCH;
                 nTimeStamp = (nTimeStamp * 1000000 + now.tv_usec) * 10;
             }
-            if (!stat[0])
-                srd += sizeof(uint32_t);
-            if (!stat[1])
-                srd += sizeof(uint32_t);
-            stat += 2;
-            for (uint32_t j = 2; j < cnt; j++) {
-                adsParamInfo *paramInfo=getAdsParamInfo(bulk[i].paramID[j]);
-                if (!paramInfo){
-                    asynPrint(asynTraceUser, ASYN_TRACE_ERROR,
-                              "%s:%s: getAdsParamInfo() for hUser %u failed\n",
-                              driverName, functionName, bulk[i].paramID[j]);
-                    continue;
-                }
-                if (*stat++) {
+            if (tsSlots) {
+                ts->cycleTimeStamp = nTimeStamp;
+                ts->cycle = bulkCycle;
+            }
+            /* Parameters and callbacks need the port lock, which must not be
+               taken while holding adsMutex (drvUserCreate() and writes take
+               them in the other order). Copy reply and plan and decode after
+               releasing adsMutex. */
+            reply.assign(bulkdata, bulkdata + readSize);
+            plan.assign(bulk[i].plan, bulk[i].plan + cnt);
+            adsUnlock();
+            stat = (uint32_t *)reply.data();
+            data = reply.data() + cnt * sizeof(uint32_t);
+
+            /* All elements of the sum read share the time stamp: convert once */
+            epicsTimeStamp plcTimeStamp;
+            windowsToEpicsTimeStamp(nTimeStamp, &plcTimeStamp);
+            /* Decode by plan. Failed elements have no data in the reply, so
+               the offsets of the following elements shift by their size. */
+            uint32_t skipped = 0;
+            for (uint32_t j = 0; j < tsSlots; j++) {
+                if (stat[j])
+                    skipped += plan[j].size;
+            }
+            lock();
+            for (uint32_t j = tsSlots; j < cnt; j++) {
+                adsParamHot *hot = plan[j].hot;
+                uint32_t size = plan[j].size;
+                if (stat[j]) {
+                    adsTrace(ADS_TRACE_BULK_ELEMENT, driverIndex_, hot->paramIndex, 0, (int32_t)stat[j], nTimeStamp);
                     asynPrint(asynTraceUser, ASYN_TRACE_ERROR,
                               "%s:%s: bulk read for %s (%d) failed\n",
-                              driverName, functionName, paramInfo->drvInfo, j);
+                              driverName, functionName, hot->info->drvInfo, j);
+                    if (hot->stats)
+                        hot->stats->errors.fetch_add(1, std::memory_order_relaxed);
+                    skipped += size;
                     continue;
                 }
-                paramInfo->plcTimeStampRaw=nTimeStamp;
-                paramInfo->lastCallbackSize=paramInfo->plcSize;
-                adsUpdateParameter(paramInfo, srd);
-                srd += paramInfo->lastCallbackSize;
+                adsSetParamPlcTime(hot, nTimeStamp, &plcTimeStamp);
+                hot->lastCallbackSize = size;
+                adsParamStatsUpdate(hot->stats, ADS_PATH_BULK, size, (uint64_t)(requestNs / 1000));
+                adsUpdateParameter(hot, data + plan[j].offset - skipped, size);
+                if (hot->nextShared)
+                    adsUpdateFollowers(hot, data + plan[j].offset - skipped, size, ADS_PATH_BULK, requestNs);
             }
+            unlock();
         }
-        adsUnlock();
+        /* Large arrays: one ADS request per chunk (other requests can go in between). */
+        if (bulkOK)
+            adsPollChunked();
         gettimeofday(&now, NULL);
         bulk_elapsed_us = (now.tv_sec - start.tv_sec) * 1000000 +
                           (now.tv_usec - start.tv_usec);
@@ -648,6 +993,130 @@ void adsAsynPortDriver::bulkReadThread()
     }
 }
 
+/** Write queue thread. Sends queued writes when the coalescing window
+ * (counted from the first queued write) has passed, when the queue is full
+ * or when a flush is requested.
+ */
+void adsAsynPortDriver::writeQueueThread()
+{
+  std::vector<adsWriteQueueEntry> batch;
+  std::vector<long> errors;
+  double waitS = 1.0;
+
+  while (1) {
+    epicsEventWaitWithTimeout(writeQueueEvent_, waitS);
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t nowUs = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+
+    /* Held until sent so that direct writes cannot overtake (adsFlushQueuedWrites()) */
+    writeSendMutex_.lock();
+    writeQueueMutex_.lock();
+    uint64_t windowUs = (uint64_t)writeCoalesceWindowMS_ * 1000;
+    size_t maxEntries = (size_t)writeCoalesceMaxEntries_;
+    waitS = 1.0;
+    if (!writeQueue_.empty()) {
+      uint64_t elapsedUs = nowUs - writeQueueFirstUs_;
+      if (writeFlushRequested_ || elapsedUs >= windowUs) {
+        batch.swap(writeQueue_);
+        writeFlushRequested_ = false;
+      } else {
+        waitS = (windowUs - elapsedUs) / 1000000.0;
+      }
+    }
+    writeQueueMutex_.unlock();
+
+    // Split in sum writes: same ams port, max entries and max size (chunk size)
+    errors.resize(batch.size());
+    unsigned long batches = 0;
+    size_t first = 0;
+    while (first < batch.size()) {
+      size_t last = first + 1;
+      uint32_t bytes = batch[first].size;
+      while (last < batch.size() &&
+             batch[last].amsPort == batch[first].amsPort &&
+             last - first < maxEntries &&
+             (chunkSize_ == 0 || bytes + batch[last].size <= chunkSize_)) {
+        bytes += batch[last].size;
+        last++;
+      }
+      adsSumWriteSend(&batch[first], (uint32_t)(last - first), &errors[first]);
+      batches++;
+      first = last;
+    }
+    for (adsWriteQueueEntry &entry : batch)
+        writeQueued_[entry.paramIndex]--;
+    writeSendMutex_.unlock();
+
+    // Write alarms need the port lock (not taken while holding writeSendMutex_)
+    if (!batch.empty()) {
+      lock();
+      writeQueueBatches_ += batches;
+      adsSumWriteResults(batch.data(), (uint32_t)batch.size(), errors.data());
+      unlock();
+    }
+    for (adsWriteQueueEntry &entry : batch) {
+      free(entry.data);
+    }
+    batch.clear();
+  }
+}
+
+/** Write-behind thread. Sends the latest pending value of each write-behind
+ * parameter. Values written while a value is pending replace it (collapsed).
+ */
+void adsAsynPortDriver::writeBehindThread()
+{
+  std::vector<int> pending;
+  std::vector<uint8_t> data;
+
+  while (1) {
+    epicsEventWait(writeBehindEvent_);
+
+    writeBehindMutex_.lock();
+    pending.swap(writeBehindPendingList_);
+    writeBehindMutex_.unlock();
+
+    for (int paramIndex : pending) {
+      adsParamInfo *paramInfo = getAdsParamInfo(paramIndex);
+      if (!paramInfo)
+        continue;
+
+      writeBehindMutex_.lock();
+      uint32_t group = paramInfo->writeBehindGroup;
+      uint32_t offset = paramInfo->writeBehindOffset;
+      data.assign(paramInfo->writeBehindBuffer, paramInfo->writeBehindBuffer + paramInfo->writeBehindSize);
+      paramInfo->writeBehindPending = false;
+      writeBehindMutex_.unlock();
+
+      long error = 0;
+      adsWriteChunked(paramInfo, group, offset, data.data(), (uint32_t)data.size(), &error);
+
+      lock();
+      if (error) {
+        paramInfo->writeBehindFailed++;
+        writeBehindFailed_++;
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:writeBehindThread: ADS write of %s failed with: %s (0x%lx)\n",
+                  driverName, paramInfo->drvInfo, adsErrorToString(error), error);
+        setAlarmParam(paramInfo, WRITE_ALARM, INVALID_ALARM);
+      } else {
+        paramInfo->writeBehindSent++;
+        writeBehindSent_++;
+        if (paramInfo->hot->alarmStatus == WRITE_ALARM)
+          setAlarmParam(paramInfo, NO_ALARM, NO_ALARM);
+      }
+      unlock();
+    }
+    if (!pending.empty()) {
+      lock();
+      adsPublishWriteBehindStats();
+      unlock();
+    }
+    pending.clear();
+  }
+}
+
 /** Report of configured parameters.
  * \param[in] fp Output file.
  * \param[in] details Details of printout. A higher number results in more
@@ -679,8 +1148,38 @@ void adsAsynPortDriver::report(FILE *fp, int details)
     fprintf(fp, "  Default sample time [ms]     %d\n",defaultSampleTimeMS_);
     fprintf(fp, "  Default max delay time [ms]: %d\n",defaultMaxDelayTimeMS_);
     fprintf(fp, "  Default time source:         %s\n",(defaultTimeSource_==ADS_TIME_BASE_PLC) ? ADS_OPTION_TIMEBASE_PLC : ADS_OPTION_TIMEBASE_EPICS);
+    fprintf(fp, "  Octet sessions:              %lu\n",(unsigned long)octetSessions_.size());
+    fprintf(fp, "  Octet buffer size [bytes]:   %lu\n",(unsigned long)octetBufferSize_);
+    fprintf(fp, "  Heartbeat period [ms]:       %d\n",heartbeatMS_);
+    fprintf(fp, "  PLC time read [ms]:          %d (0=disabled, ams-port %u, group 0x%x, offset 0x%x)\n",clockReadMS_,clockReadAmsPort_,clockReadGroup_,clockReadOffset_);
+    fprintf(fp, "  Write coalescing [ms]:       %d (0=disabled, max %d writes)\n",writeCoalesceWindowMS_,writeCoalesceMaxEntries_);
+    fprintf(fp, "  Write queue sum writes:      %lu (%lu writes, %lu failed)\n",writeQueueBatches_,writeQueueEntries_,writeQueueErrors_);
+    fprintf(fp, "  Write-behind writes:         %lu sent, %lu collapsed, %lu failed\n",writeBehindSent_,writeBehindCollapsed_,writeBehindFailed_);
     fprintf(fp, "  NOTE: Several records can be linked to the same parameter.\n");
     fprintf(fp,"\n");
+    fprintf(fp, "ADS lock wait time per lane (<10us <100us <1ms <10ms <100ms <1s >=1s, max, served after %d ms):\n",ADS_LANE_MAX_WAIT_MS);
+    for(int lane=0;lane<ADS_LANE_MAX;lane++){
+      fprintf(fp, "  %-14s",adsLaneToString(lane));
+      for(int bin=0;bin<ADS_LANE_HIST_BINS;bin++){
+        fprintf(fp, " %lu",adsMutex.hist[lane][bin]);
+      }
+      fprintf(fp, ", %.0lf us, %lu aged\n",adsMutex.maxWaitUs[lane],adsMutex.aged[lane]);
+    }
+    fprintf(fp,"\n");
+    fprintf(fp, "Ams-port connection recovery:\n");
+    for(amsPortInfo *port : amsPortList_){
+      fprintf(fp, "  Ams-port %u: %s, state notification %s, disconnects %u, recoveries %u (%u without re-resolve), last recovery time %.3lf s, last alarm update %.3lf ms, symbol version %d\n",
+              port->amsPort,
+              port->recovering ? "recovering" : (port->connected ? "connected" : "disconnected"),
+              port->bStateNotifyValid ? "yes" : "no",
+              port->disconnectCount,port->recoveryCount,port->fastRecoveryCount,port->lastRecoveryUs/1E6,
+              port->lastAlarmUs/1E3,
+              port->symVersionValid ? (int)port->symVersion : -1);
+    }
+    fprintf(fp,"\n");
+    fprintf(fp, "PLC clock model (time stamps of bulk reads without PLC time):\n");
+    adsClockModelReport(&clockModel_,fp);
+    fprintf(fp,"\n");
   }
   if(details>=2){
     //print all parameters
@@ -704,13 +1203,23 @@ void adsAsynPortDriver::report(FILE *fp, int details)
       fprintf(fp,"    Param max delay time [ms]: %lf\n",paramInfo->maxDelayTimeMS);
       fprintf(fp,"    Param isIOIntr:            %s\n",paramInfo->isIOIntr ? "true" : "false");
       fprintf(fp,"    Param asyn addr:           %d\n",paramInfo->asynAddr);
-      fprintf(fp,"    Param time source:         %s\n",(paramInfo->timeBase==ADS_TIME_BASE_PLC) ? ADS_OPTION_TIMEBASE_PLC : ADS_OPTION_TIMEBASE_EPICS);
-      fprintf(fp,"    Param plc time:            %us:%uns\n",paramInfo->plcTimeStamp.secPastEpoch,paramInfo->plcTimeStamp.nsec);
-      fprintf(fp,"    Param epics time:          %us:%uns\n",paramInfo->epicsTimestamp.secPastEpoch,paramInfo->epicsTimestamp.nsec);
-      fprintf(fp,"    Param array buffer alloc:  %s\n",paramInfo->arrayDataBuffer ? "true" : "false");
-      fprintf(fp,"    Param array buffer size:   %lu\n",paramInfo->arrayDataBufferSize);
-      fprintf(fp,"    Param alarm:               %d\n",paramInfo->alarmStatus);
-      fprintf(fp,"    Param severity:            %d\n",paramInfo->alarmSeverity);
+      fprintf(fp,"    Param time source:         %s\n",(paramInfo->hot->timeBase==ADS_TIME_BASE_PLC) ? ADS_OPTION_TIMEBASE_PLC : ADS_OPTION_TIMEBASE_EPICS);
+      fprintf(fp,"    Param plc time:            %us:%uns\n",paramInfo->hot->plcTimeStamp.secPastEpoch,paramInfo->hot->plcTimeStamp.nsec);
+      fprintf(fp,"    Param epics time:          %us:%uns\n",paramInfo->hot->epicsTimestamp.secPastEpoch,paramInfo->hot->epicsTimestamp.nsec);
+      fprintf(fp,"    Param array buffer alloc:  %s\n",paramInfo->hot->arrayStore ? "true" : "false");
+      fprintf(fp,"    Param array buffer size:   %lu\n",paramInfo->hot->arrayStore ? paramInfo->hot->arrayStore->size : 0);
+      fprintf(fp,"    Param array publish count: %lu\n",paramInfo->hot->arrayStore ? paramInfo->hot->arrayStore->publishCount : 0);
+      fprintf(fp,"    Param chunked poll:        %s\n",paramInfo->isChunkedPoll ? "true" : "false");
+      fprintf(fp,"    Param shared subscription: %d\n",paramInfo->sharedLeader);
+      if(paramInfo->isWriteBehind){
+        fprintf(fp,"    Param write-behind:        sent %lu, collapsed %lu, failed %lu\n",paramInfo->writeBehindSent,paramInfo->writeBehindCollapsed,paramInfo->writeBehindFailed);
+      }
+      uint32_t chunksDone,chunksTotal;
+      adsGetChunkProgress(paramInfo,&chunksDone,&chunksTotal);
+      fprintf(fp,"    Param chunks (last):       %u/%u\n",chunksDone,chunksTotal);
+      fprintf(fp,"    Param array conversion:    %s\n",paramInfo->arrayReadKernel ? adsTypeToString(paramInfo->arrayEpicsType) : "none");
+      fprintf(fp,"    Param alarm:               %d\n",paramInfo->hot->alarmStatus);
+      fprintf(fp,"    Param severity:            %d\n",paramInfo->hot->alarmSeverity);
       fprintf(fp,"    Param data source:         %s\n",paramInfo->dataSource==ADS_DATASOURCE_PLC ? "PLC" : "DRIVER");
       fprintf(fp,"    Plc ams port:              %d\n",paramInfo->amsPort);
       fprintf(fp,"    Plc adr str:               %s\n",paramInfo->plcAdrStr);
@@ -720,8 +1229,8 @@ void adsAsynPortDriver::report(FILE *fp, int details)
       fprintf(fp,"    Plc abs adr offset:        16#%x\n",paramInfo->plcAbsAdrOffset);
       fprintf(fp,"    Plc data type:             %s\n",adsTypeToString(paramInfo->plcDataType));
       fprintf(fp,"    Plc data type size:        %zu\n",adsTypeSize(paramInfo->plcDataType));
-      fprintf(fp,"    Plc data size:             %u\n",paramInfo->plcSize);
-      fprintf(fp,"    Plc data is array:         %s\n",paramInfo->plcDataIsArray ? "true" : "false");
+      fprintf(fp,"    Plc data size:             %u\n",paramInfo->hot->plcSize);
+      fprintf(fp,"    Plc data is array:         %s\n",paramInfo->hot->plcDataIsArray ? "true" : "false");
       fprintf(fp,"    Plc data type warning:     %s\n",paramInfo->plcDataTypeWarn ? "true" : "false");
       fprintf(fp,"    Ads hCallbackNotify:       %u\n",paramInfo->hCallbackNotify);
       fprintf(fp,"    Ads CallbackNotify valid:  %s\n",paramInfo->bCallbackNotifyValid ? "true" : "false");
@@ -758,6 +1267,7 @@ asynStatus adsAsynPortDriver::disconnect(asynUser *pasynUser)
   asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
   asynStatus disconnectStatus=adsDisconnect();
+  octetSessionFreeIdle();
   if (disconnectStatus){
     return asynError;
   }
@@ -790,30 +1300,88 @@ asynStatus adsAsynPortDriver::refreshParamsLock(uint16_t amsPort)
 
 /** Refreshes all parameters for a specific amsport.
  * \param[in] amsPort ams port.
- * \return asynSuccess or asynError.
+ * \return asynSuccess if all parameters are refreshed otherwise asynError
+ *  (the ones left keep refreshNeeded set).
  */
 asynStatus adsAsynPortDriver::refreshParams(uint16_t amsPort)
 {
   const char* functionName = "refreshParams";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
+  bool refreshDone=true;
   if(connectedAds_){
+    for(amsPortInfo *port : amsPortList_){
+      if(amsPort==0 || port->amsPort==amsPort){
+        port->targetPortLost=false;
+      }
+    }
+
     if(adsParamArrayCount_>1){
-      //Renew data notification callbacks
+      //Renew symbol info, handles and data notification callbacks.
+      //Symbol info and handles are read in batches per ams port.
+      std::vector<adsParamInfo*> batch;
       for(int i=1; i<adsParamArrayCount_;i++){  //Skip first param since used for motorrecord or stream device
         if(!pAdsParamArray_[i]){
           continue;
         }
         adsParamInfo *paramInfo=pAdsParamArray_[i];
         if((amsPort==0 || paramInfo->amsPort==amsPort) && paramInfo->refreshNeeded){
-          updateParamInfoWithPLCInfo(paramInfo);
+          batch.push_back(paramInfo);
+        }
+      }
+
+      size_t first=0;
+      while(first<batch.size()){
+        // Collect up to ADS_RESOLVE_BATCH_SIZE symbolic params on the same ams port
+        std::vector<adsParamInfo*> symbols;
+        size_t last=first;
+        while(last<batch.size() && batch[last]->amsPort==batch[first]->amsPort &&
+              symbols.size()<ADS_RESOLVE_BATCH_SIZE){
+          if(batch[last]->dataSource==ADS_DATASOURCE_PLC && !batch[last]->isAdrCommand){
+            symbols.push_back(batch[last]);
+          }
+          last++;
+        }
+
+        amsPortInfo *port=getAmsPortObject(batch[first]->amsPort);
+        if(symbols.size()>1){
+          if(adsResolveBatch(batch[first]->amsPort,symbols.data(),symbols.size())!=asynSuccess && port){
+            port->targetPortLost=true;
+          }
         }
+
+        for(size_t i=first;i<last;i++){
+          if(port && port->targetPortLost){
+            break;
+          }
+          updateParamInfoWithPLCInfo(batch[i]);
+        }
+        for(size_t i=first;i<last;i++){
+          batch[i]->symInfoPrefetched=false;
+          batch[i]->symHandlePrefetched=false;
+          if(batch[i]->refreshNeeded && batch[i]->symbolMissing){
+            // Not in the PLC program: alarm it, retried at the next symbol change
+            asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Symbol %s not found on ams port %u.\n", driverName, functionName,batch[i]->plcAdrStr,batch[i]->amsPort);
+            setAlarmParam(batch[i],COMM_ALARM,INVALID_ALARM);
+            continue;
+          }
+          refreshDone=refreshDone && !batch[i]->refreshNeeded;
+        }
+        if(port && port->targetPortLost){
+          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Ams port %u not reachable. Refresh continues when connection is back.\n", driverName, functionName,port->amsPort);
+          // Skip the remaining params of this ams port
+          while(last<batch.size() && batch[last]->amsPort==port->amsPort){
+            last++;
+          }
+          refreshDone=false;
+        }
+        first=last;
       }
     }
 
     //Renew symbols changed notification callbacks
     for(amsPortInfo *port : amsPortList_){
-      if(port->amsPort==amsPort && port->refreshNeeded){
+      if((amsPort==0 || port->amsPort==amsPort) && port->refreshNeeded && !port->targetPortLost){
         if(port->bCallbackNotifyValid){
           adsDelSymbolsChangedCallback(port);
         }
@@ -821,8 +1389,21 @@ asynStatus adsAsynPortDriver::refreshParams(uint16_t amsPort)
       }
     }
   }
+  else{
+    refreshDone=false;
+  }
+
+  //Remember symbol version for a fast reconnect (restoreParams())
+  if(refreshDone){
+    for(amsPortInfo *port : amsPortList_){
+      if(amsPort==0 || port->amsPort==amsPort){
+        adsSaveSymbolKey(port);
+      }
+    }
+  }
+  adsRefreshBulkTimeStamps(amsPort);
   bulkOK = 1;
-  return asynSuccess;
+  return refreshDone ? asynSuccess : asynError;
 }
 
 /** Invalidates all parameters for a specific amsport (with asyn lock()).
@@ -867,46 +1448,303 @@ asynStatus adsAsynPortDriver::invalidateParams(uint16_t amsPort)
       if (bulk[i].cnt == 0)                        // Quit if unused!
           break;
       if (amsPort == 0 || bulk[i].amsPort == amsPort)
-          bulk[i].readSize = 4 * sizeof(uint32_t); // Initialize to just the timestamp!
+          bulk[i].readSize = bulk[i].tsSlots * 2 * sizeof(uint32_t); // Initialize to just the timestamp!
   }
   return asynSuccess;
 }
 
-/** Connects to a PLC (with asyn lock()).
- * \param[in] pasynUser Asyn user
+/** Refreshes the parameters of an amsport that changed after an online
+ * change (with asyn lock()).
+ * \param[in] amsPort ams port.
  * \return asynSuccess or asynError.
  * Thread safe.
  */
-asynStatus adsAsynPortDriver::connectLock(asynUser *pasynUser)
+asynStatus adsAsynPortDriver::refreshChangedParamsLock(uint16_t amsPort)
 {
   lock();
-  asynStatus stat=connect(pasynUser);
+  asynStatus stat=refreshChangedParams(amsPort);
   unlock();
   return stat;
 }
 
-/** Connects to a PLC.
- * \param[in] pasynUser Asyn user
+/** Refreshes the parameters of an amsport that changed after an online
+ * change. The symbol info of all symbolic parameters is read in sum requests
+ * and compared to the cached address, size and data type. Only parameters
+ * that differ (or are gone) are refreshed, together with the parameters that
+ * were not resolved before (symbol missing or PLC not in RUN), since the
+ * online change may have added them. Falls back to a full refresh if the
+ * symbol info cannot be read.
+ * \param[in] amsPort ams port.
  * \return asynSuccess or asynError.
  */
-asynStatus adsAsynPortDriver::connect(asynUser *pasynUser)
+asynStatus adsAsynPortDriver::refreshChangedParams(uint16_t amsPort)
 {
-  const char* functionName = "connect";
-  asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s: %s\n", driverName, functionName, epicsThreadGetNameSelf());
-
-  bool err=false;
-  asynStatus stat = adsConnect();
+  const char* functionName = "refreshChangedParams";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
-  if (stat!= asynSuccess){
-    return asynError;
+  std::vector<adsParamInfo*> symbols;
+  int pending=0;  //Not resolved before the online change (may exist now)
+  for(int i=1; i<adsParamArrayCount_;i++){  //Skip first param since used for motorrecord or stream device
+    adsParamInfo *paramInfo=pAdsParamArray_[i];
+    if(!paramInfo || paramInfo->amsPort!=amsPort){
+      continue;
+    }
+    if(paramInfo->refreshNeeded || paramInfo->symbolMissing){
+      paramInfo->refreshNeeded=true;
+      pending++;
+      continue;
+    }
+    if(paramInfo->dataSource==ADS_DATASOURCE_PLC && !paramInfo->isAdrCommand){
+      symbols.push_back(paramInfo);
+    }
   }
 
-  if(asynPortDriver::connect(pasynUser)!=asynSuccess){
-    return asynError;
+  int changed=0;
+  std::vector<adsSumRequest> requests;
+  std::vector<adsSymbolEntry> infos;
+  for(size_t first=0;first<symbols.size();first+=ADS_RESOLVE_BATCH_SIZE){
+    uint32_t count=std::min(symbols.size()-first,(size_t)ADS_RESOLVE_BATCH_SIZE);
+    requests.resize(count);
+    infos.resize(count);
+    for(uint32_t i=0;i<count;i++){
+      adsSumRequest *req=&requests[i];
+      memset(req,0,sizeof(adsSumRequest));
+      req->group=ADSIGRP_SYM_INFOBYNAMEEX;
+      req->readLen=sizeof(adsSymbolEntry);
+      req->readData=&infos[i];
+      req->writeLen=strlen(symbols[first+i]->plcAdrStr);
+      req->writeData=symbols[first+i]->plcAdrStr;
+    }
+    if(adsSumReadWrite(amsPort,ADS_LANE_SUBSCRIPTION,requests.data(),count)!=asynSuccess){
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to read symbol info. Refresh all params of ams-port %u.\n", driverName, functionName,amsPort);
+      invalidateParams(amsPort);
+      return refreshParams(amsPort);
+    }
+    for(uint32_t i=0;i<count;i++){
+      adsParamInfo *paramInfo=symbols[first+i];
+      bool same=!requests[i].error &&
+                infos[i].iGroup==paramInfo->plcAbsAdrGroup &&
+                infos[i].iOffset==paramInfo->plcAbsAdrOffset &&
+                infos[i].size==paramInfo->hot->plcSize &&
+                infos[i].dataType==(uint32_t)paramInfo->plcDataType;
+      if(!same){
+        asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Symbol %s changed.\n", driverName, functionName,paramInfo->plcAdrStr);
+        paramInfo->refreshNeeded=true;
+        changed++;
+      }
+    }
   }
 
-  connectedAds_=1;
-  return err ? asynError : asynSuccess;
+  asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Ams-port %u: %d of %lu symbols changed, %d unresolved.\n", driverName, functionName,amsPort,changed,(unsigned long)symbols.size(),pending);
+
+  if(!changed && !pending){
+    amsPortInfo *port=getAmsPortObject(amsPort);
+    if(port){
+      adsSaveSymbolKey(port);
+    }
+    return asynSuccess;
+  }
+
+  bulkOK = 0;  //Bulk reads may contain stale handles until refreshed
+  asynStatus stat=refreshParams(amsPort);
+  for(adsParamInfo *paramInfo : symbols){
+    if(paramInfo->refreshNeeded){
+      setAlarmParam(paramInfo,COMM_ALARM,INVALID_ALARM);
+    }
+  }
+  if(symbolCachePath_){
+    writeSymbolCache();
+  }
+  return stat;
+}
+
+/** Remember symbol version and symbol upload info of an ams port when its
+ * parameters are resolved (see adsSymbolsUnchanged()).
+ * \param[in] port Ams port info.
+ */
+void adsAsynPortDriver::adsSaveSymbolKey(amsPortInfo *port)
+{
+  adsSymbolCachePort key;
+  port->symVersionValid=adsReadSymbolCacheKey(port,&key)==asynSuccess;
+  port->symVersion=key.symVersion;
+  port->symCount=key.symCount;
+  port->symSize=key.symSize;
+}
+
+/** Checks if the symbols of an ams port are unchanged since the parameters
+ * were resolved: same symbol version and symbol upload info (count and size
+ * of the symbol table) and all symbol handles still valid. Handles are
+ * probed with sum reads of the first bytes of each symbol, which must return
+ * the requested size.
+ * \param[in] port Ams port info.
+ * \return true if handles and addresses can be kept.
+ */
+bool adsAsynPortDriver::adsSymbolsUnchanged(amsPortInfo *port)
+{
+  const char* functionName = "adsSymbolsUnchanged";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u\n", driverName, functionName,port->amsPort);
+
+  adsSymbolCachePort key;
+  if(!port->symVersionValid || adsReadSymbolCacheKey(port,&key)!=asynSuccess ||
+     key.symVersion!=port->symVersion || key.symCount!=port->symCount || key.symSize!=port->symSize){
+    return false;
+  }
+
+  std::vector<adsParamInfo*> symbols;
+  for(int i=1; i<adsParamArrayCount_;i++){  //Skip first param since used for motorrecord or stream device
+    adsParamInfo *paramInfo=pAdsParamArray_[i];
+    if(paramInfo && paramInfo->amsPort==port->amsPort && paramInfo->dataSource==ADS_DATASOURCE_PLC &&
+       !paramInfo->isAdrCommand && !paramInfo->symbolMissing){
+      if(!paramInfo->bSymbolicHandleValid || !paramInfo->plcAbsAdrValid){
+        return false;
+      }
+      symbols.push_back(paramInfo);
+    }
+  }
+
+  std::vector<adsSumRequest> requests;
+  std::vector<uint32_t> probe;
+  for(size_t first=0;first<symbols.size();first+=ADS_RESOLVE_BATCH_SIZE){
+    uint32_t count=std::min(symbols.size()-first,(size_t)ADS_RESOLVE_BATCH_SIZE);
+    requests.resize(count);
+    probe.resize(count);
+    for(uint32_t i=0;i<count;i++){
+      adsSumRequest *req=&requests[i];
+      memset(req,0,sizeof(adsSumRequest));
+      req->group=ADSIGRP_SYM_VALBYHND;
+      req->offset=symbols[first+i]->hSymbolicHandle;
+      req->readLen=std::min(symbols[first+i]->hot->plcSize,(uint32_t)sizeof(uint32_t));
+      req->readData=&probe[i];
+    }
+    if(adsSumReadWrite(port->amsPort,ADS_LANE_SUBSCRIPTION,requests.data(),count)!=asynSuccess){
+      return false;
+    }
+    for(uint32_t i=0;i<count;i++){
+      if(requests[i].error){
+        asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Handle of %s not valid anymore (%s).\n", driverName, functionName,symbols[first+i]->plcAdrStr,adsErrorToString(requests[i].error));
+        return false;
+      }
+      if(requests[i].bytesRead!=requests[i].readLen){
+        asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Handle of %s returned %u bytes (expected %u).\n", driverName, functionName,symbols[first+i]->plcAdrStr,requests[i].bytesRead,requests[i].readLen);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/** Restores the parameters of an amsport after a reconnect when the symbols
+ * are unchanged (with asyn lock()).
+ * \param[in] amsPort ams port.
+ * \return asynSuccess or asynError.
+ * Thread safe.
+ */
+asynStatus adsAsynPortDriver::restoreParamsLock(uint16_t amsPort)
+{
+  lock();
+  asynStatus stat=restoreParams(amsPort);
+  unlock();
+  return stat;
+}
+
+/** Restores the parameters of an amsport after a reconnect when the symbols
+ * are unchanged (see adsSymbolsUnchanged()). Symbol info and handles are kept.
+ * Only data notifications and the symbols changed notification are
+ * registered again and the bulk reads are restored in place. Values are
+ * updated by the first notification or bulk read. Parameters that cannot
+ * be restored are refreshed with updateParamInfoWithPLCInfo().
+ * \param[in] amsPort ams port.
+ * \return asynSuccess if all parameters are restored otherwise asynError.
+ */
+asynStatus adsAsynPortDriver::restoreParams(uint16_t amsPort)
+{
+  const char* functionName = "restoreParams";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u\n", driverName, functionName,amsPort);
+
+  bool restoreDone=true;
+  for(int i=1; i<adsParamArrayCount_;i++){  //Skip first param since used for motorrecord or stream device
+    adsParamInfo *paramInfo=pAdsParamArray_[i];
+    if(!paramInfo || paramInfo->amsPort!=amsPort || !paramInfo->refreshNeeded){
+      continue;
+    }
+    if(paramInfo->dataSource!=ADS_DATASOURCE_PLC){
+      paramInfo->refreshNeeded=false;
+      continue;
+    }
+    // Notification params subscribe again (bulk reads, chunked polls and
+    // shared subscriptions are fed by the bulk read thread or another param)
+    asynStatus status=asynSuccess;
+    if(paramInfo->isIOIntr && paramInfo->bulkIndex<0 && !paramInfo->isChunkedPoll &&
+       paramInfo->sharedLeader<0){
+      adsDelDataCallback(paramInfo,true);  //try to delete
+      status=adsAddDataCallback(paramInfo);
+    }
+    if(status==asynSuccess){
+      paramInfo->refreshNeeded=false;
+    }
+    else if(updateParamInfoWithPLCInfo(paramInfo)!=asynSuccess && !paramInfo->symbolMissing){
+      restoreDone=false;
+    }
+  }
+
+  // Bulk reads keep their handles, only the read size was reset by invalidateParams()
+  adsLock(ADS_LANE_SUBSCRIPTION);
+  for (int i = 0; i < MAXBULK; i++) {
+      if (bulk[i].cnt == 0)
+          break;
+      if (bulk[i].amsPort == amsPort)
+          adsUpdateBulkPlan(i);
+  }
+  adsUnlock();
+
+  amsPortInfo *port=getAmsPortObject(amsPort);
+  if(port && port->refreshNeeded){
+    if(port->bCallbackNotifyValid){
+      adsDelSymbolsChangedCallback(port);
+    }
+    adsAddSymbolsChangedCallback(port);
+  }
+
+  adsRefreshBulkTimeStamps(amsPort);
+  bulkOK = 1;
+  return restoreDone ? asynSuccess : asynError;
+}
+
+/** Connects to a PLC (with asyn lock()).
+ * \param[in] pasynUser Asyn user
+ * \return asynSuccess or asynError.
+ * Thread safe.
+ */
+asynStatus adsAsynPortDriver::connectLock(asynUser *pasynUser)
+{
+  lock();
+  asynStatus stat=connect(pasynUser);
+  unlock();
+  return stat;
+}
+
+/** Connects to a PLC.
+ * \param[in] pasynUser Asyn user
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::connect(asynUser *pasynUser)
+{
+  const char* functionName = "connect";
+  asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s: %s\n", driverName, functionName, epicsThreadGetNameSelf());
+
+  bool err=false;
+  asynStatus stat = adsConnect();
+
+  if (stat!= asynSuccess){
+    return asynError;
+  }
+
+  if(asynPortDriver::connect(pasynUser)!=asynSuccess){
+    return asynError;
+  }
+
+  connectedAds_=1;
+  return err ? asynError : asynSuccess;
 }
 
 /** Validates drvInfo string
@@ -957,7 +1795,6 @@ asynStatus adsAsynPortDriver::validateDrvInfo(const char *drvInfo)
 asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvInfo,const char **pptypeName,size_t *psize)
 {
   const char* functionName = "drvUserCreate";
-  static int vcnt = 0;
 
   asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s: drvInfo: %s\n", driverName, functionName,drvInfo);
 
@@ -966,7 +1803,7 @@ asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvI
   }
 
   int index=0;
-  asynStatus status=findParam(drvInfo,&index);
+  asynStatus status=findParamIndex(drvInfo,&index);
   if(status==asynSuccess){
     asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s: Parameter index found at: %d for %s. \n", driverName, functionName,index,drvInfo);
     if(!pAdsParamArray_[index]){
@@ -974,29 +1811,22 @@ asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvI
       return asynError;
     }
 
-    if(pAdsParamArray_[index]->dataSource==ADS_DATASOURCE_AMS_STATE){ //Local variable (not in PLC) like AMS port state.
-
-      return asynPortDriver::drvUserCreate(pasynUser,drvInfo,pptypeName,psize);
-    }
-
-    if(!connectedAds_){
-      //try to connect without error handling
-      connect(pasynUser);
-    }
-
-    if(connectedAds_){
-      status =adsReadParam(pAdsParamArray_[index]);
-      if(status!=asynSuccess){
-        return asynError;
-      }
-    }
-    return asynPortDriver::drvUserCreate(pasynUser,drvInfo,pptypeName,psize);
+    // Same parameter as an earlier record (or a local variable like the AMS
+    // port state). Value and alarm are already set, or set by connectThread()
+    // when the parameter is resolved.
+    pasynUser->reason=index;
+    return asynSuccess;
   }
 
-  if (!vcnt++)
+  if (!linkCount_++) {
       printf("Linking EPICS PVs to PLC variables...\n");
-  if (vcnt % 1000 == 0)
-      printf("%d...\n", vcnt);
+      gettimeofday(&linkStart_, NULL);
+  }
+  if (linkCount_ % 1000 == 0) {
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      printf("%d... (%.3lf s, %.3lf s in createParam)\n", linkCount_, (now.tv_sec - linkStart_.tv_sec) + (now.tv_usec - linkStart_.tv_usec) / 1E6, linkCreateParamS_);
+  }
 
   //Ensure space left in param table
   if(adsParamArrayCount_>=(paramTableSize_-1)){
@@ -1007,18 +1837,32 @@ asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvI
   // Collect data from drvInfo string and recordpasynUser->reason=index;
   adsParamInfo *paramInfo=new adsParamInfo();
   memset(paramInfo,0,sizeof(adsParamInfo));
+  // Hot data is staged here and moved to pAdsParamHot_ when the parameter is registered
+  adsParamHot hotStaging;
+  memset(&hotStaging,0,sizeof(adsParamHot));
+  paramInfo->hot=&hotStaging;
+  paramInfo->hot->stats=new adsParamStats();
   paramInfo->sampleTimeMS=defaultSampleTimeMS_;
   paramInfo->maxDelayTimeMS=defaultMaxDelayTimeMS_;
   paramInfo->refreshNeeded=1;
   paramInfo->bulkIndex = -1;
   paramInfo->bulkOffset = -1;
+  paramInfo->sharedLeader = -1;
 
   status=getRecordInfoFromDrvInfo(drvInfo, paramInfo);
   if(status!=asynSuccess){
     return asynError;
   }
 
+  // Still linear in the number of parameters (quadratic over startup): asyn
+  // checks for duplicate names by walking all existing parameters. This
+  // cannot be avoided from the driver, shorter names do not help since the
+  // cost is the walk, not the compare. Timed to show its share.
+  struct timeval createStart, createEnd;
+  gettimeofday(&createStart, NULL);
   status=createParam(drvInfo,paramInfo->asynType,&index);
+  gettimeofday(&createEnd, NULL);
+  linkCreateParamS_ += (createEnd.tv_sec - createStart.tv_sec) + (createEnd.tv_usec - createStart.tv_usec) / 1E6;
   if(status!=asynSuccess){
     asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: createParam() failed.",driverName, functionName);
     return asynError;
@@ -1043,6 +1887,7 @@ asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvI
   }
 
   paramInfo->paramIndex=index;
+  paramInfo->hot->paramIndex=index;
 
   int addr=0;
   status = getAddress(pasynUser, &addr);
@@ -1052,6 +1897,7 @@ asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvI
   }
 
   paramInfo->asynAddr=addr;
+  paramInfo->hot->asynAddr=addr;
 
   status=parsePlcInfofromDrvInfo(drvInfo,paramInfo);
   if(status!=asynSuccess){
@@ -1059,21 +1905,66 @@ asynStatus adsAsynPortDriver::drvUserCreate(asynUser *pasynUser,const char *drvI
   }
   pasynUser->timeout=(paramInfo->maxDelayTimeMS*2)/1000;
 
+  // Locked since connectThread() may refresh params at the same time
+  lock();
+  pAdsParamHot_[adsParamArrayCount_]=hotStaging;
+  paramInfo->hot=&pAdsParamHot_[adsParamArrayCount_];
+  paramInfo->hot->info=paramInfo;
   pAdsParamArray_[adsParamArrayCount_]=paramInfo;
   adsParamArrayCount_++;
+  paramIndexMap_[drvInfo]=index;
 
-  if(!connectedAds_){
-    //try to connect without error handling
-    connect(pasynUser);
+  if(paramInfo->dataSource==ADS_DATASOURCE_PLC){  //Do not read info from PLC if local variable (like ams-port state)
+    if(!connectedAds_){
+      //Resolved by connectThread() when connected
+      paramInfo->refreshNeeded=true;
+      setAlarmParam(paramInfo,COMM_ALARM,INVALID_ALARM);
+    }
+    else if(symbolCacheLookup(paramInfo) && paramInfo->isIOIntr){
+      //Handle, subscription and bulk read are made in batches before scan init (getEpicsState())
+      paramInfo->refreshNeeded=true;
+    }
+    else{
+      status=updateParamInfoWithPLCInfo(paramInfo);
+      paramInfo->symInfoPrefetched=false;
+      if(status!=asynSuccess){
+        //PLC not in RUN or symbol missing: retried by connectThread()
+        paramInfo->refreshNeeded=true;
+        setAlarmParam(paramInfo,COMM_ALARM,INVALID_ALARM);
+        amsPortInfo *port=getAmsPortObject(paramInfo->amsPort);
+        if(port){
+          port->refreshNeeded=true;
+        }
+      }
+    }
   }
+  if(paramInfo->dataSource>=ADS_DATASOURCE_WRITE_BEHIND_SENT){
+    writeBehindStatsParams_.push_back(paramInfo);
+    adsPublishWriteBehindStats();
+  }
+  unlock();
+  pasynUser->reason=index;
+  return asynSuccess;
+}
 
-  if(connectedAds_ && !(paramInfo->dataSource==ADS_DATASOURCE_AMS_STATE)){  //Do not read info from PLC if local variable (like ams-port state)
-    status=updateParamInfoWithPLCInfo(paramInfo);
-    if(status!=asynSuccess){
-      return asynError;
-    }
+/** Find parameter index of a drvInfo string (replaces the linear
+ * asynPortDriver::findParam() in drvUserCreate()).
+ * \param[in] drvInfo String containing information about the parameter.
+ * \param[out] index Parameter index.
+ * \return asynSuccess or asynParamNotFound.
+ * Thread safe.
+ */
+asynStatus adsAsynPortDriver::findParamIndex(const char *drvInfo,int *index)
+{
+  asynStatus status=asynParamNotFound;
+  lock();
+  std::unordered_map<std::string,int>::const_iterator it=paramIndexMap_.find(drvInfo);
+  if(it!=paramIndexMap_.end()){
+    *index=it->second;
+    status=asynSuccess;
   }
-  return asynPortDriver::drvUserCreate(pasynUser,drvInfo,pptypeName,psize); //Assigns pasynUser->reason;
+  unlock();
+  return status;
 }
 
 /** Update parameter with info from PLC (variable size, type and abs addr).
@@ -1095,8 +1986,8 @@ asynStatus adsAsynPortDriver::updateParamInfoWithPLCInfo(adsParamInfo *paramInfo
     return asynSuccess;
   }
 
-  // Read symbolic information if needed (to get paramInfo->plcSize)
-  if(!paramInfo->isAdrCommand){
+  // Read symbolic information if needed (to get paramInfo->hot->plcSize)
+  if(!paramInfo->isAdrCommand && !paramInfo->symInfoPrefetched){
     status=adsGetSymInfoByName(paramInfo);
     if(status!=asynSuccess){
       return asynError;
@@ -1122,30 +2013,58 @@ asynStatus adsAsynPortDriver::updateParamInfoWithPLCInfo(adsParamInfo *paramInfo
       isArray=false;
       break;
     default:
-      isArray=paramInfo->plcSize>adsTypeSize(paramInfo->plcDataType);
+      isArray=paramInfo->hot->plcSize>adsTypeSize(paramInfo->plcDataType);
       break;
   }
-  paramInfo->plcDataIsArray=isArray;
+  paramInfo->hot->plcDataIsArray=isArray;
 
-  // Allocate memory for array
-  if(isArray){
-    if(paramInfo->plcSize!=paramInfo->arrayDataBufferSize && paramInfo->arrayDataBuffer){ //new size of array
-      free(paramInfo->arrayDataBuffer);
-      paramInfo->arrayDataBuffer=NULL;
+  // Type combination is fixed from here (reported once if not supported)
+  selectConversionKernels(paramInfo);
+
+  // Allocate array store (data in EPICS representation)
+  size_t storeSize=0;
+  if(isArray && paramInfo->arrayEpicsType!=ADST_VOID){
+    storeSize=paramInfo->hot->plcSize;
+    if(paramInfo->arrayReadKernel){
+      storeSize=paramInfo->hot->plcSize/paramInfo->plcElementSize*adsTypeSize(paramInfo->arrayEpicsType);
     }
-    if(!paramInfo->arrayDataBuffer){
-      paramInfo->arrayDataBuffer = calloc(paramInfo->plcSize,1);
-      paramInfo->arrayDataBufferSize=paramInfo->plcSize;
-      if(!paramInfo->arrayDataBuffer){
+  }
+  // The notification, bulk read or chunked poll thread may still publish to
+  // the old store (without port lock), so it is retired and freed later.
+  adsArrayStore *oldStore=paramInfo->hot->arrayStore;
+  if(!oldStore || oldStore->size!=storeSize){ //new size of array
+    adsArrayStore *newStore=NULL;
+    if(storeSize>0){
+      newStore=adsArrayStoreCreate(storeSize);
+      if(!newStore){
         asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to allocate memory for array data for %s.\n.", driverName, functionName,paramInfo->drvInfo);
-        unlock();
         return asynError;
       }
-      memset(paramInfo->arrayDataBuffer,0,paramInfo->plcSize);
+    }
+    paramInfo->hot->arrayStore=newStore;
+    if(oldStore){
+      retiredArrayStores_.push_back(oldStore);
+    }
+    adsFreeRetiredArrayStores();
+  }
+
+  // Allocate buffer for array write conversions (EPICS type != PLC type)
+  size_t convSize=paramInfo->arrayWriteKernel ? paramInfo->hot->plcSize : 0;
+  if(convSize!=paramInfo->arrayConvBufferSize){
+    free(paramInfo->arrayConvBuffer);
+    paramInfo->arrayConvBuffer=NULL;
+    paramInfo->arrayConvBufferSize=0;
+    if(convSize>0){
+      paramInfo->arrayConvBuffer=calloc(convSize,1);
+      if(!paramInfo->arrayConvBuffer){
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to allocate memory for array conversion for %s.\n", driverName, functionName,paramInfo->drvInfo);
+        return asynError;
+      }
+      paramInfo->arrayConvBufferSize=convSize;
     }
   }
 
-  if (!paramInfo->isAdrCommand) {
+  if (!paramInfo->isAdrCommand && !paramInfo->symHandlePrefetched) {
       adsReleaseSymbolicHandle(paramInfo,true); //try to delete
       status=adsGetSymHandleByName(paramInfo);
       if(status!=asynSuccess){
@@ -1154,8 +2073,24 @@ asynStatus adsAsynPortDriver::updateParamInfoWithPLCInfo(adsParamInfo *paramInfo
   }
 
   if(paramInfo->isIOIntr){
+      /* Same PLC variable as another parameter: use its subscription */
+      bool chunkedPoll = adsUseChunkedPoll(paramInfo);
+      if (!chunkedPoll)
+          adsRemoveFromChunkedPoll(paramInfo);
+      if (adsShareSubscription(paramInfo)) {
+          if (paramInfo->bCallbackNotifyValid)
+              adsDelDataCallback(paramInfo,true);
+      }
+      /* If it's larger than a chunk (and enabled), poll it chunk by chunk! */
+      else if (chunkedPoll) {
+          adsDelDataCallback(paramInfo,true);   //try to delete
+          status=adsAddToChunkedPoll(paramInfo);
+          if(status!=asynSuccess){
+              return asynError;
+          }
+      }
       /* If it's not a bulk read or if it's really big, just subscribe to it! */
-      if (!paramInfo->isBulkRead || paramInfo->plcSize > 1024*1024) {
+      else if (!paramInfo->isBulkRead || paramInfo->hot->plcSize > 1024*1024) {
           adsDelDataCallback(paramInfo,true);   //try to delete
           status=adsAddDataCallback(paramInfo);
           if(status!=asynSuccess){
@@ -1169,7 +2104,12 @@ asynStatus adsAsynPortDriver::updateParamInfoWithPLCInfo(adsParamInfo *paramInfo
       }
   }
 
-  // Make first read
+  // Make first read. Not needed for I/O Intr params resolved in a batch,
+  // the value comes with the first notification, bulk read or chunked poll.
+  if(paramInfo->isIOIntr && paramInfo->symHandlePrefetched){
+    paramInfo->refreshNeeded=false;
+    return asynSuccess;
+  }
   long errorCode=0;
   status = adsReadParam(paramInfo,&errorCode,0);
   if(status!=asynSuccess){
@@ -1185,93 +2125,1182 @@ asynStatus adsAsynPortDriver::updateParamInfoWithPLCInfo(adsParamInfo *paramInfo
   return asynSuccess;
 }
 
-void adsAsynPortDriver::poll_info(char *name)
+/*
+ * Conversion kernels. One instance per PLC/asyn type combination. The
+ * kernel for a parameter is selected once in selectConversionKernels()
+ * so that the update and write paths only do an indirect call.
+ * PLC data is copied with memcpy() since it is not guaranteed to be aligned
+ * (sum read buffers).
+ */
+template<typename PLCTYPE>
+static asynStatus updateInt32Kernel(adsAsynPortDriver *driver,adsParamHot *hot,const void *data)
 {
-    int i;
-    printf("Bulk read loop: desired period = %gs, last loop time = %gs\n", bulk_delay_us / 1000000.0, bulk_elapsed_us / 1000000.0);
-    for (i = 0; bulk[i].cnt && i < MAXBULK; i++);
-    printf("Bulk read count = %d\n", i);
-    if (name[0] == 0)
-        name = 0;
-    for (i = 0; bulk[i].cnt && i < MAXBULK; i++) {
-      printf("Bulk Read #%d:\n", i);
-      if (!name) {
-          printf("    0: MAIN.fbSystemTime.timeLoDW (G=0x%x, O=0x%x, S=%d)\n",
-                 bulk[i].sum[0].iGroup, bulk[i].sum[0].iOffset, bulk[i].sum[0].iSize);
-          printf("    1: MAIN.fbSystemTime.timeHiDW (G=0x%x, O=0x%x, S=%d)\n",
-                 bulk[i].sum[1].iGroup, bulk[i].sum[1].iOffset, bulk[i].sum[1].iSize);
-      }
-      for (int j = 2; j < bulk[i].cnt; j++) {
-        adsParamInfo *paramInfo=getAdsParamInfo(bulk[i].paramID[j]);
-        if (!paramInfo)
-          continue;
-        if (!name || strstr(paramInfo->plcAdrStr, name))
-            printf("  %3d: %s (G=0x%x, O=0x%x, S=%d, TS=%d.%09d)\n", j, paramInfo->plcAdrStr,
-                   bulk[i].sum[j].iGroup, bulk[i].sum[j].iOffset, bulk[i].sum[j].iSize,
-                   paramInfo->epicsTimestamp.secPastEpoch, paramInfo->epicsTimestamp.nsec);
-      }
-    }
+  PLCTYPE value;
+  memcpy(&value,data,sizeof(value));
+  return driver->setIntegerParam(hot->paramIndex,(epicsInt32)value);
 }
 
-/* TBD - Use paramInfo->pollClass to separate into different poll rates!! */
-asynStatus adsAsynPortDriver::adsAddToBulkRead(adsParamInfo* paramInfo)
+#ifndef NO_ADS_ASYN_ASYNPARAMINT64
+template<typename PLCTYPE>
+static asynStatus updateInt64Kernel(adsAsynPortDriver *driver,adsParamHot *hot,const void *data)
 {
-    adsLock(); // Prevent reads while we change this!
-    if (paramInfo->bulkIndex < 0) { /* Not assigned yet, find one! */
-        int i;
-        for (i = 0; i < MAXBULK; i++) {
-            /* Look for an unused entry or a non-full entry for this port. */
-            if (bulk[i].cnt == 0 || (bulk[i].cnt != BULKSIZ &&
-                                     bulk[i].amsPort == paramInfo->amsPort))
-                break;
-        }
-        if (i == MAXBULK) {
-            adsUnlock();
-            return asynError; // No room at the inn.
-        }
-        if (!bulk[i].cnt) { // First variable in this bulk request!
-            bulk[i].amsPort = paramInfo->amsPort;
-            int j = adsFindBulkTimeStamp(paramInfo->amsPort);
-            if (bulkTS[j].refreshNeeded) { /* No TS variables!! */
-                bulk[i].sum[0].iGroup  = 0x4020; // %M
-                bulk[i].sum[0].iOffset = 0;
-                bulk[i].sum[0].iSize   = sizeof(uint32_t);
-                bulk[i].sum[1].iGroup  = 0x4020; // %M
-                bulk[i].sum[1].iOffset = 0;
-                bulk[i].sum[1].iSize   = sizeof(uint32_t);
-            } else {
-                bulk[i].sum[0].iGroup  = ADSIGRP_SYM_VALBYHND;
-                bulk[i].sum[0].iOffset = bulkTS[j].iHandleH;
-                bulk[i].sum[0].iSize   = sizeof(uint32_t);
-                bulk[i].sum[1].iGroup  = ADSIGRP_SYM_VALBYHND;
-                bulk[i].sum[1].iOffset = bulkTS[j].iHandleL;
-                bulk[i].sum[1].iSize   = sizeof(uint32_t);
-            }
-            bulk[i].cnt = 2;
-            bulk[i].readSize = 4 * sizeof(uint32_t);
-        }
-        paramInfo->bulkIndex  = i;
-        paramInfo->bulkOffset = bulk[i].cnt;
-        bulk[i].paramID[bulk[i].cnt++] = paramInfo->paramIndex;
-    }
-    /* Update the information for a previously allocated element.  Possibly *just*
-       allocated, but that's still previously! */
-    uint32_t group, offset;
-    if (paramInfo->isAdrCommand) {
-        group = paramInfo->plcAbsAdrGroup;
-        offset = paramInfo->plcAbsAdrOffset;
-    } else {
-        group = ADSIGRP_SYM_VALBYHND;
-        offset = paramInfo->hSymbolicHandle;
+  PLCTYPE value;
+  memcpy(&value,data,sizeof(value));
+  return driver->setInteger64Param(hot->paramIndex,(epicsInt64)value);
+}
+#endif
+
+template<typename PLCTYPE>
+static asynStatus updateFloat64Kernel(adsAsynPortDriver *driver,adsParamHot *hot,const void *data)
+{
+  PLCTYPE value;
+  memcpy(&value,data,sizeof(value));
+  return driver->setDoubleParam(hot->paramIndex,(epicsFloat64)value);
+}
+
+// Arrays: data is already in hot->arrayStore (see adsPublishArray())
+static asynStatus updateArrayKernel(adsAsynPortDriver *driver,adsParamHot *hot,const void *data)
+{
+  return asynSuccess;
+}
+
+static asynStatus callbackScalarKernel(adsAsynPortDriver *driver,adsParamHot *hot,size_t nBytes)
+{
+  return driver->callParamCallbacks();
+}
+
+static asynStatus doArrayCallbacks(adsAsynPortDriver *driver,epicsInt8 *value,size_t nElements,int reason,int addr)
+{
+  return driver->doCallbacksInt8Array(value,nElements,reason,addr);
+}
+
+static asynStatus doArrayCallbacks(adsAsynPortDriver *driver,epicsInt16 *value,size_t nElements,int reason,int addr)
+{
+  return driver->doCallbacksInt16Array(value,nElements,reason,addr);
+}
+
+static asynStatus doArrayCallbacks(adsAsynPortDriver *driver,epicsInt32 *value,size_t nElements,int reason,int addr)
+{
+  return driver->doCallbacksInt32Array(value,nElements,reason,addr);
+}
+
+static asynStatus doArrayCallbacks(adsAsynPortDriver *driver,epicsFloat32 *value,size_t nElements,int reason,int addr)
+{
+  return driver->doCallbacksFloat32Array(value,nElements,reason,addr);
+}
+
+static asynStatus doArrayCallbacks(adsAsynPortDriver *driver,epicsFloat64 *value,size_t nElements,int reason,int addr)
+{
+  return driver->doCallbacksFloat64Array(value,nElements,reason,addr);
+}
+
+// Arrays: callbacks directly from the latest published buffer in the array store
+template<typename EPICSTYPE>
+static asynStatus callbackArrayKernel(adsAsynPortDriver *driver,adsParamHot *hot,size_t nBytes)
+{
+  if(nBytes<=0 || !hot->arrayStore){
+    return asynSuccess;
+  }
+  size_t bytesUsed=0;
+  EPICSTYPE *data=(EPICSTYPE *)adsArrayStoreReadLock(hot->arrayStore,&bytesUsed);
+  asynStatus stat=doArrayCallbacks(driver,data,bytesUsed/sizeof(EPICSTYPE),hot->paramIndex,hot->asynAddr);
+  adsArrayStoreReadUnlock(hot->arrayStore);
+  return stat;
+}
+
+template<typename PLCTYPE,typename EPICSTYPE>
+static uint32_t writeKernel(const void *epicsValue,void *plcBuffer)
+{
+  PLCTYPE value=(PLCTYPE)(*(const EPICSTYPE*)epicsValue);
+  memcpy(plcBuffer,&value,sizeof(value));
+  return sizeof(value);
+}
+
+template<typename EPICSTYPE>
+static uint32_t writeBitKernel(const void *epicsValue,void *plcBuffer)
+{
+  *(uint8_t*)plcBuffer=(*(const EPICSTYPE*)epicsValue)>0;
+  return 1;
+}
+
+template<typename PLCTYPE>
+static adsUpdateKernel selectUpdateKernel(asynParamType asynType)
+{
+  switch(asynType){
+    case asynParamInt32:
+      return updateInt32Kernel<PLCTYPE>;
+#ifndef NO_ADS_ASYN_ASYNPARAMINT64
+    case asynParamInt64:
+      return updateInt64Kernel<PLCTYPE>;
+#endif
+    case asynParamFloat64:
+      return updateFloat64Kernel<PLCTYPE>;
+    default:
+      return NULL;
+  }
+}
+
+template<typename PLCTYPE>
+static void selectWriteKernels(adsParamInfo *paramInfo)
+{
+  paramInfo->writeInt32Kernel=writeKernel<PLCTYPE,epicsInt32>;
+  paramInfo->writeFloat64Kernel=writeKernel<PLCTYPE,epicsFloat64>;
+}
+
+/** Select conversion kernels for a parameter (PLC type <-> asyn type).
+ * Called once the PLC data type is known. Unsupported combinations are
+ * reported here (once) and the kernels are left NULL.
+ * \param[in/out] paramInfo Parameter information structure.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::selectConversionKernels(adsParamInfo *paramInfo)
+{
+  const char* functionName = "selectConversionKernels";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %s\n", driverName, functionName,paramInfo->drvInfo);
+
+  paramInfo->hot->updateKernel=NULL;
+  paramInfo->hot->callbackKernel=callbackScalarKernel;
+  paramInfo->writeInt32Kernel=NULL;
+  paramInfo->writeFloat64Kernel=NULL;
+  paramInfo->arrayReadKernel=NULL;
+  paramInfo->arrayWriteKernel=NULL;
+  paramInfo->arrayEpicsType=asynArrayTypeToAdsType(paramInfo->asynType);
+  paramInfo->plcElementSize=adsTypeSize(paramInfo->plcDataType);
+
+  switch(paramInfo->plcDataType){
+    case ADST_INT8:
+      paramInfo->hot->updateKernel=selectUpdateKernel<int8_t>(paramInfo->asynType);
+      selectWriteKernels<int8_t>(paramInfo);
+      break;
+    case ADST_INT16:
+      paramInfo->hot->updateKernel=selectUpdateKernel<int16_t>(paramInfo->asynType);
+      selectWriteKernels<int16_t>(paramInfo);
+      break;
+    case ADST_INT32:
+      paramInfo->hot->updateKernel=selectUpdateKernel<int32_t>(paramInfo->asynType);
+      selectWriteKernels<int32_t>(paramInfo);
+      break;
+    case ADST_INT64:
+      paramInfo->hot->updateKernel=selectUpdateKernel<int64_t>(paramInfo->asynType);
+      selectWriteKernels<int64_t>(paramInfo);
+      break;
+    case ADST_UINT8:
+      paramInfo->hot->updateKernel=selectUpdateKernel<uint8_t>(paramInfo->asynType);
+      selectWriteKernels<uint8_t>(paramInfo);
+      break;
+    case ADST_UINT16:
+      paramInfo->hot->updateKernel=selectUpdateKernel<uint16_t>(paramInfo->asynType);
+      selectWriteKernels<uint16_t>(paramInfo);
+      break;
+    case ADST_UINT32:
+      paramInfo->hot->updateKernel=selectUpdateKernel<uint32_t>(paramInfo->asynType);
+      selectWriteKernels<uint32_t>(paramInfo);
+      break;
+    case ADST_UINT64:
+      paramInfo->hot->updateKernel=selectUpdateKernel<uint64_t>(paramInfo->asynType);
+      selectWriteKernels<uint64_t>(paramInfo);
+      break;
+    case ADST_REAL32:
+      paramInfo->hot->updateKernel=selectUpdateKernel<float>(paramInfo->asynType);
+      selectWriteKernels<float>(paramInfo);
+      break;
+    case ADST_REAL64:
+      paramInfo->hot->updateKernel=selectUpdateKernel<double>(paramInfo->asynType);
+      selectWriteKernels<double>(paramInfo);
+      break;
+    case ADST_BIT:
+      paramInfo->hot->updateKernel=selectUpdateKernel<int8_t>(paramInfo->asynType);
+      paramInfo->writeInt32Kernel=writeBitKernel<epicsInt32>;
+      paramInfo->writeFloat64Kernel=writeBitKernel<epicsFloat64>;
+      break;
+    default:
+      break;
+  }
+
+  // Arrays. Other element type than in PLC is converted (not STRING)
+  if(paramInfo->arrayEpicsType!=ADST_VOID){
+    bool identical=adsArrayTypesIdentical(paramInfo->plcDataType,paramInfo->arrayEpicsType);
+    if(!identical){
+      paramInfo->arrayReadKernel=adsGetArrayConvertKernel(paramInfo->plcDataType,paramInfo->arrayEpicsType);
+      paramInfo->arrayWriteKernel=adsGetArrayConvertKernel(paramInfo->arrayEpicsType,paramInfo->plcDataType);
+    }
+    if(identical || (paramInfo->arrayReadKernel && paramInfo->arrayWriteKernel)){
+      paramInfo->hot->updateKernel=updateArrayKernel;
+      if(paramInfo->hot->plcDataIsArray){
+        switch(paramInfo->asynType){
+          case asynParamInt8Array:
+            paramInfo->hot->callbackKernel=callbackArrayKernel<epicsInt8>;
+            break;
+          case asynParamInt16Array:
+            paramInfo->hot->callbackKernel=callbackArrayKernel<epicsInt16>;
+            break;
+          case asynParamInt32Array:
+            paramInfo->hot->callbackKernel=callbackArrayKernel<epicsInt32>;
+            break;
+          case asynParamFloat32Array:
+            paramInfo->hot->callbackKernel=callbackArrayKernel<epicsFloat32>;
+            break;
+          case asynParamFloat64Array:
+            paramInfo->hot->callbackKernel=callbackArrayKernel<epicsFloat64>;
+            break;
+          default:
+            break;
+        }
+      }
+    }
+  }
+
+  if(!paramInfo->hot->updateKernel){
+    paramInfo->hot->callbackKernel=NULL;
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported for %s. PLC type = %s, ASYN type= %s\n", driverName, functionName,paramInfo->drvInfo,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
+    return asynError;
+  }
+
+  // Warning. Risk of loss of data..
+  size_t epicsSize=0;
+  switch(paramInfo->asynType){
+    case asynParamInt32:
+      epicsSize=sizeof(epicsInt32);
+      break;
+    case asynParamFloat64:
+      epicsSize=sizeof(epicsFloat64);
+      break;
+    default:
+      break;
+  }
+  paramInfo->plcDataTypeWarn=epicsSize>paramInfo->hot->plcSize;
+  if(paramInfo->plcDataTypeWarn){
+    asynPrint(pasynUserSelf, ASYN_TRACE_WARNING, "%s:%s: WARNING. EPICS datatype size larger than PLC datatype size for %s (%lu vs %u bytes).\n", driverName,functionName,paramInfo->drvInfo,(unsigned long)epicsSize,paramInfo->hot->plcSize);
+  }
+
+  return asynSuccess;
+}
+
+void adsAsynPortDriver::poll_info(char *name)
+{
+    int i;
+    printf("Bulk read loop: desired period = %gs, last loop time = %gs\n", bulk_delay_us / 1000000.0, bulk_elapsed_us / 1000000.0);
+    for (i = 0; bulk[i].cnt && i < MAXBULK; i++);
+    printf("Bulk read count = %d\n", i);
+    adsLock(ADS_LANE_SUBSCRIPTION);
+    std::vector<int> chunked = chunkedPollList_;
+    adsUnlock();
+    printf("Chunked poll count = %lu (chunk size %u bytes%s)\n", (unsigned long)chunked.size(), chunkSize_,
+           chunkedPoll_ ? "" : ", chunked poll disabled");
+    if (name[0] == 0)
+        name = 0;
+    for (int paramIndex : chunked) {
+        adsParamInfo *paramInfo=getAdsParamInfo(paramIndex);
+        if (!paramInfo)
+            continue;
+        uint32_t chunksDone, chunksTotal;
+        adsGetChunkProgress(paramInfo, &chunksDone, &chunksTotal);
+        if (!name || strstr(paramInfo->plcAdrStr, name))
+            printf("  Chunked: %s (G=0x%x, O=0x%x, S=%d, chunks=%u/%u)\n", paramInfo->plcAdrStr,
+                   paramInfo->plcAbsAdrGroup, paramInfo->plcAbsAdrOffset, paramInfo->hot->plcSize,
+                   chunksDone, chunksTotal);
+    }
+    for (i = 0; bulk[i].cnt && i < MAXBULK; i++) {
+      printf("Bulk Read #%d (ams-port %u%s):\n", i, bulk[i].amsPort,
+             bulk[i].tsSlots ? "" : ", time stamp from first read of port");
+      if (!name && bulk[i].tsSlots) {
+          printf("    0: MAIN.fbSystemTime.timeHiDW (G=0x%x, O=0x%x, S=%d)\n",
+                 bulk[i].sum[0].iGroup, bulk[i].sum[0].iOffset, bulk[i].sum[0].iSize);
+          printf("    1: MAIN.fbSystemTime.timeLoDW (G=0x%x, O=0x%x, S=%d)\n",
+                 bulk[i].sum[1].iGroup, bulk[i].sum[1].iOffset, bulk[i].sum[1].iSize);
+      }
+      for (int j = bulk[i].tsSlots; j < bulk[i].cnt; j++) {
+        adsParamInfo *paramInfo=getAdsParamInfo(bulk[i].paramID[j]);
+        if (!paramInfo)
+          continue;
+        if (!name || strstr(paramInfo->plcAdrStr, name))
+            printf("  %3d: %s (G=0x%x, O=0x%x, S=%d, TS=%d.%09d)\n", j, paramInfo->plcAdrStr,
+                   bulk[i].sum[j].iGroup, bulk[i].sum[j].iOffset, bulk[i].sum[j].iSize,
+                   paramInfo->hot->epicsTimestamp.secPastEpoch, paramInfo->hot->epicsTimestamp.nsec);
+      }
+    }
+}
+
+/** Print the parameters with most traffic and traffic per ams port.
+ * \param[in] count Number of parameters to print.
+ * \param[in] order "rate" (updates per second) or "bytes".
+ * \param[in] reset Reset counters after print.
+ */
+void adsAsynPortDriver::topTalkers(int count,const char *order,int reset)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  uint64_t nowUs=(uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+  double windowS=(nowUs-statsStartUs_)/1E6;
+  if(windowS<=0){
+    windowS=1E-6;
+  }
+  bool byBytes=order && strcmp(order,"bytes")==0;
+
+  std::vector<adsParamInfo*> params;
+  for(int i=1;i<adsParamArrayCount_;i++){
+    if(pAdsParamArray_[i] && pAdsParamArray_[i]->hot->stats){
+      params.push_back(pAdsParamArray_[i]);
+    }
+  }
+  std::sort(params.begin(),params.end(),[byBytes](adsParamInfo *a,adsParamInfo *b){
+    if(byBytes){
+      return a->hot->stats->bytes.load(std::memory_order_relaxed)>b->hot->stats->bytes.load(std::memory_order_relaxed);
+    }
+    return a->hot->stats->updates.load(std::memory_order_relaxed)>b->hot->stats->updates.load(std::memory_order_relaxed);
+  });
+
+  printf("Top %d parameters by %s (last %.1lf s):\n",count,byBytes ? "bytes" : "rate",windowS);
+  printf("  %10s %12s %10s %10s %8s %12s %12s %8s %8s %8s %6s  %s\n","rate[1/s]","bytes[b/s]","updates","callbacks","errors",
+         "last dt[ms]","max dt[ms]","notify","bulk","read","port","drvInfo");
+  for(int i=0;i<count && i<(int)params.size();i++){
+    adsParamStats *stats=params[i]->hot->stats;
+    uint64_t updates=stats->updates.load(std::memory_order_relaxed);
+    printf("  %10.1lf %12.0lf %10lu %10lu %8lu %12.1lf %12.1lf %8lu %8lu %8lu %6u  %s\n",
+           updates/windowS,
+           stats->bytes.load(std::memory_order_relaxed)/windowS,
+           (unsigned long)updates,
+           (unsigned long)stats->callbacks.load(std::memory_order_relaxed),
+           (unsigned long)stats->errors.load(std::memory_order_relaxed),
+           stats->lastIntervalUs.load(std::memory_order_relaxed)/1000.0,
+           stats->maxIntervalUs.load(std::memory_order_relaxed)/1000.0,
+           (unsigned long)stats->path[ADS_PATH_NOTIFICATION].load(std::memory_order_relaxed),
+           (unsigned long)stats->path[ADS_PATH_BULK].load(std::memory_order_relaxed),
+           (unsigned long)stats->path[ADS_PATH_READ].load(std::memory_order_relaxed),
+           params[i]->amsPort,params[i]->drvInfo);
+  }
+
+  printf("Per ams port:\n");
+  for(amsPortInfo *port : amsPortList_){
+    uint64_t updates=0,bytes=0,errors=0,paths[ADS_PATH_MAX]={0};
+    int paramCount=0;
+    for(adsParamInfo *paramInfo : params){
+      if(paramInfo->amsPort!=port->amsPort){
+        continue;
+      }
+      paramCount++;
+      updates+=paramInfo->hot->stats->updates.load(std::memory_order_relaxed);
+      bytes+=paramInfo->hot->stats->bytes.load(std::memory_order_relaxed);
+      errors+=paramInfo->hot->stats->errors.load(std::memory_order_relaxed);
+      for(int k=0;k<ADS_PATH_MAX;k++){
+        paths[k]+=paramInfo->hot->stats->path[k].load(std::memory_order_relaxed);
+      }
+    }
+    printf("  Ams-port %u: %d params, %.1lf updates/s, %.0lf bytes/s, %lu errors (notify %lu, bulk %lu, read %lu)\n",
+           port->amsPort,paramCount,updates/windowS,bytes/windowS,(unsigned long)errors,
+           (unsigned long)paths[ADS_PATH_NOTIFICATION],(unsigned long)paths[ADS_PATH_BULK],(unsigned long)paths[ADS_PATH_READ]);
+  }
+
+  if(reset){
+    for(adsParamInfo *paramInfo : params){
+      adsParamStatsReset(paramInfo->hot->stats);
+    }
+    statsStartUs_=nowUs;
+  }
+}
+
+/** Set maximum size of octet interface buffers (ASCII reply ring buffer and
+ * binary ADS buffer). Existing sessions are resized when next used.
+ * \param[in] size Size in bytes.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setOctetBufferSize(size_t size)
+{
+  const char* functionName = "setOctetBufferSize";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
+
+  if(size<ADS_CMD_BUFFER_SIZE){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Buffer size %lu too small (min %d bytes).\n", driverName, functionName,(unsigned long)size,ADS_CMD_BUFFER_SIZE);
+    return asynError;
+  }
+
+  std::lock_guard<std::mutex> guard(octetSessionMutex_);
+  octetBufferSize_=size;
+  return asynSuccess;
+}
+
+/** Set maximum number of bytes per ADS request for large arrays. Arrays
+ * larger than this are read and written in chunks. Applies to parameters
+ * connected after this call. Chunked writes are not atomic: the PLC may run
+ * cycles with only part of the new array written.
+ * \param[in] size Size in bytes (0 disables chunked transfers).
+ * \param[in] poll Poll large I/O Intr arrays in chunks instead of one
+ *                 on-change notification (changes update behaviour, off by
+ *                 default).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setChunkSize(uint32_t size,bool poll)
+{
+  const char* functionName = "setChunkSize";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %u (poll %d)\n", driverName, functionName,size,(int)poll);
+
+  chunkSize_=size;
+  chunkedPoll_=poll;
+  return asynSuccess;
+}
+
+/** Set link supervision period. One read state is made per period, the ads
+ * state of the ams ports is received by notification. The period is the
+ * detection latency of a lost link.
+ * \param[in] heartbeatMS Period in ms.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setHeartbeat(int heartbeatMS)
+{
+  const char* functionName = "setHeartbeat";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %d\n", driverName, functionName,heartbeatMS);
+
+  if(heartbeatMS<10){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Heartbeat period too short: %d ms (min 10 ms).\n", driverName, functionName,heartbeatMS);
+    return asynError;
+  }
+  heartbeatMS_=heartbeatMS;
+  epicsEventSignal(cyclicEvent_);
+  return asynSuccess;
+}
+
+/** Set explicit PLC time read. The PLC time is read periodically and fed
+ * to the PLC clock model, so that bulk reads get PLC time stamps also
+ * without PLC time variables and notifications. The read must return the
+ * PLC time as 8 byte Windows FILETIME (UTC).
+ * \param[in] periodMS Period in ms (0=disabled). Reads are made from
+ *                     cyclicThread() so the heartbeat period is the minimum.
+ * \param[in] amsPort Ams port (0=default, TwinCAT system service).
+ * \param[in] group Index group.
+ * \param[in] offset Index offset.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setClockRead(int periodMS,uint16_t amsPort,uint32_t group,uint32_t offset)
+{
+  const char* functionName = "setClockRead";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %d ms, ams-port %u, group 0x%x, offset 0x%x\n", driverName, functionName,periodMS,amsPort,group,offset);
+
+  if(periodMS<0){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Invalid period: %d ms.\n", driverName, functionName,periodMS);
+    return asynError;
+  }
+  clockReadMS_=periodMS;
+  if(amsPort){
+    clockReadAmsPort_=amsPort;
+    clockReadGroup_=group;
+    clockReadOffset_=offset;
+  }
+  else{
+    clockReadAmsPort_=ADS_CLOCK_READ_AMSPORT;
+    clockReadGroup_=ADS_CLOCK_READ_GROUP;
+    clockReadOffset_=ADS_CLOCK_READ_OFFSET;
+  }
+  clockReadNextNs_=0;
+  clockReadError_=0;
+  epicsEventSignal(cyclicEvent_);
+  return asynSuccess;
+}
+
+/** Set symbol cache file. The symbol info (address, size and data type) of
+ * all parameters is stored in the file after database initialization. At the
+ * next IOC start the info is taken from the file for ams ports with the same
+ * symbol version, so that only handles, subscriptions and bulk reads need to
+ * be created (in batches). Must be called before iocInit.
+ * \param[in] path File name.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setSymbolCache(const char *path)
+{
+  const char* functionName = "setSymbolCache";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %s\n", driverName, functionName,path);
+
+  unloadSymbolCache();
+  free(symbolCachePath_);
+  symbolCachePath_=strdup(path);
+  return loadSymbolCache();
+}
+
+/** Map the symbol cache file and build the index. A missing file is not an
+ * error (written after database initialization).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::loadSymbolCache()
+{
+  const char* functionName = "loadSymbolCache";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
+
+  int fd=open(symbolCachePath_,O_RDONLY);
+  if(fd<0){
+    asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: No symbol cache %s (%s). Created after iocInit.\n", driverName, functionName,symbolCachePath_,strerror(errno));
+    return asynSuccess;
+  }
+  struct stat st;
+  if(fstat(fd,&st)!=0 || (size_t)st.st_size<sizeof(adsSymbolCacheHeader)){
+    close(fd);
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Invalid symbol cache %s.\n", driverName, functionName,symbolCachePath_);
+    return asynError;
+  }
+  void *map=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(map==MAP_FAILED){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: mmap of %s failed (%s).\n", driverName, functionName,symbolCachePath_,strerror(errno));
+    return asynError;
+  }
+  symbolCacheMap_=map;
+  symbolCacheMapSize_=st.st_size;
+
+  const uint8_t *base=(const uint8_t *)map;
+  const adsSymbolCacheHeader *header=(const adsSymbolCacheHeader *)base;
+  size_t tableSize=sizeof(adsSymbolCacheHeader)+header->portCount*sizeof(adsSymbolCachePort)+
+                   (size_t)header->entryCount*sizeof(adsSymbolCacheEntry);
+  if(header->magic==ADS_SYMBOL_CACHE_MAGIC && header->format!=ADS_SYMBOL_CACHE_FORMAT){
+    asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Symbol cache %s has format %u (ignored, rewritten after iocInit).\n", driverName, functionName,symbolCachePath_,header->format);
+    unloadSymbolCache();
+    return asynSuccess;
+  }
+  if(header->magic!=ADS_SYMBOL_CACHE_MAGIC || tableSize>symbolCacheMapSize_){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Invalid symbol cache %s (ignored).\n", driverName, functionName,symbolCachePath_);
+    unloadSymbolCache();
+    return asynError;
+  }
+  if(memcmp(header->netId,remoteNetId_.b,sizeof(header->netId))!=0){
+    asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Symbol cache %s is for another Ams-net-id (ignored).\n", driverName, functionName,symbolCachePath_);
+    unloadSymbolCache();
+    return asynSuccess;
+  }
+
+  const adsSymbolCachePort *ports=(const adsSymbolCachePort *)(base+sizeof(adsSymbolCacheHeader));
+  for(uint16_t i=0;i<header->portCount;i++){
+    symbolCachePorts_[ports[i].amsPort]=ports[i];
+  }
+  const adsSymbolCacheEntry *entries=(const adsSymbolCacheEntry *)(ports+header->portCount);
+  for(uint32_t i=0;i<header->entryCount;i++){
+    if((size_t)entries[i].nameOffset+entries[i].nameLength>symbolCacheMapSize_){
+      continue;
+    }
+    std::string key=std::to_string(entries[i].amsPort)+":"+
+                    std::string((const char *)base+entries[i].nameOffset,entries[i].nameLength);
+    symbolCacheIndex_[key]=&entries[i];
+  }
+
+  asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Symbol cache %s: %lu symbols on %u ams ports.\n", driverName, functionName,symbolCachePath_,(unsigned long)symbolCacheIndex_.size(),(unsigned)header->portCount);
+  return asynSuccess;
+}
+
+/** Unmap the symbol cache file.
+ */
+void adsAsynPortDriver::unloadSymbolCache()
+{
+  symbolCacheIndex_.clear();
+  symbolCachePorts_.clear();
+  if(symbolCacheMap_){
+    munmap(symbolCacheMap_,symbolCacheMapSize_);
+  }
+  symbolCacheMap_=NULL;
+  symbolCacheMapSize_=0;
+}
+
+/** Fill in the symbol info of a parameter from the symbol cache. The
+ * symbol version of the ams port is checked once (one read) at the first
+ * lookup.
+ * \param[in/out] paramInfo Parameter information.
+ *
+ * \return true if found (symInfoPrefetched is set) otherwise false.
+ */
+bool adsAsynPortDriver::symbolCacheLookup(adsParamInfo *paramInfo)
+{
+  const char* functionName = "symbolCacheLookup";
+
+  if(symbolCacheIndex_.empty() || paramInfo->isAdrCommand){
+    return false;
+  }
+  amsPortInfo *port=getAmsPortObject(paramInfo->amsPort);
+  if(!port){
+    return false;
+  }
+  if(port->symbolCacheState==0){
+    adsSymbolCachePort key;
+    std::map<uint16_t,adsSymbolCachePort>::iterator it=symbolCachePorts_.find(port->amsPort);
+    port->symbolCacheState=-1;
+    if(it!=symbolCachePorts_.end() && adsReadSymbolCacheKey(port,&key)==asynSuccess &&
+       key.symVersion==it->second.symVersion && key.symCount==it->second.symCount &&
+       key.symSize==it->second.symSize){
+      port->symbolCacheState=1;
+    }
+    asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Symbol cache for Ams-port %u %s.\n", driverName, functionName,port->amsPort,port->symbolCacheState==1 ? "valid" : "not valid (symbols changed)");
+  }
+  if(port->symbolCacheState!=1){
+    return false;
+  }
+
+  std::map<std::string,const adsSymbolCacheEntry*>::iterator it=
+      symbolCacheIndex_.find(std::to_string(paramInfo->amsPort)+":"+paramInfo->plcAdrStr);
+  if(it==symbolCacheIndex_.end()){
+    return false;
+  }
+  const adsSymbolCacheEntry *entry=it->second;
+  paramInfo->plcAbsAdrGroup=entry->group;
+  paramInfo->plcAbsAdrOffset=entry->offset;
+  paramInfo->hot->plcSize=entry->size;
+  paramInfo->plcDataType=entry->dataType;
+  paramInfo->plcAbsAdrValid=true;
+  paramInfo->symInfoPrefetched=true;
+  return true;
+}
+
+/** Write the symbol cache file (with asyn lock()).
+ *
+ * \return asynSuccess or asynError.
+ * Thread safe.
+ */
+asynStatus adsAsynPortDriver::writeSymbolCacheLock()
+{
+  if(!symbolCachePath_){
+    return asynSuccess;
+  }
+  lock();
+  asynStatus stat=writeSymbolCache();
+  unlock();
+  return stat;
+}
+
+/** Write the symbol info of all resolved parameters to the symbol cache
+ * file. Written to a temporary file first and then renamed.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::writeSymbolCache()
+{
+  const char* functionName = "writeSymbolCache";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
+
+  std::vector<adsSymbolCachePort> ports;
+  for(amsPortInfo *port : amsPortList_){
+    adsSymbolCachePort cachePort;
+    if(adsReadSymbolCacheKey(port,&cachePort)==asynSuccess){
+      ports.push_back(cachePort);
+    }
+  }
+
+  // Unique symbols of ams ports with a known symbol version
+  std::map<std::string,adsParamInfo*> symbols;
+  for(int i=1; i<adsParamArrayCount_;i++){
+    adsParamInfo *paramInfo=pAdsParamArray_[i];
+    if(!paramInfo || paramInfo->dataSource!=ADS_DATASOURCE_PLC || paramInfo->isAdrCommand ||
+       paramInfo->refreshNeeded || !paramInfo->plcAbsAdrValid){
+      continue;
+    }
+    for(adsSymbolCachePort &cachePort : ports){
+      if(cachePort.amsPort==paramInfo->amsPort){
+        symbols[std::to_string(paramInfo->amsPort)+":"+paramInfo->plcAdrStr]=paramInfo;
+      }
+    }
+  }
+
+  // Keep the old file if nothing is resolved (PLC not reachable)
+  if(symbols.empty()){
+    asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: No resolved symbols. Symbol cache %s not written.\n", driverName, functionName,symbolCachePath_);
+    return asynSuccess;
+  }
+  unloadSymbolCache();  //Not needed after init
+
+  adsSymbolCacheHeader header;
+  memset(&header,0,sizeof(header));
+  header.magic=ADS_SYMBOL_CACHE_MAGIC;
+  header.format=ADS_SYMBOL_CACHE_FORMAT;
+  memcpy(header.netId,remoteNetId_.b,sizeof(header.netId));
+  header.portCount=ports.size();
+  header.entryCount=symbols.size();
+
+  std::vector<adsSymbolCacheEntry> entries;
+  std::string names;
+  uint32_t namesOffset=sizeof(header)+ports.size()*sizeof(adsSymbolCachePort)+
+                       symbols.size()*sizeof(adsSymbolCacheEntry);
+  for(auto &symbol : symbols){
+    adsParamInfo *paramInfo=symbol.second;
+    adsSymbolCacheEntry entry;
+    memset(&entry,0,sizeof(entry));
+    entry.nameOffset=namesOffset+names.size();
+    entry.nameLength=strlen(paramInfo->plcAdrStr);
+    entry.amsPort=paramInfo->amsPort;
+    entry.group=paramInfo->plcAbsAdrGroup;
+    entry.offset=paramInfo->plcAbsAdrOffset;
+    entry.size=paramInfo->hot->plcSize;
+    entry.dataType=paramInfo->plcDataType;
+    entries.push_back(entry);
+    names+=paramInfo->plcAdrStr;
+  }
+
+  std::string tmpPath=std::string(symbolCachePath_)+".tmp";
+  FILE *file=fopen(tmpPath.c_str(),"wb");
+  if(!file){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to open %s (%s).\n", driverName, functionName,tmpPath.c_str(),strerror(errno));
+    return asynError;
+  }
+  bool ok=fwrite(&header,sizeof(header),1,file)==1;
+  ok=ok && (ports.empty() || fwrite(ports.data(),sizeof(adsSymbolCachePort),ports.size(),file)==ports.size());
+  ok=ok && (entries.empty() || fwrite(entries.data(),sizeof(adsSymbolCacheEntry),entries.size(),file)==entries.size());
+  ok=ok && (names.empty() || fwrite(names.data(),1,names.size(),file)==names.size());
+  ok=(fclose(file)==0) && ok;
+  if(!ok || rename(tmpPath.c_str(),symbolCachePath_)!=0){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to write symbol cache %s (%s).\n", driverName, functionName,symbolCachePath_,strerror(errno));
+    remove(tmpPath.c_str());
+    return asynError;
+  }
+
+  asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Wrote %lu symbols to %s.\n", driverName, functionName,(unsigned long)entries.size(),symbolCachePath_);
+  return asynSuccess;
+}
+
+/** Configure write coalescing. Writes are queued and sent as one sum write
+ * when windowMS has passed since the first queued write, when maxEntries
+ * writes are queued or when a ".WRITEFLUSH." parameter is written.
+ * \param[in] windowMS Coalescing window in ms (0 disables, queue is flushed).
+ * \param[in] maxEntries Max writes in one sum write.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setWriteCoalescing(int windowMS,int maxEntries)
+{
+  const char* functionName = "setWriteCoalescing";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: window %d ms, max entries %d\n", driverName, functionName,windowMS,maxEntries);
+
+  if(windowMS<0 || maxEntries<=0 || maxEntries>BULKSIZ){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Invalid window (%d ms) or max entries (%d, max %d).\n", driverName, functionName,windowMS,maxEntries,BULKSIZ);
+    return asynError;
+  }
+
+  writeQueueMutex_.lock();
+  writeCoalesceMaxEntries_=maxEntries;
+  writeCoalesceWindowMS_=windowMS;
+  writeQueueMutex_.unlock();
+
+  return flushWriteQueue();
+}
+
+/** Request that all queued writes are sent now.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::flushWriteQueue()
+{
+  writeQueueMutex_.lock();
+  writeFlushRequested_=true;
+  writeQueueMutex_.unlock();
+  epicsEventSignal(writeQueueEvent_);
+  return asynSuccess;
+}
+
+/** Get octet session of an asyn client (created on first use).
+ * Sessions are keyed on asynUser so that replies of different clients
+ * (StreamDevice records, motor controllers..) are kept apart. Release
+ * session with octetSessionRelease() when done.
+ * \param[in] pasynUser Pointer to asyn user structure
+ *
+ * \return Session or NULL.
+ */
+adsOctetSession* adsAsynPortDriver::octetSessionAcquire(asynUser *pasynUser)
+{
+  const char* functionName = "octetSessionAcquire";
+  std::lock_guard<std::mutex> guard(octetSessionMutex_);
+
+  adsOctetSession *session=NULL;
+  std::map<const asynUser*,adsOctetSession*>::iterator it=octetSessions_.find(pasynUser);
+  if(it!=octetSessions_.end()){
+    session=it->second;
+  }
+  else{
+    // Evict least recently used idle session if too many
+    if(octetSessions_.size()>=ADS_OCTET_MAX_SESSIONS){
+      std::map<const asynUser*,adsOctetSession*>::iterator oldest=octetSessions_.end();
+      for(it=octetSessions_.begin();it!=octetSessions_.end();++it){
+        if(it->second->inUse || it->second->asciiBuffer.bytesUsed){
+          continue;
+        }
+        if(oldest==octetSessions_.end() || it->second->lastUsed<oldest->second->lastUsed){
+          oldest=it;
+        }
+      }
+      if(oldest==octetSessions_.end()){
+        asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Too many octet sessions (max %d, all busy).\n", driverName, functionName,ADS_OCTET_MAX_SESSIONS);
+        return NULL;
+      }
+      octetSessionFree(oldest->second);
+      octetSessions_.erase(oldest);
+    }
+
+    session=(adsOctetSession*)calloc(1,sizeof(adsOctetSession));
+    if(!session || octetInitBuffer(&session->asciiBuffer,ADS_CMD_BUFFER_SIZE,octetBufferSize_)){
+      free(session);
+      asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Failed to allocate octet session.\n", driverName, functionName);
+      return NULL;
+    }
+    session->owner=pasynUser;
+    octetSessions_[pasynUser]=session;
+  }
+
+  // Apply buffer size changes (see setOctetBufferSize())
+  if(session->binaryBufferSize!=octetBufferSize_ && !session->inUse){
+    uint8_t *binaryBuffer=(uint8_t*)realloc(session->binaryBuffer,octetBufferSize_);
+    if(!binaryBuffer){
+      asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Failed to allocate %lu bytes.\n", driverName, functionName,(unsigned long)octetBufferSize_);
+      if(!session->binaryBuffer){
+        return NULL;
+      }
+    }
+    else{
+      session->binaryBuffer=binaryBuffer;
+      session->binaryBufferSize=octetBufferSize_;
+    }
+    size_t maxSize=octetBufferSize_;
+    session->asciiBuffer.maxSize=maxSize<session->asciiBuffer.bufferSize ? session->asciiBuffer.bufferSize : maxSize;
+  }
+
+  session->inUse++;
+  session->lastUsed=++octetSessionCounter_;
+  return session;
+}
+
+/** Release octet session (see octetSessionAcquire()).
+ * \param[in] session Octet session.
+ */
+void adsAsynPortDriver::octetSessionRelease(adsOctetSession *session)
+{
+  std::lock_guard<std::mutex> guard(octetSessionMutex_);
+  session->inUse--;
+}
+
+/** Free octet session.
+ * \param[in] session Octet session.
+ */
+void adsAsynPortDriver::octetSessionFree(adsOctetSession *session)
+{
+  octetFreeBuffer(&session->asciiBuffer);
+  free(session->binaryBuffer);
+  free(session);
+}
+
+/** Free all octet sessions not in use (the asynUser of a session may be
+ * freed by its client and reused by another one). Called at disconnect,
+ * when pending replies are lost anyway.
+ */
+void adsAsynPortDriver::octetSessionFreeIdle()
+{
+  std::lock_guard<std::mutex> guard(octetSessionMutex_);
+  std::map<const asynUser*,adsOctetSession*>::iterator it=octetSessions_.begin();
+  while(it!=octetSessions_.end()){
+    if(it->second->inUse){
+      ++it;
+      continue;
+    }
+    octetSessionFree(it->second);
+    it=octetSessions_.erase(it);
+  }
+}
+
+/* TBD - Use paramInfo->pollClass to separate into different poll rates!! */
+asynStatus adsAsynPortDriver::adsAddToBulkRead(adsParamInfo* paramInfo)
+{
+    adsLock(ADS_LANE_SUBSCRIPTION); // Prevent reads while we change this!
+    if (paramInfo->bulkIndex < 0) { /* Not assigned yet, find one! */
+        int i;
+        for (i = 0; i < MAXBULK; i++) {
+            /* Look for an unused entry or a non-full entry for this port. */
+            if (bulk[i].cnt == 0 || (bulk[i].cnt != BULKSIZ &&
+                                     bulk[i].amsPort == paramInfo->amsPort))
+                break;
+        }
+        if (i == MAXBULK) {
+            adsUnlock();
+            return asynError; // No room at the inn.
+        }
+        if (!bulk[i].cnt) { // First variable in this bulk request!
+            /* Only the first bulk read of a port reads the time stamp */
+            int k;
+            for (k = 0; k < i; k++) {
+                if (bulk[k].amsPort == paramInfo->amsPort)
+                    break;
+            }
+            bulk[i].amsPort = paramInfo->amsPort;
+            bulk[i].tsIndex = adsFindBulkTimeStamp(paramInfo->amsPort);
+            bulk[i].tsSlots = (k == i) ? 2 : 0;
+            bulk[i].cnt = bulk[i].tsSlots;
+            bulk[i].readSize = 0;
+            adsUpdateBulkTimeStamp(i);
+        }
+        paramInfo->bulkIndex  = i;
+        paramInfo->bulkOffset = bulk[i].cnt;
+        bulk[i].paramID[bulk[i].cnt++] = paramInfo->paramIndex;
+    }
+    /* Update the information for a previously allocated element.  Possibly *just*
+       allocated, but that's still previously! */
+    uint32_t group, offset;
+    if (paramInfo->isAdrCommand) {
+        group = paramInfo->plcAbsAdrGroup;
+        offset = paramInfo->plcAbsAdrOffset;
+    } else {
+        group = ADSIGRP_SYM_VALBYHND;
+        offset = paramInfo->hSymbolicHandle;
+    }
+    bulk[paramInfo->bulkIndex].sum[paramInfo->bulkOffset].iGroup  = group;
+    bulk[paramInfo->bulkIndex].sum[paramInfo->bulkOffset].iOffset = offset;
+    bulk[paramInfo->bulkIndex].sum[paramInfo->bulkOffset].iSize   = paramInfo->hot->plcSize;
+    adsUpdateBulkPlan(paramInfo->bulkIndex);
+    adsUnlock();
+    return asynSuccess;
+}
+
+/* Use the subscription (notification or bulk read) of another I/O Intr
+   parameter of the same PLC variable (same ams port and address string),
+   for example records that only differ in TS_MS or TIMEBASE. The first
+   parameter holds the subscription, the others are chained to its hot data
+   (nextShared) and updated from the same data (adsUpdateFollowers()). The
+   subscription uses the fastest rate of the chain. Symbol handles stay per
+   parameter (writes). Call with port lock.
+   Returns true if the parameter is fed by another parameter. */
+bool adsAsynPortDriver::adsShareSubscription(adsParamInfo* paramInfo)
+{
+    /* Large arrays are polled in chunks per parameter */
+    if (adsUseChunkedPoll(paramInfo)) {
+        adsUnshareSubscription(paramInfo);
+        adsRecheckSharedChain(paramInfo, false);
+        return false;
+    }
+
+    std::string key = std::to_string(paramInfo->amsPort) + ":" + paramInfo->plcAdrStr;
+    std::map<std::string,int>::iterator it = sharedSubscriptions_.find(key);
+    if (it == sharedSubscriptions_.end() || it->second == paramInfo->paramIndex) {
+        sharedSubscriptions_[key] = paramInfo->paramIndex;
+        adsRecheckSharedChain(paramInfo, true);
+        return false;
+    }
+    adsParamInfo *leader = getAdsParamInfo(it->second);
+    if (!leader || leader->hot->plcSize != paramInfo->hot->plcSize) {
+        adsUnshareSubscription(paramInfo);
+        return false;  // Not resolved the same way (yet), subscribe separately
+    }
+
+    double sampleTimeMS, maxDelayTimeMS;
+    adsSharedRate(leader, &sampleTimeMS, &maxDelayTimeMS);
+
+    if (paramInfo->sharedLeader != leader->paramIndex) {
+        /* The chain is walked under the port lock (notifications and bulk reads) */
+        adsUnshareSubscription(paramInfo);
+        adsParamHot *tail = leader->hot;
+        while (tail->nextShared)
+            tail = tail->nextShared;
+        tail->nextShared = paramInfo->hot;
+        paramInfo->sharedLeader = leader->paramIndex;
+    }
+
+    /* Subscribe again if this parameter needs a faster rate */
+    if (leader->bCallbackNotifyValid &&
+        (paramInfo->sampleTimeMS < sampleTimeMS || paramInfo->maxDelayTimeMS < maxDelayTimeMS)) {
+        adsDelDataCallback(leader, true);
+        adsAddDataCallback(leader);
+    }
+    return true;
+}
+
+/* Remove a parameter from the chain of the parameter holding its
+   subscription (if any). Call with port lock. */
+void adsAsynPortDriver::adsUnshareSubscription(adsParamInfo* paramInfo)
+{
+    adsParamInfo *leader = paramInfo->sharedLeader >= 0 ? getAdsParamInfo(paramInfo->sharedLeader) : NULL;
+    if (leader) {
+        for (adsParamHot *prev = leader->hot; prev->nextShared; prev = prev->nextShared) {
+            if (prev->nextShared == paramInfo->hot) {
+                prev->nextShared = paramInfo->hot->nextShared;
+                break;
+            }
+        }
+    }
+    paramInfo->hot->nextShared = NULL;
+    paramInfo->sharedLeader = -1;
+    if (paramInfo->sharedPendingSize) {
+        paramInfo->sharedPendingSize = 0;
+        sharedPendingCount_--;
+    }
+}
+
+/* Re-evaluate the chain of a parameter holding a subscription after it has
+   been resolved again. Followers that no longer match (size, or keep false)
+   are unlinked and resolved again, which subscribes them on their own or
+   links them again. Call with port lock. */
+void adsAsynPortDriver::adsRecheckSharedChain(adsParamInfo* leader, bool keep)
+{
+    std::vector<adsParamInfo*> detached;
+    adsParamHot *prev = leader->hot;
+    while (prev->nextShared) {
+        adsParamHot *follower = prev->nextShared;
+        if (keep && follower->plcSize == leader->hot->plcSize) {
+            prev = follower;
+            continue;
+        }
+        prev->nextShared = follower->nextShared;
+        follower->nextShared = NULL;
+        follower->info->sharedLeader = -1;
+        if (follower->info->sharedPendingSize) {
+            follower->info->sharedPendingSize = 0;
+            sharedPendingCount_--;
+        }
+        detached.push_back(follower->info);
+    }
+    for (adsParamInfo *paramInfo : detached) {
+        if (updateParamInfoWithPLCInfo(paramInfo) != asynSuccess) {
+            paramInfo->refreshNeeded = true;
+            setAlarmParam(paramInfo, COMM_ALARM, INVALID_ALARM);
+        }
+    }
+}
+
+/* Fastest sample and max delay time of a parameter and the parameters
+   that share its subscription. */
+void adsAsynPortDriver::adsSharedRate(adsParamInfo* leader, double *sampleTimeMS, double *maxDelayTimeMS)
+{
+    *sampleTimeMS = leader->sampleTimeMS;
+    *maxDelayTimeMS = leader->maxDelayTimeMS;
+    for (adsParamHot *follower = leader->hot->nextShared; follower; follower = follower->nextShared) {
+        *sampleTimeMS = std::min(*sampleTimeMS, follower->info->sampleTimeMS);
+        *maxDelayTimeMS = std::min(*maxDelayTimeMS, follower->info->maxDelayTimeMS);
+    }
+}
+
+/* Set the time stamp elements of a bulk read (if it is the first read of the
+   port), %M if the time stamp variables are missing. Call with adsMutex. */
+void adsAsynPortDriver::adsUpdateBulkTimeStamp(int bulkIndex)
+{
+    if (!bulk[bulkIndex].tsSlots)
+        return;
+    struct tsentry *ts = &bulkTS[bulk[bulkIndex].tsIndex];
+    if (ts->refreshNeeded) { /* No TS variables!! */
+        bulk[bulkIndex].sum[0].iGroup  = 0x4020; // %M
+        bulk[bulkIndex].sum[0].iOffset = 0;
+        bulk[bulkIndex].sum[1].iGroup  = 0x4020; // %M
+        bulk[bulkIndex].sum[1].iOffset = 0;
+    } else {
+        bulk[bulkIndex].sum[0].iGroup  = ADSIGRP_SYM_VALBYHND;
+        bulk[bulkIndex].sum[0].iOffset = ts->iHandleH;
+        bulk[bulkIndex].sum[1].iGroup  = ADSIGRP_SYM_VALBYHND;
+        bulk[bulkIndex].sum[1].iOffset = ts->iHandleL;
+    }
+    bulk[bulkIndex].sum[0].iSize = sizeof(uint32_t);
+    bulk[bulkIndex].sum[1].iSize = sizeof(uint32_t);
+}
+
+/* Re-resolve the time stamp handles of the first bulk read of each port
+   (after reconnect or online change). Once per port since each try costs
+   two ADS requests if the variables are missing. */
+void adsAsynPortDriver::adsRefreshBulkTimeStamps(uint16_t amsPort)
+{
+    adsLock(ADS_LANE_SUBSCRIPTION);
+    for (int i = 0; i < MAXBULK; i++) {
+        if (bulk[i].cnt == 0)
+            break;
+        if (!bulk[i].tsSlots || (amsPort != 0 && bulk[i].amsPort != amsPort))
+            continue;
+        if (bulkTS[bulk[i].tsIndex].refreshNeeded) {
+            adsFindBulkTimeStamp(bulk[i].amsPort);
+            adsUpdateBulkTimeStamp(i);
+        }
+    }
+    adsUnlock();
+}
+
+/* Recalculate the read size (result + data of each element) and the decode
+   plan of a bulk read. The plan holds the destination and the data offset of
+   each element so that the bulk read thread does not need to look up
+   parameters or sum up sizes each cycle. Elements can be updated more than
+   once (refresh of changed symbols) and are kept in place over a reconnect
+   (restoreParams()). Call with adsMutex. */
+void adsAsynPortDriver::adsUpdateBulkPlan(int bulkIndex)
+{
+    uint32_t offset = 0;
+    int tsSlots = bulk[bulkIndex].tsSlots;
+    for (int k = 0; k < bulk[bulkIndex].cnt; k++) {
+        bulk[bulkIndex].plan[k].hot    = k < tsSlots ? NULL : getAdsParamHot(bulk[bulkIndex].paramID[k]);
+        bulk[bulkIndex].plan[k].offset = offset;
+        bulk[bulkIndex].plan[k].size   = bulk[bulkIndex].sum[k].iSize;
+        offset += bulk[bulkIndex].sum[k].iSize;
+    }
+    bulk[bulkIndex].readSize = offset + bulk[bulkIndex].cnt * sizeof(uint32_t);
+}
+
+/** Add a large array to the list of parameters polled in chunks by the bulk
+ * read thread (instead of one large notification).
+ * \param[in] paramInfo Parameter information.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsAddToChunkedPoll(adsParamInfo* paramInfo)
+{
+    adsLock(ADS_LANE_SUBSCRIPTION);
+    if (!paramInfo->isChunkedPoll) {
+        chunkedPollList_.push_back(paramInfo->paramIndex);
+        paramInfo->isChunkedPoll = true;
+        paramInfo->chunkedPollLastUs = 0;
     }
-    bulk[paramInfo->bulkIndex].sum[paramInfo->bulkOffset].iGroup  = group;
-    bulk[paramInfo->bulkIndex].sum[paramInfo->bulkOffset].iOffset = offset;
-    bulk[paramInfo->bulkIndex].sum[paramInfo->bulkOffset].iSize   = paramInfo->plcSize;
-    bulk[paramInfo->bulkIndex].readSize += paramInfo->plcSize + sizeof(uint32_t);
     adsUnlock();
     return asynSuccess;
 }
 
+/** Remove a parameter from the chunked poll list (when it is resolved again
+ * and no longer polled in chunks).
+ * \param[in] paramInfo Parameter information.
+ */
+void adsAsynPortDriver::adsRemoveFromChunkedPoll(adsParamInfo* paramInfo)
+{
+    adsLock(ADS_LANE_SUBSCRIPTION);
+    if (paramInfo->isChunkedPoll) {
+        chunkedPollList_.erase(std::remove(chunkedPollList_.begin(), chunkedPollList_.end(),
+                                           paramInfo->paramIndex),
+                               chunkedPollList_.end());
+        paramInfo->isChunkedPoll = false;
+    }
+    adsUnlock();
+}
+
+/* Large I/O Intr arrays are polled in chunks instead of one notification
+   only if enabled (adsSetChunkSize(size,1)). */
+bool adsAsynPortDriver::adsUseChunkedPoll(adsParamInfo* paramInfo)
+{
+    return chunkedPoll_ && chunkSize_ > 0 && paramInfo->hot->plcSize > chunkSize_ &&
+           paramInfo->plcAbsAdrValid;
+}
+
+/* Poll large arrays that are due (sample time). Called from the bulk read
+   thread without adsMutex, since each chunk takes the lock by itself. */
+void adsAsynPortDriver::adsPollChunked()
+{
+    std::vector<int> due;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t nowUs = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+
+    adsLock(ADS_LANE_POLL);
+    for (int paramIndex : chunkedPollList_) {
+        adsParamInfo *paramInfo = getAdsParamInfo(paramIndex);
+        if (!paramInfo || paramInfo->refreshNeeded)
+            continue;
+        if (nowUs - paramInfo->chunkedPollLastUs >= (uint64_t)(paramInfo->sampleTimeMS * 1000)) {
+            paramInfo->chunkedPollLastUs = nowUs;
+            due.push_back(paramIndex);
+        }
+    }
+    adsUnlock();
+
+    for (int paramIndex : due) {
+        adsParamInfo *paramInfo = getAdsParamInfo(paramIndex);
+        if (adsReadParam(paramInfo) != asynSuccess) {
+            uint32_t chunksDone, chunksTotal;
+            adsGetChunkProgress(paramInfo, &chunksDone, &chunksTotal);
+            asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                      "%s:adsPollChunked: chunked read of %s failed (%u/%u chunks).\n",
+                      driverName, paramInfo->drvInfo, chunksDone, chunksTotal);
+        }
+    }
+}
+
 // Assume locked!!
 int adsAsynPortDriver::adsFindBulkTimeStamp(uint16_t amsPort)
 {
@@ -1284,6 +3313,7 @@ int adsAsynPortDriver::adsFindBulkTimeStamp(uint16_t amsPort)
         bulkTScnt++;
         bulkTS[i].amsPort = amsPort;
         bulkTS[i].refreshNeeded = 1;
+        bulkTS[i].cycle = 0;
     }
 #define TSLO "MAIN.fbSystemTime.timeLoDW"
 #define TSHI "MAIN.fbSystemTime.timeHiDW"
@@ -1310,6 +3340,43 @@ int adsAsynPortDriver::adsFindBulkTimeStamp(uint16_t amsPort)
     return i;
 }
 
+/** Index the records linked to this port by drvInfo (one pass over the
+ * database instead of one pass per parameter). The first record wins, like
+ * in the scan of getRecordInfoFromDrvInfo().
+ * \return void
+ */
+void adsAsynPortDriver::buildRecordIndex()
+{
+  recordIndexBuilt_=true;
+  recordIndex_.clear();
+  DBENTRY *pdbentry = dbAllocEntry(pdbbase);
+  long status = dbFirstRecordType(pdbentry);
+  while(!status) {
+    status = dbFirstRecord(pdbentry);
+    while(!status) {
+      if(!dbIsAlias(pdbentry)){
+        const char *fields[2]={"INP","OUT"};
+        for(int i=0;i<2;i++){
+          if(dbFindField(pdbentry,fields[i])){
+            continue;
+          }
+          char port[ADS_MAX_FIELD_CHAR_LENGTH];
+          int adr;
+          int timeout;
+          char currdrvInfo[ADS_MAX_FIELD_CHAR_LENGTH];
+          int nvals=sscanf(dbGetString(pdbentry),"@asyn(%[^,],%d,%d)%s",port,&adr,&timeout,currdrvInfo);
+          if(nvals==4 && strcmp(port,portName)==0){
+            recordIndex_.insert(std::make_pair(std::string(currdrvInfo),std::string(dbGetRecordName(pdbentry))));
+          }
+        }
+      }
+      status = dbNextRecord(pdbentry);
+    }
+    status = dbNextRecordType(pdbentry);
+  }
+  dbFreeEntry(pdbentry);
+}
+
 /** Get asyn type from record.
  * \param[in] drvInfo String containing information about the parameter.
  * \param[in/out] paramInfo Parameter information structure.
@@ -1324,6 +3391,38 @@ asynStatus adsAsynPortDriver::getRecordInfoFromDrvInfo(const char *drvInfo,adsPa
   bool isOutput=false;
   paramInfo->amsPort=amsportDefault_;
   DBENTRY *pdbentry;
+
+  // Indexed lookup. Falls back to a full scan if the record is not in the index.
+  if(!recordIndexBuilt_){
+    buildRecordIndex();
+  }
+  std::unordered_map<std::string,std::string>::const_iterator it=recordIndex_.find(drvInfo);
+  if(it!=recordIndex_.end()){
+    pdbentry = dbAllocEntry(pdbbase);
+    if(!dbFindRecord(pdbentry,it->second.c_str())){
+      paramInfo->recordType=strdup(dbGetRecordTypeName(pdbentry));
+      paramInfo->recordName=strdup(dbGetRecordName(pdbentry));
+      if(!dbFindField(pdbentry,"INP")){
+        paramInfo->inp=strdup(dbGetString(pdbentry));
+      }
+      if(!dbFindField(pdbentry,"OUT")){
+        paramInfo->out=strdup(dbGetString(pdbentry));
+      }
+      if(!dbFindField(pdbentry,"DTYP")){
+        paramInfo->dtyp=strdup(dbGetString(pdbentry));
+        paramInfo->asynType=dtypStringToAsynType(dbGetString(pdbentry));
+      }
+      else{
+        paramInfo->dtyp=0;
+        paramInfo->asynType=asynParamNotDefined;
+      }
+      paramInfo->drvInfo=strdup(drvInfo);
+      dbFreeEntry(pdbentry);
+      return asynSuccess;
+    }
+    dbFreeEntry(pdbentry);
+  }
+
   pdbentry = dbAllocEntry(pdbbase);
   long status = dbFirstRecordType(pdbentry);
   bool recordFound=false;
@@ -1487,7 +3586,7 @@ asynStatus adsAsynPortDriver::parsePlcInfofromDrvInfo(const char* drvInfo,adsPar
     int nvals = sscanf(isThere+strlen(option),"16#%x,16#%x,%u,%u",
              &paramInfo->plcAbsAdrGroup,
              &paramInfo->plcAbsAdrOffset,
-             &paramInfo->plcSize,
+             &paramInfo->hot->plcSize,
              &paramInfo->plcDataType);
 
     if(nvals==4){
@@ -1497,7 +3596,7 @@ asynStatus adsAsynPortDriver::parsePlcInfofromDrvInfo(const char* drvInfo,adsPar
       paramInfo->plcAbsAdrValid=false;
       paramInfo->plcAbsAdrGroup=-1;
       paramInfo->plcAbsAdrOffset=-1;
-      paramInfo->plcSize=-1;
+      paramInfo->hot->plcSize=-1;
       paramInfo->plcDataType=-1;
       asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to parse %s command from drvInfo (%s). Wrong format.\n", driverName, functionName,option,drvInfo);
       return asynError;
@@ -1562,9 +3661,24 @@ asynStatus adsAsynPortDriver::parsePlcInfofromDrvInfo(const char* drvInfo,adsPar
     }
   }
 
+  //Check if ADS_OPTION_WRITE_BEHIND option
+  option=ADS_OPTION_WRITE_BEHIND;
+  paramInfo->isWriteBehind = false;
+  isThere=strstr(drvInfo,option);
+  if(isThere){
+    int val=0;
+    int nvals = sscanf(isThere+strlen(option),"=%d/",&val);
+
+    if(nvals!=1){
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to parse %s option from drvInfo (%s). Wrong format.\n", driverName, functionName,option,drvInfo);
+      return asynError;
+    }
+    paramInfo->isWriteBehind = val!=0;
+  }
+
   //Check if ADS_OPTION_TIMEBASE option
   option=ADS_OPTION_TIMEBASE;
-  paramInfo->timeBase=defaultTimeSource_;
+  paramInfo->hot->timeBase=defaultTimeSource_;
   isThere=strstr(drvInfo,option);
   if(isThere){
     int minLen=strlen(ADS_OPTION_TIMEBASE_PLC);
@@ -1584,11 +3698,11 @@ asynStatus adsAsynPortDriver::parsePlcInfofromDrvInfo(const char* drvInfo,adsPar
     }
 
     if(strcmp(ADS_OPTION_TIMEBASE_PLC,buffer)==0){
-      paramInfo->timeBase=ADS_TIME_BASE_PLC;
+      paramInfo->hot->timeBase=ADS_TIME_BASE_PLC;
     }
 
     if(strcmp(ADS_OPTION_TIMEBASE_EPICS,buffer)==0){
-      paramInfo->timeBase=ADS_TIME_BASE_EPICS;
+      paramInfo->hot->timeBase=ADS_TIME_BASE_EPICS;
     }
   }
 
@@ -1627,10 +3741,43 @@ asynStatus adsAsynPortDriver::parsePlcInfofromDrvInfo(const char* drvInfo,adsPar
     }
     paramInfo->dataSource=ADS_DATASOURCE_AMS_STATE;  //This information is accessible in driver (not PLC)
     paramInfo->plcDataType=ADST_UINT16;
-    paramInfo->plcSize=2;
-    paramInfo->plcDataIsArray=false;
-    paramInfo->timeBase=ADS_TIME_BASE_EPICS;
+    paramInfo->hot->plcSize=2;
+    paramInfo->hot->plcDataIsArray=false;
+    paramInfo->hot->timeBase=ADS_TIME_BASE_EPICS;
     port->paramInfo=paramInfo;
+    selectConversionKernels(paramInfo);
+  }
+
+  //Check if ADS_WRITE_FLUSH_COMMAND option Local variable/parameter (not in PLC)
+  option=ADS_WRITE_FLUSH_COMMAND;
+  isThere=strstr(drvInfo,option);
+  if(isThere){
+    paramInfo->dataSource=ADS_DATASOURCE_WRITE_FLUSH;  //Write flushes the write queue (not in PLC)
+    paramInfo->plcDataType=ADST_INT32;
+    paramInfo->hot->plcSize=4;
+    paramInfo->hot->plcDataIsArray=false;
+    paramInfo->hot->timeBase=ADS_TIME_BASE_EPICS;
+    selectConversionKernels(paramInfo);
+  }
+
+  //Check if write-behind statistics option Local variable/parameter (not in PLC)
+  static const struct {
+    const char    *command;
+    ADSDATASOURCE dataSource;
+  } writeBehindStats[]={
+    {ADS_WRITE_BEHIND_SENT_COMMAND,ADS_DATASOURCE_WRITE_BEHIND_SENT},
+    {ADS_WRITE_BEHIND_COLLAPSED_COMMAND,ADS_DATASOURCE_WRITE_BEHIND_COLLAPSED},
+    {ADS_WRITE_BEHIND_FAILED_COMMAND,ADS_DATASOURCE_WRITE_BEHIND_FAILED},
+  };
+  for(size_t i=0;i<sizeof(writeBehindStats)/sizeof(writeBehindStats[0]);i++){
+    if(strstr(drvInfo,writeBehindStats[i].command)){
+      paramInfo->dataSource=writeBehindStats[i].dataSource;  //Counter in driver (not PLC)
+      paramInfo->plcDataType=ADST_UINT32;
+      paramInfo->hot->plcSize=4;
+      paramInfo->hot->plcDataIsArray=false;
+      paramInfo->hot->timeBase=ADS_TIME_BASE_EPICS;
+      selectConversionKernels(paramInfo);
+    }
   }
 
   return addNewAmsPortToList(paramInfo->amsPort);//Only add if not already there
@@ -1756,20 +3903,25 @@ asynStatus adsAsynPortDriver::readOctet(asynUser *pasynUser, char *value, size_t
   int reason = 0;
   asynStatus status = asynSuccess;
 
-  *value = '\0';
-  lock();
-  int error=octetCMDreadIt(value, maxChars);
+  adsOctetSession *session=octetSessionAcquire(pasynUser);
+  if (!session) {
+    return asynError;
+  }
+
+  int error=octetCMDreadIt(session, value, maxChars, &thisRead);
+  octetSessionRelease(session);
   if (error) {
     status = asynError;
     asynPrint(pasynUser, ASYN_TRACE_ERROR,
               "%s:%s: error, CMDreadIt failed (0x%x).\n",
               driverName, functionName, error);
-    unlock();
     return asynError;
   }
 
-  thisRead = strlen(value);
-  *nActual = thisRead;
+  /* Null terminate if space (not needed by asyn but convenient for printouts) */
+  if (thisRead < maxChars) {
+    value[thisRead] = '\0';
+  }
 
   /* May be not enough space ? */
   if (thisRead > maxChars-1) {
@@ -1789,42 +3941,34 @@ asynStatus adsAsynPortDriver::readOctet(asynUser *pasynUser, char *value, size_t
 
   *nActual = thisRead;
   asynPrint(pasynUser, ASYN_TRACE_FLOW,
-             "%s thisRead=%lu data=\"%s\"\n",
+             "%s thisRead=%lu data=\"%.*s\"\n",
              portName,
-             (unsigned long)thisRead, value);
-  unlock();
-  asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s:%s\n", driverName, functionName,value);
+             (unsigned long)thisRead, (int)thisRead, value);
 
   return status;
 }
 
 /** Implements part of the asyn-octet ASCII command parser.
  * (see readOctet() and writeOctet for more info).
+ * Data is copied directly out of the octet ring buffer (no null termination).
+ * \param[in] session Octet session of client.
  * \param[in] outbuf Buffer for read data.
  * \param[in] outlen Size of value buffer.
+ * \param[out] bytesRead Bytes copied to outbuf.
  *
  * \return 0 for success or error code.
  */
-int adsAsynPortDriver::octetCMDreadIt(char *outbuf, size_t outlen)
+int adsAsynPortDriver::octetCMDreadIt(adsOctetSession *session,char *outbuf, size_t outlen, size_t *bytesRead)
 {
   const char* functionName = "octetCMDreadIt";
-  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Buffer: %s, size: %d\n", driverName, functionName,outbuf,(int)outlen);
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Buffered: %lu, size: %d\n", driverName, functionName,(unsigned long)session->asciiBuffer.bytesUsed,(int)outlen);
 
-  int ret;
+  *bytesRead = 0;
   if (!outbuf || !outlen){
     return -1;
   }
-  ret = snprintf(outbuf, outlen+1, "%s",octetAsciiBuffer_.buffer);
-
-  if (ret < 0){
-    octetClearBuffer(&octetAsciiBuffer_);
-    return ret;
-  }
 
-  if(ret>=(int)outlen+1){
-    ret=outlen;
-  }
-  octetRemoveFromBuffer(&octetAsciiBuffer_,ret);
+  *bytesRead = octetReadFromBuffer(&session->asciiBuffer,outbuf,outlen);
 
   return 0;
 }
@@ -1871,12 +4015,19 @@ asynStatus adsAsynPortDriver::writeOctet(asynUser *pasynUser, const char *value,
   if (maxChars == 0){
     return asynSuccess;
   }
-  //lock();
-  int errorCode=octetCMDwriteIt(value, maxChars);
+  adsOctetSession *session=octetSessionAcquire(pasynUser);
+  if (!session) {
+    return asynError;
+  }
+
+  // No port lock here: commands only use session state, ADS access is
+  // serialized by adsLock()
+  int errorCode=octetCMDwriteIt(session, value, maxChars);
+  octetSessionRelease(session);
   if (errorCode){
     /*Return asyn error if communication is down (all client errors) otherwise asynSuccess
      * but error message in buffer*/
-    if (errorCode>=ADSERR_CLIENT_ERROR){
+    if (errorCode>=ADSERR_CLIENT_ERROR || errorCode==ADS_COM_ERROR_BUFFER_TO_EPICS_FULL){
       return asynError;
     }
   }
@@ -1884,7 +4035,6 @@ asynStatus adsAsynPortDriver::writeOctet(asynUser *pasynUser, const char *value,
   thisWrite = maxChars;
   *nActual = thisWrite;
 
-  //unlock();
   asynPrint(pasynUser, ASYN_TRACE_FLOW,
             "%s wrote %lu return %s.\n",
             portName,
@@ -1895,12 +4045,13 @@ asynStatus adsAsynPortDriver::writeOctet(asynUser *pasynUser, const char *value,
 
 /** Implements part of the asyn-octet ASCII command parser.
  * (see readOctet() and writeOctet for more info).
+ * \param[in] session Octet session of client.
  * \param[in] inbuf Buffer for read data.
  * \param[in] inlen Size of value buffer.
  *
  * \return 0 for success or error code.
  */
-int adsAsynPortDriver::octetCMDwriteIt(const char *inbuf, size_t inlen)
+int adsAsynPortDriver::octetCMDwriteIt(adsOctetSession *session,const char *inbuf, size_t inlen)
 {
   const char* functionName = "octetCMDwriteIt";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Write command: %s, length: %d\n", driverName, functionName,inbuf,(int) inlen);
@@ -1926,19 +4077,27 @@ int adsAsynPortDriver::octetCMDwriteIt(const char *inbuf, size_t inlen)
     }
   }
 
-  errorCode = octetCmdHandleInputLine(new_buf,&octetAsciiBuffer_);
+  errorCode = octetCmdHandleInputLine(new_buf,session);
   free(new_buf);
 
-  octetCmdBuf_printf(&octetAsciiBuffer_,"%s%s",had_cr ? "\r" : "", had_lf ? "\n" : "");
+  octetCmdBuf_printf(&session->asciiBuffer,"%s%s",had_cr ? "\r" : "", had_lf ? "\n" : "");
+
+  if (session->asciiBuffer.overflow){
+    asynPrint(pasynUserSelf,ASYN_TRACE_ERROR, "%s:%s: Response does not fit in octet buffer (max %lu bytes). Increase with adsSetOctetBufferSize().\n", driverName, functionName,(unsigned long)session->asciiBuffer.maxSize);
+    octetClearBuffer(&session->asciiBuffer);
+    return ADS_COM_ERROR_BUFFER_TO_EPICS_FULL;
+  }
 
   return errorCode;
 }
 
-int adsAsynPortDriver::octetCmdHandleInputLine(const char *input_line, adsOctetOutputBufferType *buffer)
+int adsAsynPortDriver::octetCmdHandleInputLine(const char *input_line, adsOctetSession *session)
 {
   const char* functionName = "octetCmdHandleInputLine";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Input line: %s\n", driverName, functionName,input_line);
 
+  adsOctetOutputBufferType *buffer=&session->asciiBuffer;
+
   const char **my_argv = NULL;
   char **my_sepv = NULL;
   int argc = octetCreateArgvSepv(input_line,
@@ -1947,7 +4106,7 @@ int adsAsynPortDriver::octetCmdHandleInputLine(const char *input_line, adsOctetO
 
   int errorCodeLatch =0;
   for (int i = 1; i <= argc; i++) {
-    int errorCode = octetMotorHandleOneArg(my_argv[i],buffer);  //Continue with next cmd even if error
+    int errorCode = octetMotorHandleOneArg(my_argv[i],session);  //Continue with next cmd even if error
     if(errorCode && !errorCodeLatch){ //latch first error code for stacked commands
       errorCodeLatch=errorCode;
     }
@@ -1969,15 +4128,17 @@ int adsAsynPortDriver::octetCmdHandleInputLine(const char *input_line, adsOctetO
  * Implements part of the asyn-octet ASCII command parser.
  * (see readOctet() and writeOctet for more info).
  * \param[in] myarg_1 Command to parse.
- * \param[out] buffer Output buffer.
+ * \param[in,out] session Octet session (output buffer).
  *
  * \return 0 for success or error code.
  */
-int adsAsynPortDriver::octetMotorHandleOneArg(const char *myarg_1,adsOctetOutputBufferType *buffer)
+int adsAsynPortDriver::octetMotorHandleOneArg(const char *myarg_1,adsOctetSession *session)
 {
   const char* functionName = "octetMotorHandleOneArg";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Command: %s\n", driverName, functionName,myarg_1);
 
+  adsOctetOutputBufferType *buffer=&session->asciiBuffer;
+
   //const char *myarg = myarg_1;
   int err_code=0;
 
@@ -2011,7 +4172,7 @@ int adsAsynPortDriver::octetMotorHandleOneArg(const char *myarg_1,adsOctetOutput
   if(adr) {
     myarg_1 = adr;
 
-    err_code = octetMotorHandleADRCmd(myarg_1,amsPort,buffer);
+    err_code = octetMotorHandleADRCmd(myarg_1,amsPort,session);
     if (err_code == -1 || err_code == 0) {
       return 0;
     }
@@ -2028,7 +4189,7 @@ int adsAsynPortDriver::octetMotorHandleOneArg(const char *myarg_1,adsOctetOutput
     //Copy variable name
     strncpy(variableName,myarg_1,adr-myarg_1);
     adr++; //Jump over '='
-    err_code = octetAdsWriteByName(amsPort,variableName,adr,buffer);
+    err_code = octetAdsWriteByName(amsPort,variableName,adr,session);
     if (err_code) {
       OCTET_RETURN_ERROR(buffer,err_code,"%s",adsErrorToString(err_code));
     }
@@ -2043,7 +4204,7 @@ int adsAsynPortDriver::octetMotorHandleOneArg(const char *myarg_1,adsOctetOutput
     //Copy variable name
     strncpy(variableName,myarg_1,adr-myarg_1);
     variableName[adr-myarg_1]=0;
-    err_code = octetAdsReadByName(amsPort,variableName,buffer);
+    err_code = octetAdsReadByName(amsPort,variableName,session);
     if (err_code) {
       OCTET_RETURN_ERROR(buffer,err_code,"%s",adsErrorToString(err_code));
     }
@@ -2059,17 +4220,19 @@ int adsAsynPortDriver::octetMotorHandleOneArg(const char *myarg_1,adsOctetOutput
  * (see readOctet() and writeOctet for more info).
  * \param[in] arg Command to parse.
  * \param[in] amsport Ams-port.
- * \param[out] buffer Output buffer.
+ * \param[in,out] session Octet session (output and binary buffers).
  *
  * \return 0 for success or error code.
  *
  * \note:  see octetAdsWriteByGroupOffset for more information.\n
  */
-int adsAsynPortDriver::octetMotorHandleADRCmd(const char *arg, uint16_t amsport,adsOctetOutputBufferType *buffer)
+int adsAsynPortDriver::octetMotorHandleADRCmd(const char *arg, uint16_t amsport,adsOctetSession *session)
 {
   const char* functionName = "octetMotorHandleADRCmd";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Command: %s, amsPort: %d\n",driverName,functionName,arg,(int)amsport);
 
+  adsOctetOutputBufferType *buffer=&session->asciiBuffer;
+
   const char *myarg_1 = NULL;
   unsigned group_no = 0;
   unsigned offset_in_group = 0;
@@ -2102,7 +4265,7 @@ int adsAsynPortDriver::octetMotorHandleADRCmd(const char *arg, uint16_t amsport,
   if (myarg_1) {
     myarg_1++; /* Jump over '=' */
 
-    int error=octetAdsWriteByGroupOffset(amsport,(uint32_t)group_no,(uint32_t) offset_in_group,(uint16_t)type_in_PLC,(uint32_t)len_in_PLC,myarg_1,buffer);
+    int error=octetAdsWriteByGroupOffset(amsport,(uint32_t)group_no,(uint32_t) offset_in_group,(uint16_t)type_in_PLC,(uint32_t)len_in_PLC,myarg_1,session);
     if (error){
       OCTET_RETURN_ERROR(buffer,error,"%s",adsErrorToString(error));
     }
@@ -2121,7 +4284,7 @@ int adsAsynPortDriver::octetMotorHandleADRCmd(const char *arg, uint16_t amsport,
     info.iGroup=group_no;
     info.iOffset=offset_in_group;
 
-    int error=octetAdsReadByGroupOffset(amsport,&info,buffer);
+    int error=octetAdsReadByGroupOffset(amsport,&info,session);
     if (error){
       OCTET_RETURN_ERROR(buffer,error,"%s",adsErrorToString(error));
     }
@@ -2135,11 +4298,11 @@ int adsAsynPortDriver::octetMotorHandleADRCmd(const char *arg, uint16_t amsport,
  * (see readOctet() and writeOctet for more info).
  * \param[in] amsport Ams-port.
  * \param[in] variableAddr Variable name ("Main.fTest")
- * \param[out] outBuffer Output buffer.
+ * \param[in,out] session Octet session (output and binary buffers).
  *
  * \return 0 for success or error code.
  */
-int adsAsynPortDriver::octetAdsReadByName(uint16_t amsPort,const char *variableAddr,adsOctetOutputBufferType* outBuffer)
+int adsAsynPortDriver::octetAdsReadByName(uint16_t amsPort,const char *variableAddr,adsOctetSession *session)
 {
   const char* functionName = "octetAdsReadByName";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Variable:%s, amsPort %u\n", driverName, functionName,variableAddr,amsPort);
@@ -2153,7 +4316,7 @@ int adsAsynPortDriver::octetAdsReadByName(uint16_t amsPort,const char *variableA
     return errorCode;
   }
 
-  return octetAdsReadByGroupOffset(amsPort,&infoStruct,outBuffer);
+  return octetAdsReadByGroupOffset(amsPort,&infoStruct,session);
 }
 
 /** Write a variable to PLC by symbolic addressing.\
@@ -2162,11 +4325,11 @@ int adsAsynPortDriver::octetAdsReadByName(uint16_t amsPort,const char *variableA
  * \param[in] amsport Ams-port.
  * \param[in] variableAddr Variable name ("Main.fTest")
  * \param[in] asciiValueToWrite Value to write in string format.
- * \param[out] outBuffer Output buffer.
+ * \param[in,out] session Octet session (output and binary buffers).
  *
  * \return 0 for success or error code.
  */
-int adsAsynPortDriver::octetAdsWriteByName(uint16_t amsPort,const char *variableAddr,const char *asciiValueToWrite,adsOctetOutputBufferType *outBuffer)
+int adsAsynPortDriver::octetAdsWriteByName(uint16_t amsPort,const char *variableAddr,const char *asciiValueToWrite,adsOctetSession *session)
 {
   const char* functionName = "octetAdsWriteByName";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Variable: %s, value: %s.\n", driverName, functionName,variableAddr,asciiValueToWrite);
@@ -2180,7 +4343,7 @@ int adsAsynPortDriver::octetAdsWriteByName(uint16_t amsPort,const char *variable
     return errorCode;
   }
 
- return octetAdsWriteByGroupOffset(amsPort,infoStruct.iGroup,infoStruct.iOffset,infoStruct.dataType,infoStruct.size,asciiValueToWrite,outBuffer);
+ return octetAdsWriteByGroupOffset(amsPort,infoStruct.iGroup,infoStruct.iOffset,infoStruct.dataType,infoStruct.size,asciiValueToWrite,session);
 }
 
 /**Read a variable from PLC by absolute addressing.\
@@ -2188,11 +4351,11 @@ int adsAsynPortDriver::octetAdsWriteByName(uint16_t amsPort,const char *variable
  * (see readOctet() and writeOctet for more info).
  * \param[in] amsport Ams-port.
  * \param[in] info Variable information.
- * \param[out] outBuffer Output buffer.
+ * \param[in,out] session Octet session (output and binary buffers).
  *
  * \return 0 for success or error code.
  */
-int adsAsynPortDriver::octetAdsReadByGroupOffset(uint16_t amsPort,adsSymbolEntry *info, adsOctetOutputBufferType *outBuffer)
+int adsAsynPortDriver::octetAdsReadByGroupOffset(uint16_t amsPort,adsSymbolEntry *info, adsOctetSession *session)
 {
   const char* functionName = "octetAdsReadByGroupOffset";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: amsPort: %d, group: %d, offset: %d, dataType: %s (%d), dataSize: %d.\n", driverName, functionName,(int)amsPort,(int)info->iGroup,(int)info->iOffset,adsTypeToString(info->dataType),(int)info->dataType,(int)info->size);
@@ -2200,30 +4363,29 @@ int adsAsynPortDriver::octetAdsReadByGroupOffset(uint16_t amsPort,adsSymbolEntry
   uint32_t bytesRead=0;
   AmsAddr amsServer={remoteNetId_,amsPort};
 
-  int dataSize=info->size;
-  if(info->size>ADS_CMD_BUFFER_SIZE){
-    dataSize=ADS_CMD_BUFFER_SIZE;
-    asynPrint(pasynUserSelf, ASYN_TRACE_WARNING, "%s:%s: Read buffer size smaller than size in plc.\n", driverName, functionName);
+  uint32_t dataSize=info->size;
+  if(info->size>session->binaryBufferSize){
+    dataSize=(uint32_t)session->binaryBufferSize;
+    asynPrint(pasynUserSelf, ASYN_TRACE_WARNING, "%s:%s: Read buffer size smaller than size in plc (%u>%lu). Increase with adsSetOctetBufferSize().\n", driverName, functionName,info->size,(unsigned long)session->binaryBufferSize);
   }
 
-  adsLock();
-  memset(&octetBinaryBuffer_,0,ADS_CMD_BUFFER_SIZE);
+  memset(session->binaryBuffer,0,dataSize);
 
-  int error = AdsSyncReadReqEx2(adsPort_, &amsServer, info->iGroup,info->iOffset,dataSize, &octetBinaryBuffer_, &bytesRead);
+  // Only the ADS transaction is shared between sessions
+  adsLock(ADS_LANE_ONDEMAND_READ);
+  int error = AdsSyncReadReqEx2(adsPort_, &amsServer, info->iGroup,info->iOffset,dataSize, session->binaryBuffer, &bytesRead);
+  adsUnlock();
 
   if (error) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: ADS read failed with: %s (0x%x).\n", driverName, functionName,adsErrorToString(error),error);
-    adsUnlock();
     return error;
   }
 
-  error=octetBinary2ascii(octetReturnVarName_,&octetBinaryBuffer_,ADS_CMD_BUFFER_SIZE,info,outBuffer);
+  error=octetBinary2ascii(session->returnVarName,session->binaryBuffer,(uint32_t)session->binaryBufferSize,info,&session->asciiBuffer);
   if (error) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Binary to ASCII conversion failed with: %d\n", driverName, functionName,error);
-    adsUnlock();
     return error;
   }
-  adsUnlock();
   return 0;
 }
 
@@ -2235,7 +4397,7 @@ int adsAsynPortDriver::octetAdsReadByGroupOffset(uint16_t amsPort,adsSymbolEntry
  * \param[in] offset Offset in group (address).
  * \param[in] dataType Data type to write (address).
  * \param[in] dataSize Bytes to write.
- * \param[out] asciiResponseBuffer Output buffer.
+ * \param[in,out] session Octet session (output and binary buffers).
  *
  * \return 0 for success or error code.
  *
@@ -2261,7 +4423,7 @@ int adsAsynPortDriver::octetAdsReadByGroupOffset(uint16_t amsPort,adsSymbolEntry
  *   The data will be considered to be an array if dataSize is bigger than the\n
  *   size of the the type.
  */
-int adsAsynPortDriver::octetAdsWriteByGroupOffset(uint16_t amsPort,uint32_t group, uint32_t offset,uint16_t dataType,uint32_t dataSize, const char *asciiValueToWrite,adsOctetOutputBufferType *asciiResponseBuffer)
+int adsAsynPortDriver::octetAdsWriteByGroupOffset(uint16_t amsPort,uint32_t group, uint32_t offset,uint16_t dataType,uint32_t dataSize, const char *asciiValueToWrite,adsOctetSession *session)
 {
   const char* functionName = "octetAdsWriteByGroupOffset";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: amsPort: %d, group: %d, offset: %d, dataType: %s (%d), dataSize: %d.\n", driverName, functionName,(int)amsPort,(int)group,(int)offset,adsTypeToString(dataType),(int)dataType,(int)dataSize);
@@ -2269,13 +4431,11 @@ int adsAsynPortDriver::octetAdsWriteByGroupOffset(uint16_t amsPort,uint32_t grou
   uint32_t bytesToWrite=0;
   AmsAddr amsServer={remoteNetId_,amsPort};
 
-  adsLock();
-  memset(&octetBinaryBuffer_,0,ADS_CMD_BUFFER_SIZE);
+  memset(session->binaryBuffer,0,dataSize<session->binaryBufferSize ? dataSize : session->binaryBufferSize);
 
-  int error=octetAscii2binary(asciiValueToWrite,dataType,&octetBinaryBuffer_,ADS_CMD_BUFFER_SIZE,&bytesToWrite);
+  int error=octetAscii2binary(asciiValueToWrite,dataType,session->binaryBuffer,(uint32_t)session->binaryBufferSize,&bytesToWrite);
   if(error){
-    adsUnlock();
-    octetCmdBuf_printf(asciiResponseBuffer,"Error: %x", error);
+    octetCmdBuf_printf(&session->asciiBuffer,"Error: %x", error);
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: ASCII to binary conversion failed with: %d.\n", driverName, functionName,error);
     return error;
   }
@@ -2284,15 +4444,16 @@ int adsAsynPortDriver::octetAdsWriteByGroupOffset(uint16_t amsPort,uint32_t grou
     bytesToWrite=dataSize;
   }
 
-  error = AdsSyncWriteReqEx(adsPort_, &amsServer, group, offset, bytesToWrite, &octetBinaryBuffer_);
+  // Only the ADS transaction is shared between sessions
+  adsLock(ADS_LANE_CONTROL_WRITE);
+  error = AdsSyncWriteReqEx(adsPort_, &amsServer, group, offset, bytesToWrite, session->binaryBuffer);
+  adsUnlock();
 
   if (error) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: ADS write failed with: %s (0x%x).\n", driverName, functionName,adsErrorToString(error),error);
-    adsUnlock();
     return error;
   }
 
-  adsUnlock();
   return 0;
 }
 
@@ -2325,108 +4486,49 @@ asynStatus adsAsynPortDriver::writeInt32(asynUser *pasynUser, epicsInt32 value)
       return setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     }
     // Write OK -> reset write alarm
-    if(paramInfo->alarmStatus==WRITE_ALARM){
+    if(paramInfo->hot->alarmStatus==WRITE_ALARM){
       return setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
     }
     return asynSuccess;
   }
 
-  uint8_t buffer[8]; //largest datatype is 8bytes
-  uint32_t maxBytesToWrite=0;
-  // Convert epicsInt32 to plctype if possible..
-  switch(paramInfo->plcDataType){
-    case ADST_INT8:
-      int8_t *ADST_INT8Var;
-      ADST_INT8Var=((int8_t*)buffer);
-      *ADST_INT8Var=(int8_t)value;
-      maxBytesToWrite=1;
-      break;
-    case ADST_INT16:
-      int16_t *ADST_INT16Var;
-      ADST_INT16Var=((int16_t*)buffer);
-      *ADST_INT16Var=(int16_t)value;
-      maxBytesToWrite=2;
-      break;
-    case ADST_INT32:
-      int32_t *ADST_INT32Var;
-      ADST_INT32Var=((int32_t*)buffer);
-      *ADST_INT32Var=(int32_t)value;
-      maxBytesToWrite=4;
-      break;
-    case ADST_INT64:
-      int64_t *ADST_INT64Var;
-      ADST_INT64Var=((int64_t*)buffer);
-      *ADST_INT64Var=(int64_t)value;
-      maxBytesToWrite=8;
-      break;
-    case ADST_UINT8:
-      uint8_t *ADST_UINT8Var;
-      ADST_UINT8Var=((uint8_t*)buffer);
-      *ADST_UINT8Var=(uint8_t)value;
-      maxBytesToWrite=1;
-      break;
-    case ADST_UINT16:
-      uint16_t *ADST_UINT16Var;
-      ADST_UINT16Var=((uint16_t*)buffer);
-      *ADST_UINT16Var=(uint16_t)value;
-      maxBytesToWrite=2;
-      break;
-    case ADST_UINT32:
-      uint32_t *ADST_UINT32Var;
-      ADST_UINT32Var=((uint32_t*)buffer);
-      *ADST_UINT32Var=(uint32_t)value;
-      maxBytesToWrite=4;
-      break;
-    case ADST_UINT64:
-      uint64_t *ADST_UINT64Var;
-      ADST_UINT64Var=((uint64_t*)buffer);
-      *ADST_UINT64Var=(uint64_t)value;
-      maxBytesToWrite=8;
-      break;
-    case ADST_REAL32:
-      float *ADST_REAL32Var;
-      ADST_REAL32Var=((float*)buffer);
-      *ADST_REAL32Var=(float)value;
-      maxBytesToWrite=4;
-      break;
-    case ADST_REAL64:
-      double *ADST_REAL64Var;
-      ADST_REAL64Var=((double*)buffer);
-      *ADST_REAL64Var=(double)value;
-      maxBytesToWrite=8;
-      break;
-    case ADST_BIT:
-      buffer[0]=value>0;
-      maxBytesToWrite=1;
-      break;
-    default:
-      asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types not compatible (epicsInt32 and %s). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType));
-      return asynError;
-      break;
+  //Special case. Flush write queue
+  if(paramInfo->dataSource==ADS_DATASOURCE_WRITE_FLUSH){
+    flushWriteQueue();
+    return asynSuccess;
   }
 
-  // Warning. Risk of loss of data..
-  if(sizeof(value)>maxBytesToWrite || sizeof(value)>paramInfo->plcSize){
-    asynPrint(pasynUser, ASYN_TRACE_WARNING, "%s:%s: WARNING. EPICS datatype size larger than PLC datatype size (%ld vs %d bytes).\n", driverName,functionName,sizeof(value),paramInfo->plcDataType);
-    paramInfo->plcDataTypeWarn=true;
+  //Special case. Write-behind statistics are read only
+  if(paramInfo->dataSource>=ADS_DATASOURCE_WRITE_BEHIND_SENT){
+    asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Parameter %s is read only. Write canceled.\n", driverName, functionName,paramInfo->drvInfo);
+    return asynError;
   }
 
+  if(!paramInfo->writeInt32Kernel){
+    asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types not compatible (epicsInt32 and %s). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType));
+    return asynError;
+  }
+
+  uint8_t buffer[8]; //largest datatype is 8bytes
+  uint32_t maxBytesToWrite=paramInfo->writeInt32Kernel(&value,buffer);
+
   //Ensure that PLC datatype and number of bytes to write match
-  if(maxBytesToWrite!=paramInfo->plcSize || maxBytesToWrite==0){
-    asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types size missmatch (%s and %d bytes). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),maxBytesToWrite);
+  if(maxBytesToWrite!=paramInfo->hot->plcSize || maxBytesToWrite==0){
+    asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types size mismatch (%s and %d bytes). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),maxBytesToWrite);
     setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     callParamCallbacks();
     return asynError;
   }
 
   //Do the write
-  if(adsWriteParam(paramInfo,(const void *)buffer,maxBytesToWrite)!=asynSuccess){
+  bool deferred=false;
+  if(adsWriteParam(paramInfo,(const void *)buffer,maxBytesToWrite,&deferred)!=asynSuccess){
     setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     callParamCallbacks();
     return asynError;
   }
-  //Only reset if write alarm
-  if(paramInfo->alarmStatus==WRITE_ALARM){
+  //Only reset if write alarm (queued writes: reset when sent)
+  if(!deferred && paramInfo->hot->alarmStatus==WRITE_ALARM){
     setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
   }
 
@@ -2463,94 +4565,34 @@ asynStatus adsAsynPortDriver::writeFloat64(asynUser *pasynUser, epicsFloat64 val
       return setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     }
     // Write OK -> reset write alarm
-    if(paramInfo->alarmStatus==WRITE_ALARM){
+    if(paramInfo->hot->alarmStatus==WRITE_ALARM){
       return setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
     }
     return asynSuccess;
   }
 
-  uint8_t buffer[8]; //largest datatype is 8bytes
-  uint32_t maxBytesToWrite=0;
-  // Convert epicsFloat64 to plctype if possible..
-  switch(paramInfo->plcDataType){
-    case ADST_INT8:
-      int8_t *ADST_INT8Var;
-      ADST_INT8Var=((int8_t*)buffer);
-      *ADST_INT8Var=(int8_t)value;
-      maxBytesToWrite=1;
-      break;
-    case ADST_INT16:
-      int16_t *ADST_INT16Var;
-      ADST_INT16Var=((int16_t*)buffer);
-      *ADST_INT16Var=(int16_t)value;
-      maxBytesToWrite=2;
-      break;
-    case ADST_INT32:
-      int32_t *ADST_INT32Var;
-      ADST_INT32Var=((int32_t*)buffer);
-      *ADST_INT32Var=(int32_t)value;
-      maxBytesToWrite=4;
-      break;
-    case ADST_INT64:
-      int64_t *ADST_INT64Var;
-      ADST_INT64Var=((int64_t*)buffer);
-      *ADST_INT64Var=(int64_t)value;
-      maxBytesToWrite=8;
-      break;
-    case ADST_UINT8:
-      uint8_t *ADST_UINT8Var;
-      ADST_UINT8Var=((uint8_t*)buffer);
-      *ADST_UINT8Var=(uint8_t)value;
-      maxBytesToWrite=1;
-      break;
-    case ADST_UINT16:
-      uint16_t *ADST_UINT16Var;
-      ADST_UINT16Var=((uint16_t*)buffer);
-      *ADST_UINT16Var=(uint16_t)value;
-      maxBytesToWrite=2;
-      break;
-    case ADST_UINT32:
-      uint32_t *ADST_UINT32Var;
-      ADST_UINT32Var=((uint32_t*)buffer);
-      *ADST_UINT32Var=(uint32_t)value;
-      maxBytesToWrite=4;
-      break;
-    case ADST_UINT64:
-      uint64_t *ADST_UINT64Var;
-      ADST_UINT64Var=((uint64_t*)buffer);
-      *ADST_UINT64Var=(uint64_t)value;
-      maxBytesToWrite=8;
-      break;
-    case ADST_REAL32:
-      float *ADST_REAL32Var;
-      ADST_REAL32Var=((float*)buffer);
-      *ADST_REAL32Var=(float)value;
-      maxBytesToWrite=4;
-      break;
-    case ADST_REAL64:
-      double *ADST_REAL64Var;
-      ADST_REAL64Var=((double*)buffer);
-      *ADST_REAL64Var=(double)value;
-      maxBytesToWrite=8;
-      break;
-    case ADST_BIT:
-      buffer[0]=value>0;
-      maxBytesToWrite=1;
-      break;
-    default:
-      asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types not compatible (epicsInt32 and %s). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType));
-      return asynError;
-      break;
+  //Special case. Flush write queue
+  if(paramInfo->dataSource==ADS_DATASOURCE_WRITE_FLUSH){
+    flushWriteQueue();
+    return asynSuccess;
   }
 
-  // Warning. Risk of loss of data..
-  if(sizeof(value)>maxBytesToWrite || sizeof(value)>paramInfo->plcSize){
-    asynPrint(pasynUser, ASYN_TRACE_WARNING, "%s:%s: WARNING. EPICS datatype size larger than PLC datatype size (%ld vs %d bytes).\n", driverName,functionName,sizeof(value),paramInfo->plcDataType);
-    paramInfo->plcDataTypeWarn=true;
+  //Special case. Write-behind statistics are read only
+  if(paramInfo->dataSource>=ADS_DATASOURCE_WRITE_BEHIND_SENT){
+    asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Parameter %s is read only. Write canceled.\n", driverName, functionName,paramInfo->drvInfo);
+    return asynError;
   }
 
+  if(!paramInfo->writeFloat64Kernel){
+    asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types not compatible (epicsFloat64 and %s). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType));
+    return asynError;
+  }
+
+  uint8_t buffer[8]; //largest datatype is 8bytes
+  uint32_t maxBytesToWrite=paramInfo->writeFloat64Kernel(&value,buffer);
+
   //Ensure that PLC datatype and number of bytes to write match
-  if(maxBytesToWrite!=paramInfo->plcSize || maxBytesToWrite==0){
+  if(maxBytesToWrite!=paramInfo->hot->plcSize || maxBytesToWrite==0){
     asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types size mismatch (%s and %d bytes). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),maxBytesToWrite);
     setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     callParamCallbacks();
@@ -2558,14 +4600,15 @@ asynStatus adsAsynPortDriver::writeFloat64(asynUser *pasynUser, epicsFloat64 val
   }
 
   //Do the write
-  if(adsWriteParam(paramInfo,(const void *)buffer,maxBytesToWrite)!=asynSuccess){
+  bool deferred=false;
+  if(adsWriteParam(paramInfo,(const void *)buffer,maxBytesToWrite,&deferred)!=asynSuccess){
     setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     callParamCallbacks();
     return asynError;
   }
 
-  //Only reset if write alarm
-  if(paramInfo->alarmStatus==WRITE_ALARM){
+  //Only reset if write alarm (queued writes: reset when sent)
+  if(!deferred && paramInfo->hot->alarmStatus==WRITE_ALARM){
     setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
   }
 
@@ -2573,10 +4616,10 @@ asynStatus adsAsynPortDriver::writeFloat64(asynUser *pasynUser, epicsFloat64 val
 }
 
 /** Read array of a certain data type from PLC (or actually
- * paramlib,paraminfor->arrayDataBuffer, since all variables are updated
- * on-change by callbacks).
+ * paraminfo->hot->arrayStore, since all variables are updated on-change by
+ * callbacks). Data in the store is already in EPICS representation.
  * \param[in] pasynUser Pointer to asyn user structure
- * \param[in] allowedType Allowed ads type to read.
+ * \param[in] allowedType EPICS array element type (ads type).
  * \param[out] epicsDataBuffer Output buffer.
  * \param[in] nEpicsBufferBytes Output buffer size.
  * \param[out] nBytesRead Bytes read into buffer.
@@ -2599,41 +4642,44 @@ asynStatus adsAsynPortDriver::adsGenericArrayRead(asynUser *pasynUser,long allow
 
   adsParamInfo *paramInfo=pAdsParamArray_[paramIndex];
 
-  //Only support same datatype as in PLC
-  if(paramInfo->plcDataType!=allowedType){
+  //Type combination checked in selectConversionKernels()
+  if(paramInfo->arrayEpicsType!=allowedType || !paramInfo->hot->updateKernel){
     asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types not compatible (%s vs %s). Read canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),adsTypeToString(allowedType));
     setAlarmParam(paramInfo,READ_ALARM,INVALID_ALARM);
     return asynError;
   }
 
-  size_t bytesToWrite=nEpicsBufferBytes;
-  if(paramInfo->plcSize<nEpicsBufferBytes){
-    bytesToWrite=paramInfo->plcSize;
-  }
-
-  if(!paramInfo->arrayDataBuffer || !epicsDataBuffer){
+  if(!paramInfo->hot->arrayStore || !epicsDataBuffer){
     asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Buffer(s) NULL. Read canceled.\n", driverName, functionName);
     setAlarmParam(paramInfo,READ_ALARM,INVALID_ALARM);
     return asynError;
   }
 
-  memcpy(epicsDataBuffer,paramInfo->arrayDataBuffer,bytesToWrite);
+  size_t bytesUsed=0;
+  const void *data=adsArrayStoreReadLock(paramInfo->hot->arrayStore,&bytesUsed);
+  size_t bytesToWrite=nEpicsBufferBytes;
+  if(bytesUsed<nEpicsBufferBytes){
+    bytesToWrite=bytesUsed;
+  }
+  memcpy(epicsDataBuffer,data,bytesToWrite);
+  adsArrayStoreReadUnlock(paramInfo->hot->arrayStore);
   *nBytesRead=bytesToWrite;
 
   //Only reset if read alarm
-  if(paramInfo->alarmStatus==READ_ALARM){
+  if(paramInfo->hot->alarmStatus==READ_ALARM){
     setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
   }
 
   //update timestamp
-  pasynUser->timestamp=paramInfo->epicsTimestamp;
+  pasynUser->timestamp=paramInfo->hot->epicsTimestamp;
 
   return asynSuccess;
 }
 
-/** Write array of a certain data type to PLC.
+/** Write array of a certain data type to PLC. Data is converted if the PLC
+ * element type differs from the EPICS element type.
  * \param[in] pasynUser Pointer to asyn user structure
- * \param[in] allowedType Allowed ads type to read.
+ * \param[in] allowedType EPICS array element type (ads type).
  * \param[out] data Data to write.
  * \param[in] nEpicsBufferBytes Bytes to write.
  *
@@ -2655,32 +4701,56 @@ asynStatus adsAsynPortDriver::adsGenericArrayWrite(asynUser *pasynUser,long allo
 
   adsParamInfo *paramInfo=pAdsParamArray_[paramIndex];
 
-  //Only support same datatype as in PLC
-  if(paramInfo->plcDataType!=allowedType){
+  //Type combination checked in selectConversionKernels()
+  if(paramInfo->arrayEpicsType!=allowedType || !paramInfo->hot->updateKernel){
     asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Data types not compatible (%s vs %s). Write canceled.\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),adsTypeToString(allowedType));
     setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     return asynError;
   }
 
+  const void *epicsData=data;
   size_t bytesToWrite=nEpicsBufferBytes;
-  if(paramInfo->plcSize<nEpicsBufferBytes){
-    bytesToWrite=paramInfo->plcSize;
+  if(paramInfo->hot->plcSize<nEpicsBufferBytes){
+    bytesToWrite=paramInfo->hot->plcSize;
+  }
+
+  //Convert to PLC type
+  if(paramInfo->arrayWriteKernel){
+    if(!paramInfo->arrayConvBuffer){
+      asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: Conversion buffer NULL. Write canceled.\n", driverName, functionName);
+      setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
+      return asynError;
+    }
+    size_t nElements=nEpicsBufferBytes/adsTypeSize(allowedType);
+    if(paramInfo->hot->plcSize/paramInfo->plcElementSize<nElements){
+      nElements=paramInfo->hot->plcSize/paramInfo->plcElementSize;
+    }
+    paramInfo->arrayWriteKernel(data,paramInfo->arrayConvBuffer,nElements);
+    data=paramInfo->arrayConvBuffer;
+    bytesToWrite=nElements*paramInfo->plcElementSize;
   }
 
   //Write to ADS
-  asynStatus stat=adsWriteParam(paramInfo,data,bytesToWrite);
+  bool deferred=false;
+  asynStatus stat=adsWriteParam(paramInfo,data,bytesToWrite,&deferred);
   if(stat!=asynSuccess){
     setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
     return asynError;
   }
 
-  //copy data to buffer;
-  if(paramInfo->arrayDataBuffer){
-    memcpy(paramInfo->arrayDataBuffer,data,bytesToWrite);
+  //publish written data (EPICS representation)
+  if(paramInfo->hot->arrayStore){
+    void *storeBuffer=adsArrayStoreWriteLock(paramInfo->hot->arrayStore);
+    size_t bytesToStore=nEpicsBufferBytes;
+    if(paramInfo->hot->arrayStore->size<bytesToStore){
+      bytesToStore=paramInfo->hot->arrayStore->size;
+    }
+    memcpy(storeBuffer,epicsData,bytesToStore);
+    adsArrayStoreWriteUnlock(paramInfo->hot->arrayStore,bytesToStore);
   }
 
-  //Only reset if write alarm
-  if(paramInfo->alarmStatus==WRITE_ALARM){
+  //Only reset if write alarm (queued writes: reset when sent)
+  if(!deferred && paramInfo->hot->alarmStatus==WRITE_ALARM){
     setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
   }
 
@@ -2706,17 +4776,9 @@ asynStatus adsAsynPortDriver::readInt8Array(asynUser *pasynUser,epicsInt8 *value
     return asynError;
   }
 
+  //String and bool arrays are also read/written as int8array (see adsArrayTypesIdentical())
   long allowedType=ADST_INT8;
 
-  //Also allow string and bool array as int8array (special case)
-  if(pAdsParamArray_[pasynUser->reason]->plcDataType==ADST_STRING){
-    allowedType=ADST_STRING;
-  }
-  else if(pAdsParamArray_[pasynUser->reason]->plcDataType==ADST_BIT){
-    allowedType=ADST_BIT;
-  }
-
-
   size_t nBytesRead=0;
   asynStatus stat=adsGenericArrayRead(pasynUser, allowedType,(void *)value,nElements*sizeof(epicsInt8),&nBytesRead);
   if(stat!=asynSuccess){
@@ -2740,16 +4802,8 @@ asynStatus adsAsynPortDriver::writeInt8Array(asynUser *pasynUser, epicsInt8 *val
   asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
 
+  //String and bool arrays are also read/written as int8array (see adsArrayTypesIdentical())
   long allowedType=ADST_INT8;
-
-  //Also allow string and bool array as int8array (special case)
-  if(pAdsParamArray_[pasynUser->reason]->plcDataType==ADST_STRING){
-    allowedType=ADST_STRING;
-  }
-  else if(pAdsParamArray_[pasynUser->reason]->plcDataType==ADST_BIT){
-    allowedType=ADST_BIT;
-  }
-
   return adsGenericArrayWrite(pasynUser,allowedType,(const void *)value,nElements*sizeof(epicsInt8));
 }
 
@@ -2920,7 +4974,23 @@ asynStatus adsAsynPortDriver::writeFloat64Array(asynUser *pasynUser,epicsFloat64
   asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
   long allowedType=ADST_REAL64;
-  return adsGenericArrayWrite(pasynUser,allowedType,(const void *)value,nElements*nElements*sizeof(epicsFloat64));
+  return adsGenericArrayWrite(pasynUser,allowedType,(const void *)value,nElements*sizeof(epicsFloat64));
+}
+
+/** Get index of driver in driver registry (used in hUser of ADS notifications).
+ * \return driver index.
+ */
+int adsAsynPortDriver::getDriverIndex()
+{
+  return driverIndex_;
+}
+
+/** Get model of the PLC clock (fed by ADS notifications).
+ * \return clock model.
+ */
+adsClockModel *adsAsynPortDriver::getClockModel()
+{
+  return &clockModel_;
 }
 
 /** Returns pasynUserSelf for use in asynPrint().
@@ -2963,7 +5033,7 @@ asynStatus adsAsynPortDriver::adsGetSymHandleByName(adsParamInfo *paramInfo,bool
   amsServer={remoteNetId_,paramInfo->amsPort};
 
   uint32_t symbolHandle=0;
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   const long handleStatus = AdsSyncReadWriteReqEx2(adsPort_,
                                                    &amsServer,
                                                    ADSIGRP_SYM_HNDBYNAME,
@@ -3009,14 +5079,14 @@ asynStatus adsAsynPortDriver::adsAddSymbolsChangedCallback(amsPortInfo *port)
   attrib.nCycleTime=(uint32_t)(defaultSampleTimeMS_*10000);
 
   uint32_t hNotify=0;
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   long addStatus = AdsSyncAddDeviceNotificationReqEx(adsPort_,
                                                      &amsServer,
                                                      ADSIGRP_SYM_VERSION,
                                                      0,
                                                      &attrib,
                                                      &adsSymbolsChangedCallback,
-                                                     (uint32_t)port->amsPort,  //Use amsPort as hUser
+                                                     ADS_HUSER(driverIndex_,port->amsPort),  //Use amsPort as hUser
                                                      &hNotify);
   adsUnlock();
   if (addStatus){
@@ -3032,32 +5102,110 @@ asynStatus adsAsynPortDriver::adsAddSymbolsChangedCallback(amsPortInfo *port)
   return asynSuccess;
 }
 
-/** Unregister on-change callback for symbols version
- *
- * \param[in] port Structure containig Ams-port information.
- *
+/** Unregister on-change callback for symbols version
+ *
+ * \param[in] port Structure containig Ams-port information.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsDelSymbolsChangedCallback(amsPortInfo *port)
+{
+  const char* functionName = "adsDelSymbolsChangedCallback";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
+
+  AmsAddr amsServer;
+  amsServer={remoteNetId_,port->amsPort};
+
+  adsLock(ADS_LANE_SUBSCRIPTION);
+  const long delStatus = AdsSyncDelDeviceNotificationReqEx(adsPort_, &amsServer,port->hCallbackNotify);
+  adsUnlock();
+  port->bCallbackNotifyValid=false;
+  port->hCallbackNotify=-1;
+
+  if (delStatus){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Delete device notification failed with: %s (0x%lx)\n", driverName, functionName,adsErrorToString(delStatus),delStatus);
+    return asynError;
+  }
+
+  return asynSuccess;
+}
+
+/** Subscribe to ads state changes of an ams port (ADSIGRP_DEVICE_DATA).
+ * \param[in] port Ams port info.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsAddStateCallback(amsPortInfo *port)
+{
+  const char* functionName = "adsAddStateCallback";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u.\n", driverName, functionName,port->amsPort);
+
+  AmsAddr amsServer={remoteNetId_,port->amsPort};
+
+  AdsNotificationAttrib attrib;
+  attrib.cbLength=sizeof(uint16_t);
+  attrib.nTransMode=ADSTRANS_SERVERONCHA;
+  attrib.nMaxDelay=0;
+  attrib.nCycleTime=0;
+
+  uint32_t hNotify=0;
+  adsLock(ADS_LANE_SUBSCRIPTION);
+  long addStatus = AdsSyncAddDeviceNotificationReqEx(adsPort_,
+                                                     &amsServer,
+                                                     ADSIGRP_DEVICE_DATA,
+                                                     ADSIOFFS_DEVDATA_ADSSTATE,
+                                                     &attrib,
+                                                     &adsStateCallback,
+                                                     ADS_HUSER(driverIndex_,port->amsPort),
+                                                     &hNotify);
+  adsUnlock();
+  if (addStatus){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Add ads state notification for Ams-port %u failed with: %s (0x%lx)\n", driverName, functionName,port->amsPort,adsErrorToString(addStatus),addStatus);
+    return asynError;
+  }
+
+  port->hStateNotify=hNotify;
+  port->bStateNotifyValid=true;
+  return asynSuccess;
+}
+
+/** Delete ads state notification of an ams port.
+ * \param[in] port Ams port info.
  * \return asynSuccess or asynError.
  */
-asynStatus adsAsynPortDriver::adsDelSymbolsChangedCallback(amsPortInfo *port)
+asynStatus adsAsynPortDriver::adsDelStateCallback(amsPortInfo *port)
 {
-  const char* functionName = "adsDelSymbolsChangedCallback";
-  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
-
-  AmsAddr amsServer;
-  amsServer={remoteNetId_,port->amsPort};
+  const char* functionName = "adsDelStateCallback";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u.\n", driverName, functionName,port->amsPort);
 
-  adsLock();
-  const long delStatus = AdsSyncDelDeviceNotificationReqEx(adsPort_, &amsServer,port->hCallbackNotify);
+  AmsAddr amsServer={remoteNetId_,port->amsPort};
+  adsLock(ADS_LANE_SUBSCRIPTION);
+  AdsSyncDelDeviceNotificationReqEx(adsPort_,&amsServer,port->hStateNotify);  //Fails if link is down
   adsUnlock();
-  port->bCallbackNotifyValid=false;
-  port->hCallbackNotify=-1;
+  port->bStateNotifyValid=false;
+  port->hStateNotify=-1;
+  return asynSuccess;
+}
 
-  if (delStatus){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Delete device notification failed with: %s (0x%lx)\n", driverName, functionName,adsErrorToString(delStatus),delStatus);
-    return asynError;
-  }
+/** New ads state of an ams port from notification (adsStateCallback()).
+ * Updates the ams state parameter and wakes cyclicThread() to handle
+ * the connection change without waiting for the next heartbeat.
+ * \param[in] amsPort Ams port.
+ * \param[in] adsState New ads state.
+ */
+void adsAsynPortDriver::adsStateNotify(uint16_t amsPort,uint16_t adsState)
+{
+  const char* functionName = "adsStateNotify";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u: %s.\n", driverName, functionName,amsPort,adsStateToString(adsState));
 
-  return asynSuccess;
+  amsPortInfo *port=getAmsPortObject(amsPort);
+  if(!port){
+    return;
+  }
+  port->adsStateNotified=adsState;
+  if(port->paramInfo && port->paramInfo->dataSource==ADS_DATASOURCE_AMS_STATE){
+    adsUpdateParameterLock(port->paramInfo,&adsState);
+  }
+  epicsEventSignal(cyclicEvent_);
 }
 
 /** Register on-change callback for parameter (plc-variable).
@@ -3090,7 +5238,7 @@ asynStatus adsAsynPortDriver::adsAddDataCallback(adsParamInfo *paramInfo)
   }
   else{ // Symbolic access
 
-    // Read symbolic information if needed (to get paramInfo->plcSize)
+    // Read symbolic information if needed (to get paramInfo->hot->plcSize)
     if(!paramInfo->plcAbsAdrValid){
       asynStatus statusInfo=adsGetSymInfoByName(paramInfo);
       if(statusInfo!=asynSuccess){
@@ -3114,26 +5262,29 @@ asynStatus adsAsynPortDriver::adsAddDataCallback(adsParamInfo *paramInfo)
 
   AdsNotificationAttrib attrib;
   /** Length of the data that is to be passed to the callback function. */
-  attrib.cbLength=paramInfo->plcSize;
+  attrib.cbLength=paramInfo->hot->plcSize;
   /**
   * ADSTRANS_SERVERCYCLE: The notification's callback function is invoked cyclically.
   * ADSTRANS_SERVERONCHA: The notification's callback function is only invoked when the value changes.
   */
   attrib.nTransMode=ADSTRANS_SERVERONCHA;  //Add option
   /** The notification's callback function is invoked at the latest when this time has elapsed. The unit is 100 ns. */
-  attrib.nMaxDelay=(uint32_t)(paramInfo->maxDelayTimeMS*10000); // 100ms
+  double sampleTimeMS=0;
+  double maxDelayTimeMS=0;
+  adsSharedRate(paramInfo,&sampleTimeMS,&maxDelayTimeMS);  //Fastest of all parameters fed by this subscription
+  attrib.nMaxDelay=(uint32_t)(maxDelayTimeMS*10000); // 100ms
   /** The ADS server checks whether the variable has changed after this time interval. The unit is 100 ns. */
-  attrib.nCycleTime=(uint32_t)(paramInfo->sampleTimeMS*10000);
+  attrib.nCycleTime=(uint32_t)(sampleTimeMS*10000);
 
   uint32_t hNotify=0;
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   long addStatus = AdsSyncAddDeviceNotificationReqEx(adsPort_,
                                                      &amsServer,
                                                      group,
                                                      offset,
                                                      &attrib,
                                                      &adsDataCallback,
-                                                     (uint32_t)paramInfo->paramIndex,
+                                                     ADS_HUSER(driverIndex_,paramInfo->paramIndex),
                                                      &hNotify);
   adsUnlock();
   if (addStatus){
@@ -3177,7 +5328,7 @@ asynStatus adsAsynPortDriver::adsDelDataCallback(adsParamInfo *paramInfo,bool bl
   AmsAddr amsServer;
   amsServer={remoteNetId_,paramInfo->amsPort};
 
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   const long delStatus = AdsSyncDelDeviceNotificationReqEx(adsPort_, &amsServer,paramInfo->hCallbackNotify);
   paramInfo->hCallbackNotify=-1;
   adsUnlock();
@@ -3228,7 +5379,7 @@ asynStatus adsAsynPortDriver::adsGetSymInfoByName(uint16_t amsPort,const char *v
   AmsAddr amsServer;
 
   amsServer={remoteNetId_,amsPort};
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   const long infoStatus = AdsSyncReadWriteReqEx2(adsPort_,
                                                  &amsServer,
                                                  ADSIGRP_SYM_INFOBYNAMEEX,
@@ -3244,10 +5395,11 @@ asynStatus adsAsynPortDriver::adsGetSymInfoByName(uint16_t amsPort,const char *v
   if (infoStatus) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Get symbolic information failed for %s with: %s (0x%lx)\n", driverName, functionName,varName,adsErrorToString(infoStatus),infoStatus);
     if (infoStatus == GLOBALERR_TARGET_PORT) {
-        /* Sigh.  It was up, now it's down.  Let's go home. */
-        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Port error, giving up!\n",
-                  driverName, functionName);
-        exit(1);
+        // Target gone. Stop the refresh, cyclicThread() retries when the port is back.
+        amsPortInfo *port=getAmsPortObject(amsPort);
+        if(port){
+          port->targetPortLost=true;
+        }
     }
     return asynError;
   }
@@ -3296,7 +5448,9 @@ asynStatus adsAsynPortDriver::adsGetSymInfoByName(adsParamInfo *paramInfo)
   adsSymbolEntry infoStruct;
   memset(&infoStruct,0,sizeof(infoStruct));
 
-  asynStatus stat=adsGetSymInfoByName(paramInfo->amsPort,paramInfo->plcAdrStr,&infoStruct);
+  long errorCode=0;
+  asynStatus stat=adsGetSymInfoByName(paramInfo->amsPort,paramInfo->plcAdrStr,&infoStruct,&errorCode);
+  paramInfo->symbolMissing=(errorCode==ADSERR_DEVICE_SYMBOLNOTFOUND);
   if (stat) {
     return asynError;
   }
@@ -3304,7 +5458,7 @@ asynStatus adsAsynPortDriver::adsGetSymInfoByName(adsParamInfo *paramInfo)
   //fill paramInfo data structure
   paramInfo->plcAbsAdrGroup=infoStruct.iGroup;
   paramInfo->plcAbsAdrOffset=infoStruct.iOffset;
-  paramInfo->plcSize=infoStruct.size;
+  paramInfo->hot->plcSize=infoStruct.size;
   paramInfo->plcDataType=infoStruct.dataType;
   paramInfo->plcAbsAdrValid=true;
 
@@ -3328,7 +5482,7 @@ asynStatus adsAsynPortDriver::adsConnect()
     if (stat!=asynSuccess) {
       adsDelRoute(1);
       if (adsPort_) {
-          adsLock();
+          adsLock(ADS_LANE_SUBSCRIPTION);
           AdsPortCloseEx(adsPort_);
           adsPort_=0;
           adsUnlock();
@@ -3338,7 +5492,7 @@ asynStatus adsAsynPortDriver::adsConnect()
   }
 
   // open a new ADS port
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   if (!adsPort_)
       adsPort_ = AdsPortOpenEx();
   adsUnlock();
@@ -3349,14 +5503,14 @@ asynStatus adsAsynPortDriver::adsConnect()
   asynPrint(pasynUserSelf, ASYN_TRACE_FLOW, "%s:%s:Open ADS port = %ld.\n", driverName, functionName, adsPort_);
   // Update timeout
   uint32_t defaultTimeout=0;
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   long status=AdsSyncGetTimeoutEx(adsPort_,&defaultTimeout);
   adsUnlock();
   if(status) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: AdsSyncGetTimeoutEx failed with: %s (0x%lx).\n", driverName, functionName,adsErrorToString(status),status);
     return asynError;
   }
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   status=AdsSyncSetTimeoutEx(adsPort_,(uint32_t)adsTimeoutMS_);
   adsUnlock();
   if(status) {
@@ -3383,7 +5537,7 @@ asynStatus adsAsynPortDriver::adsReadVersion(amsPortInfo *port)
   char devName[255];
   amsServer={remoteNetId_,port->amsPort};
 
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   long status=AdsSyncReadDeviceInfoReqEx(adsPort_,&amsServer,devName,&version);
   adsUnlock();
   if(status) {
@@ -3396,6 +5550,108 @@ asynStatus adsAsynPortDriver::adsReadVersion(amsPortInfo *port)
   return asynSuccess;
 }
 
+/** Read symbol version of an ams port (ADSIGRP_SYM_VERSION, incremented by
+ * the PLC at each online change or download).
+ * \param[in] port Ams port info.
+ * \param[out] symVersion Symbol version.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsReadSymVersion(amsPortInfo *port,uint8_t *symVersion)
+{
+  const char* functionName = "adsReadSymVersion";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u\n", driverName, functionName,port->amsPort);
+
+  AmsAddr amsServer={remoteNetId_,port->amsPort};
+  uint32_t bytesRead=0;
+  adsLock(ADS_LANE_SUBSCRIPTION);
+  long status=AdsSyncReadReqEx2(adsPort_,&amsServer,ADSIGRP_SYM_VERSION,0,sizeof(*symVersion),symVersion,&bytesRead);
+  adsUnlock();
+  if(status || bytesRead!=sizeof(*symVersion)) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Read of symbol version failed with: %s (0x%lx).\n", driverName, functionName,adsErrorToString(status),status);
+    return asynError;
+  }
+  return asynSuccess;
+}
+
+/** Read symbol upload info of an ams port (ADSIGRP_SYM_UPLOADINFO: number
+ * of symbols and size of the symbol table).
+ * \param[in] port Ams port info.
+ * \param[out] symCount Number of symbols.
+ * \param[out] symSize Size of symbol table.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsReadSymUploadInfo(amsPortInfo *port,uint32_t *symCount,uint32_t *symSize)
+{
+  const char* functionName = "adsReadSymUploadInfo";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: Ams-port %u\n", driverName, functionName,port->amsPort);
+
+  AmsAddr amsServer={remoteNetId_,port->amsPort};
+  uint32_t info[2]={0,0};
+  uint32_t bytesRead=0;
+  adsLock(ADS_LANE_SUBSCRIPTION);
+  long status=AdsSyncReadReqEx2(adsPort_,&amsServer,ADSIGRP_SYM_UPLOADINFO,0,sizeof(info),info,&bytesRead);
+  adsUnlock();
+  if(status || bytesRead!=sizeof(info)) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Read of symbol upload info failed with: %s (0x%lx).\n", driverName, functionName,adsErrorToString(status),status);
+    return asynError;
+  }
+  *symCount=info[0];
+  *symSize=info[1];
+  return asynSuccess;
+}
+
+/** Read PLC time and add it to the PLC clock model (explicit sample, time
+ * of the middle of the request). See setClockRead().
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsReadPlcClock()
+{
+  const char* functionName = "adsReadPlcClock";
+
+  AmsAddr amsServer={remoteNetId_,clockReadAmsPort_};
+  uint64_t plcTime=0;
+  uint32_t bytesRead=0;
+  adsLock(ADS_LANE_POLL);
+  int64_t requestNs=adsClockHostNs();
+  long status=AdsSyncReadReqEx2(adsPort_,&amsServer,clockReadGroup_,clockReadOffset_,sizeof(plcTime),&plcTime,&bytesRead);
+  requestNs+=(adsClockHostNs()-requestNs)/2;
+  adsUnlock();
+  if(!status && bytesRead!=sizeof(plcTime)){
+    status=ADS_COM_ERROR_ADS_READ_BUFFER_INDEX_EXCEEDED_SIZE;
+  }
+  if(status!=clockReadError_){
+    if(status){
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: PLC time read (ams-port %u, group 0x%x, offset 0x%x) failed with: %s (0x%lx).\n", driverName, functionName,clockReadAmsPort_,clockReadGroup_,clockReadOffset_,adsErrorToString(status),status);
+    }
+    else{
+      asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: PLC time read OK.\n", driverName, functionName);
+    }
+    clockReadError_=status;
+  }
+  if(status){
+    return asynError;
+  }
+  adsClockModelAddSample(&clockModel_,plcTime,requestNs,true);
+  return asynSuccess;
+}
+
+/** Read the symbol cache key of an ams port (symbol version and symbol
+ * upload info). The 8 bit symbol version alone can wrap or be the same
+ * after a download of another project.
+ * \param[in] port Ams port info.
+ * \param[out] key Key (amsPort, symVersion, symCount and symSize).
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsReadSymbolCacheKey(amsPortInfo *port,adsSymbolCachePort *key)
+{
+  memset(key,0,sizeof(*key));
+  key->amsPort=port->amsPort;
+  if(adsReadSymVersion(port,&key->symVersion)!=asynSuccess){
+    return asynError;
+  }
+  return adsReadSymUploadInfo(port,&key->symCount,&key->symSize);
+}
+
 /** Disconnect ads router (TwinCAT system).
  *
  * \return asynSuccess or asynError.
@@ -3405,7 +5661,7 @@ asynStatus adsAsynPortDriver::adsDisconnect()
   const char* functionName = "adsDisconnect";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: adsPort_=%ld\n", driverName, functionName, adsPort_);
 
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   const long closeStatus = AdsPortCloseEx(adsPort_);
   adsPort_ = 0;
   adsUnlock();
@@ -3445,7 +5701,7 @@ asynStatus adsAsynPortDriver::adsReleaseSymbolicHandle(adsParamInfo *paramInfo,
     AmsAddr amsServer;
     amsServer={remoteNetId_,paramInfo->amsPort};
 
-    adsLock();
+    adsLock(ADS_LANE_SUBSCRIPTION);
     const long releaseStatus = AdsSyncWriteReqEx(adsPort_, &amsServer, ADSIGRP_SYM_RELEASEHND, 0, sizeof(paramInfo->hSymbolicHandle), &paramInfo->hSymbolicHandle);
     adsUnlock();
     paramInfo->hSymbolicHandle=-1;
@@ -3459,6 +5715,217 @@ asynStatus adsAsynPortDriver::adsReleaseSymbolicHandle(adsParamInfo *paramInfo,
   return asynSuccess;
 }
 
+/** Send several read/write requests to one ams port as one
+ * ADSIGRP_SUMUP_READWRITE request.
+ *
+ * \param[in] amsPort Ams port.
+ * \param[in] lane Priority lane for adsMutex.
+ * \param[in/out] requests Sub requests. bytesRead and error are filled in.
+ * \param[in] count Number of sub requests.
+ *
+ * \return asynSuccess if the sum request was sent (check error of each
+ *  sub request) otherwise asynError.
+ */
+asynStatus adsAsynPortDriver::adsSumReadWrite(uint16_t amsPort,ADSLANE lane,adsSumRequest *requests,uint32_t count)
+{
+  const char* functionName = "adsSumReadWrite";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %u requests\n", driverName, functionName,count);
+
+  if(count==0){
+    return asynSuccess;
+  }
+
+  // Request: count*(group,offset,readLen,writeLen) followed by write data.
+  // Response: count*(error,length) followed by read data (length bytes each).
+  size_t requestSize=count*4*sizeof(uint32_t);
+  size_t responseSize=count*2*sizeof(uint32_t);
+  for(uint32_t i=0;i<count;i++){
+    requestSize+=requests[i].writeLen;
+    responseSize+=requests[i].readLen;
+  }
+  std::vector<uint8_t> request(requestSize);
+  std::vector<uint8_t> response(responseSize);
+  uint32_t *header=(uint32_t *)request.data();
+  uint8_t *payload=request.data()+count*4*sizeof(uint32_t);
+  for(uint32_t i=0;i<count;i++){
+    header[i*4]=requests[i].group;
+    header[i*4+1]=requests[i].offset;
+    header[i*4+2]=requests[i].readLen;
+    header[i*4+3]=requests[i].writeLen;
+    memcpy(payload,requests[i].writeData,requests[i].writeLen);
+    payload+=requests[i].writeLen;
+  }
+
+  AmsAddr amsServer={remoteNetId_,amsPort};
+  uint32_t bytesRead=0;
+  adsLock(lane);
+  long status=AdsSyncReadWriteReqEx2(adsPort_,&amsServer,
+                                     ADSIGRP_SUMUP_READWRITE,count,
+                                     (uint32_t)responseSize,response.data(),
+                                     (uint32_t)requestSize,request.data(),
+                                     &bytesRead);
+  adsUnlock();
+  if(status){
+    for(uint32_t i=0;i<count;i++){
+      requests[i].error=status;
+      requests[i].bytesRead=0;
+    }
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: ADS sum read/write (%u requests) failed with: %s (0x%lx)\n", driverName, functionName,count,adsErrorToString(status),status);
+    return asynError;
+  }
+
+  const uint32_t *results=(const uint32_t *)response.data();
+  const uint8_t *data=response.data()+count*2*sizeof(uint32_t);
+  const uint8_t *dataEnd=response.data()+bytesRead;
+  for(uint32_t i=0;i<count;i++){
+    uint32_t length=results[i*2+1];
+    requests[i].error=(long)results[i*2];
+    requests[i].bytesRead=0;
+    if(data+length>dataEnd || length>requests[i].readLen){
+      // Data of the following requests cannot be located either
+      for(uint32_t j=i;j<count;j++){
+        requests[j].error=ADS_COM_ERROR_ADS_READ_BUFFER_INDEX_EXCEEDED_SIZE;
+        requests[j].bytesRead=0;
+      }
+      break;
+    }
+    if(!requests[i].error && requests[i].readData){
+      memcpy(requests[i].readData,data,length);
+      requests[i].bytesRead=length;
+    }
+    data+=length;
+  }
+
+  return asynSuccess;
+}
+
+/** Check if any sub request of a sum request failed because the ams port is
+ * gone (GLOBALERR_TARGET_PORT).
+ * \param[in] requests Sub requests.
+ * \param[in] count Number of sub requests.
+ * \return true if the target port is lost.
+ */
+bool adsAsynPortDriver::adsSumTargetPortLost(const adsSumRequest *requests,uint32_t count)
+{
+  for(uint32_t i=0;i<count;i++){
+    if(requests[i].error==GLOBALERR_TARGET_PORT){
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Read symbol information and create symbol handles for several parameters
+ * of one ams port with two sum requests instead of two requests per parameter.
+ * Used by refreshParams() after a reconnect. Parameters that succeed get
+ * symInfoPrefetched/symHandlePrefetched set so that
+ * updateParamInfoWithPLCInfo() skips the single requests. Parameters that fail
+ * are left to the single requests (which also report the error). Symbol info
+ * already filled in from the symbol cache is not read again.
+ *
+ * \param[in] amsPort Ams port.
+ * \param[in/out] params Parameters to resolve.
+ * \param[in] count Number of parameters.
+ *
+ * \return asynSuccess or asynError (GLOBALERR_TARGET_PORT).
+ */
+asynStatus adsAsynPortDriver::adsResolveBatch(uint16_t amsPort,adsParamInfo **params,uint32_t count)
+{
+  const char* functionName = "adsResolveBatch";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %u symbols on ams port %u\n", driverName, functionName,count,amsPort);
+
+  std::vector<adsSumRequest> requests(count);
+  std::vector<adsSymbolEntry> infos(count);
+
+  // Symbol information (not for params already filled in from the symbol cache)
+  std::vector<uint32_t> infoIndex;
+  for(uint32_t i=0;i<count;i++){
+    if(params[i]->symInfoPrefetched){
+      continue;
+    }
+    adsSumRequest *req=&requests[infoIndex.size()];
+    memset(req,0,sizeof(adsSumRequest));
+    req->group=ADSIGRP_SYM_INFOBYNAMEEX;
+    req->readLen=sizeof(adsSymbolEntry);
+    req->readData=&infos[i];
+    req->writeLen=strlen(params[i]->plcAdrStr);
+    req->writeData=params[i]->plcAdrStr;
+    infoIndex.push_back(i);
+  }
+  if(!infoIndex.empty()){
+    if(adsSumReadWrite(amsPort,ADS_LANE_SUBSCRIPTION,requests.data(),infoIndex.size())!=asynSuccess ||
+       adsSumTargetPortLost(requests.data(),infoIndex.size())){
+      return asynError;
+    }
+  }
+  for(uint32_t n=0;n<infoIndex.size();n++){
+    uint32_t i=infoIndex[n];
+    if(requests[n].error){
+      continue;
+    }
+    params[i]->plcAbsAdrGroup=infos[i].iGroup;
+    params[i]->plcAbsAdrOffset=infos[i].iOffset;
+    params[i]->hot->plcSize=infos[i].size;
+    params[i]->plcDataType=infos[i].dataType;
+    params[i]->plcAbsAdrValid=true;
+    params[i]->symInfoPrefetched=true;
+  }
+
+  // Release old handles in one sum write (errors ignored, handles are gone after a PLC restart)
+  std::vector<uint32_t> handles;
+  for(uint32_t i=0;i<count;i++){
+    if(params[i]->bSymbolicHandleValid){
+      handles.push_back(params[i]->hSymbolicHandle);
+      params[i]->hSymbolicHandle=-1;
+      params[i]->bSymbolicHandleValid=false;
+    }
+  }
+  if(!handles.empty()){
+    uint32_t n=handles.size();
+    // Request: n*(group,offset,size) followed by the handles
+    std::vector<uint32_t> release(n*4);
+    for(uint32_t i=0;i<n;i++){
+      release[i*3]=ADSIGRP_SYM_RELEASEHND;
+      release[i*3+1]=0;
+      release[i*3+2]=sizeof(uint32_t);
+      release[n*3+i]=handles[i];
+    }
+    std::vector<uint32_t> results(n,0);
+    uint32_t bytesRead=0;
+    AmsAddr amsServer={remoteNetId_,amsPort};
+    adsLock(ADS_LANE_SUBSCRIPTION);
+    AdsSyncReadWriteReqEx2(adsPort_,&amsServer,ADSIGRP_SUMUP_WRITE,n,
+                           n*sizeof(uint32_t),results.data(),
+                           (uint32_t)(release.size()*sizeof(uint32_t)),release.data(),
+                           &bytesRead);
+    adsUnlock();
+  }
+
+  // Symbol handles
+  for(uint32_t i=0;i<count;i++){
+    adsSumRequest *req=&requests[i];
+    memset(req,0,sizeof(adsSumRequest));
+    req->group=ADSIGRP_SYM_HNDBYNAME;
+    req->readLen=sizeof(params[i]->hSymbolicHandle);
+    req->readData=&params[i]->hSymbolicHandle;
+    req->writeLen=strlen(params[i]->plcAdrStr);
+    req->writeData=params[i]->plcAdrStr;
+  }
+  if(adsSumReadWrite(amsPort,ADS_LANE_SUBSCRIPTION,requests.data(),count)!=asynSuccess ||
+     adsSumTargetPortLost(requests.data(),count)){
+    return asynError;
+  }
+  for(uint32_t i=0;i<count;i++){
+    if(requests[i].error || requests[i].bytesRead!=sizeof(params[i]->hSymbolicHandle)){
+      continue;
+    }
+    params[i]->bSymbolicHandleValid=true;
+    params[i]->symHandlePrefetched=true;
+  }
+
+  return asynSuccess;
+}
+
 /** Write value to variable in TwinCAT.
  *
  * \param[in] paramInfo Parameter information.
@@ -3468,6 +5935,23 @@ asynStatus adsAsynPortDriver::adsReleaseSymbolicHandle(adsParamInfo *paramInfo,
  * \return asynSuccess or asynError.
  */
 asynStatus adsAsynPortDriver::adsWriteParam(adsParamInfo *paramInfo,const void *binaryBuffer,uint32_t bytesToWrite)
+{
+  bool deferred=false;
+  return adsWriteParam(paramInfo,binaryBuffer,bytesToWrite,&deferred);
+}
+
+/** Write value to variable in TwinCAT.
+ *
+ * \param[in] paramInfo Parameter information.
+ * \param[in] binaryBuffer Data to write.
+ * \param[in] bytesToWrite Bytes to write.
+ * \param[out] deferred Set to true if the write is queued (write coalescing
+ *                      or write-behind). The result is then mapped to the
+ *                      write alarm when it is sent.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsWriteParam(adsParamInfo *paramInfo,const void *binaryBuffer,uint32_t bytesToWrite,bool *deferred)
 {
   const char* functionName = "adsWriteParam";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
@@ -3494,7 +5978,7 @@ asynStatus adsAsynPortDriver::adsWriteParam(adsParamInfo *paramInfo,const void *
   }
   else{ // Symbolic access
 
-    // Read symbolic information if needed (to get paramInfo->plcSize)
+    // Read symbolic information if needed (to get paramInfo->hot->plcSize)
     if(!paramInfo->plcAbsAdrValid){
       asynStatus statusInfo=adsGetSymInfoByName(paramInfo);
       if(statusInfo==asynError){
@@ -3515,14 +5999,33 @@ asynStatus adsAsynPortDriver::adsWriteParam(adsParamInfo *paramInfo,const void *
     group=ADSIGRP_SYM_VALBYHND;  //Access via symbolic handle stored in paramInfo->hSymbolicHandle
     offset=paramInfo->hSymbolicHandle;
   }
-  adsLock();
-  long writeStatus= AdsSyncWriteReqEx(adsPort_,
-                                      &amsServer,
-                                      group,
-                                      offset,
-                                      paramInfo->plcSize,
-                                      binaryBuffer);
-  adsUnlock();
+  if(bytesToWrite>paramInfo->hot->plcSize){
+    bytesToWrite=paramInfo->hot->plcSize;
+  }
+
+  *deferred=false;
+
+  // Write-behind: only the latest value is sent (in background)
+  if(paramInfo->isWriteBehind){
+    *deferred=true;
+    return adsWriteBehind(paramInfo,group,offset,binaryBuffer,bytesToWrite);
+  }
+
+  // Write coalescing: result is mapped to the write alarm when sent
+  writeQueueMutex_.lock();
+  int windowMS=writeCoalesceWindowMS_;
+  writeQueueMutex_.unlock();
+  if(windowMS>0 && (chunkSize_==0 || bytesToWrite<=chunkSize_)){
+    *deferred=true;
+    return adsQueueWrite(paramInfo,group,offset,binaryBuffer,bytesToWrite);
+  }
+
+  // Queued writes of this parameter must not be overtaken
+  adsFlushQueuedWrites(paramInfo);
+
+  long writeStatus=0;
+  adsWriteChunked(paramInfo,group,offset,binaryBuffer,bytesToWrite,&writeStatus);
+  adsTrace(ADS_TRACE_WRITE,driverIndex_,paramInfo->paramIndex,bytesToWrite,(int32_t)writeStatus,0);
   if (writeStatus) {
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: ADS write failed with: %s (0x%lx)\n", driverName, functionName,adsErrorToString(writeStatus),writeStatus);
     return asynError;
@@ -3578,7 +6081,7 @@ asynStatus adsAsynPortDriver::adsReadParam(adsParamInfo *paramInfo,long *error,i
   }
   else{ // Symbolic access
 
-    // Read symbolic information if needed (to get paramInfo->plcSize)
+    // Read symbolic information if needed (to get paramInfo->hot->plcSize)
     if(!paramInfo->plcAbsAdrValid){
       asynStatus statusInfo=adsGetSymInfoByName(paramInfo);
       if(statusInfo==asynError){
@@ -3600,37 +6103,377 @@ asynStatus adsAsynPortDriver::adsReadParam(adsParamInfo *paramInfo,long *error,i
     offset=paramInfo->hSymbolicHandle;
   }
 
-  char *data=new char[paramInfo->plcSize];
+  // Reused per thread: the chunked poll (bulk read thread) and a refresh
+  // (port lock) may read the same parameter at the same time
+  static thread_local std::vector<char> readBuffer;
+  if(readBuffer.size()<paramInfo->hot->plcSize){
+    readBuffer.resize(paramInfo->hot->plcSize);
+  }
+  char *data=readBuffer.data();
+  uint32_t bytesRead=0;
+  adsReadChunked(paramInfo,group,offset,(void *)data,paramInfo->hot->plcSize,&bytesRead,error);
+  adsTrace(ADS_TRACE_READ,driverIndex_,paramInfo->paramIndex,bytesRead,(int32_t)*error,0);
+  if(*error){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: AdsSyncReadReqEx2 failed: %s (%lu).\n", driverName, functionName,adsErrorToString(*error),*error);
+    return asynError;
+  }
+
+  if(bytesRead!=paramInfo->hot->plcSize){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Read bytes differ from parameter plc size (%u vs %u).\n", driverName, functionName,bytesRead,paramInfo->hot->plcSize);
+    return asynError;
+  }
+
+  //No timestamp available
+  paramInfo->hot->plcTimeStampRaw=0;
+  paramInfo->firstReadDone=true;
+  adsParamStatsUpdate(paramInfo->hot->stats,ADS_PATH_READ,bytesRead,(uint64_t)(adsClockHostNs()/1000));
+
+  asynStatus stat =asynSuccess;
+  if(updateAsynPar){
+    stat=adsUpdateParameterLock(paramInfo,(const void *)data,bytesRead);
+  }
+
+  return stat;
+}
+
+/** Read data from PLC. Data larger than the chunk size is read in several
+ * requests by absolute address, each taking adsMutex by itself so that other
+ * requests (bulk reads, writes) can be done in between. Note: the chunks of
+ * one transfer are not from the same PLC cycle.
+ *
+ * \param[in] paramInfo Parameter information (progress in chunksDone/chunksTotal).
+ * \param[in] group Group used if not chunked.
+ * \param[in] offset Offset used if not chunked.
+ * \param[out] data Data buffer.
+ * \param[in] dataSize Bytes to read.
+ * \param[out] bytesRead Bytes read.
+ * \param[out] error ADS error code.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsReadChunked(adsParamInfo *paramInfo,uint32_t group,uint32_t offset,void *data,uint32_t dataSize,uint32_t *bytesRead,long *error)
+{
+  const char* functionName = "adsReadChunked";
+
+  AmsAddr amsServer={remoteNetId_,paramInfo->amsPort};
+  ADSLANE lane=paramInfo->isChunkedPoll ? ADS_LANE_POLL : ADS_LANE_ONDEMAND_READ;
+  uint32_t chunkSize=chunkSize_;
+  *bytesRead=0;
+
+  if(chunkSize==0 || dataSize<=chunkSize || !paramInfo->plcAbsAdrValid){
+    adsLock(lane);
+    *error=AdsSyncReadReqEx2(adsPort_,&amsServer,group,offset,dataSize,data,bytesRead);
+    adsUnlock();
+    return *error ? asynError : asynSuccess;
+  }
+
+  uint32_t chunksTotal=(dataSize+chunkSize-1)/chunkSize;
+  uint32_t chunksDone=0;
+  adsSetChunkProgress(paramInfo,chunksDone,chunksTotal);
+  for(uint32_t done=0;done<dataSize;done+=chunkSize){
+    uint32_t size=dataSize-done<chunkSize ? dataSize-done : chunkSize;
+    uint32_t chunkBytesRead=0;
+    adsLock(lane);
+    *error=AdsSyncReadReqEx2(adsPort_,&amsServer,paramInfo->plcAbsAdrGroup,paramInfo->plcAbsAdrOffset+done,size,(char *)data+done,&chunkBytesRead);
+    adsUnlock();
+    if(*error){
+      return asynError;
+    }
+    *bytesRead+=chunkBytesRead;
+    adsSetChunkProgress(paramInfo,++chunksDone,chunksTotal);
+    asynPrint(pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: %s: chunk %u/%u (%u bytes).\n", driverName, functionName,paramInfo->drvInfo,chunksDone,chunksTotal,chunkBytesRead);
+  }
+  return asynSuccess;
+}
+
+/** Write data to PLC. Data larger than the chunk size is written in several
+ * requests by absolute address (see adsReadChunked()). Not atomic: the PLC
+ * can see a partly written array between the chunks.
+ *
+ * \param[in] paramInfo Parameter information (progress in chunksDone/chunksTotal).
+ * \param[in] group Group used if not chunked.
+ * \param[in] offset Offset used if not chunked.
+ * \param[in] data Data to write.
+ * \param[in] dataSize Bytes to write.
+ * \param[out] error ADS error code.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsWriteChunked(adsParamInfo *paramInfo,uint32_t group,uint32_t offset,const void *data,uint32_t dataSize,long *error)
+{
+  const char* functionName = "adsWriteChunked";
+
+  AmsAddr amsServer={remoteNetId_,paramInfo->amsPort};
+  uint32_t chunkSize=chunkSize_;
+
+  if(chunkSize==0 || dataSize<=chunkSize || !paramInfo->plcAbsAdrValid){
+    adsLock(ADS_LANE_CONTROL_WRITE);
+    *error=AdsSyncWriteReqEx(adsPort_,&amsServer,group,offset,dataSize,data);
+    adsUnlock();
+    return *error ? asynError : asynSuccess;
+  }
+
+  uint32_t chunksTotal=(dataSize+chunkSize-1)/chunkSize;
+  uint32_t chunksDone=0;
+  adsSetChunkProgress(paramInfo,chunksDone,chunksTotal);
+  for(uint32_t done=0;done<dataSize;done+=chunkSize){
+    uint32_t size=dataSize-done<chunkSize ? dataSize-done : chunkSize;
+    adsLock(ADS_LANE_CONTROL_WRITE);
+    *error=AdsSyncWriteReqEx(adsPort_,&amsServer,paramInfo->plcAbsAdrGroup,paramInfo->plcAbsAdrOffset+done,size,(const char *)data+done);
+    adsUnlock();
+    if(*error){
+      return asynError;
+    }
+    adsSetChunkProgress(paramInfo,++chunksDone,chunksTotal);
+    asynPrint(pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: %s: chunk %u/%u (%u bytes).\n", driverName, functionName,paramInfo->drvInfo,chunksDone,chunksTotal,size);
+  }
+  return asynSuccess;
+}
+
+/** Set progress of the last chunked transfer of a parameter (written by the
+ * bulk read thread and by writers, read by report()).
+ * \param[in] paramInfo Parameter information.
+ * \param[in] done Chunks done.
+ * \param[in] total Chunks of the transfer.
+ */
+void adsAsynPortDriver::adsSetChunkProgress(adsParamInfo *paramInfo,uint32_t done,uint32_t total)
+{
+  std::lock_guard<std::mutex> guard(chunkProgressMutex_);
+  paramInfo->chunksDone=done;
+  paramInfo->chunksTotal=total;
+}
+
+/** Get progress of the last chunked transfer of a parameter.
+ * \param[in] paramInfo Parameter information.
+ * \param[out] done Chunks done.
+ * \param[out] total Chunks of the transfer.
+ */
+void adsAsynPortDriver::adsGetChunkProgress(adsParamInfo *paramInfo,uint32_t *done,uint32_t *total)
+{
+  std::lock_guard<std::mutex> guard(chunkProgressMutex_);
+  *done=paramInfo->chunksDone;
+  *total=paramInfo->chunksTotal;
+}
+
+/** Write-behind write. Stores the value in the pending slot of the
+ * parameter (replacing an unsent value) and wakes the write-behind thread.
+ *
+ * \param[in] paramInfo Parameter information.
+ * \param[in] group Group.
+ * \param[in] offset Offset.
+ * \param[in] data Data to write (copied).
+ * \param[in] dataSize Bytes to write.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsWriteBehind(adsParamInfo *paramInfo,uint32_t group,uint32_t offset,const void *data,uint32_t dataSize)
+{
+  const char* functionName = "adsWriteBehind";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %s\n", driverName, functionName,paramInfo->drvInfo);
+
+  writeBehindMutex_.lock();
+  if(dataSize>paramInfo->writeBehindBufferSize){
+    uint8_t *buffer=(uint8_t *)realloc(paramInfo->writeBehindBuffer,dataSize);
+    if(!buffer){
+      writeBehindMutex_.unlock();
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to allocate memory for write-behind of %s.\n", driverName, functionName,paramInfo->drvInfo);
+      return asynError;
+    }
+    paramInfo->writeBehindBuffer=buffer;
+    paramInfo->writeBehindBufferSize=dataSize;
+  }
+  memcpy(paramInfo->writeBehindBuffer,data,dataSize);
+  paramInfo->writeBehindGroup=group;
+  paramInfo->writeBehindOffset=offset;
+  paramInfo->writeBehindSize=dataSize;
+  bool signal=!paramInfo->writeBehindPending;
+  if(signal){
+    paramInfo->writeBehindPending=true;
+    writeBehindPendingList_.push_back(paramInfo->paramIndex);
+  }
+  else{
+    paramInfo->writeBehindCollapsed++;
+    writeBehindCollapsed_++;
+  }
+  writeBehindMutex_.unlock();
+
+  if(signal){
+    epicsEventSignal(writeBehindEvent_);
+  }
+  return asynSuccess;
+}
+
+/** Queue a write (write coalescing). The write is sent by the write queue
+ * thread together with other queued writes (see writeQueueThread()).
+ *
+ * \param[in] paramInfo Parameter information.
+ * \param[in] group Group.
+ * \param[in] offset Offset.
+ * \param[in] data Data to write (copied).
+ * \param[in] dataSize Bytes to write.
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsQueueWrite(adsParamInfo *paramInfo,uint32_t group,uint32_t offset,const void *data,uint32_t dataSize)
+{
+  const char* functionName = "adsQueueWrite";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %s\n", driverName, functionName,paramInfo->drvInfo);
+
+  adsWriteQueueEntry entry;
+  entry.paramIndex=paramInfo->paramIndex;
+  entry.amsPort=paramInfo->amsPort;
+  entry.group=group;
+  entry.offset=offset;
+  entry.size=dataSize;
+  entry.data=(uint8_t *)malloc(dataSize>0 ? dataSize : 1);
+  if(!entry.data){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed to allocate memory for queued write of %s.\n", driverName, functionName,paramInfo->drvInfo);
+    return asynError;
+  }
+  memcpy(entry.data,data,dataSize);
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  writeQueueMutex_.lock();
+  bool signal=writeQueue_.empty();
+  if(signal){
+    writeQueueFirstUs_=(uint64_t)now.tv_sec*1000000+now.tv_usec;
+  }
+  writeQueue_.push_back(entry);
+  writeQueued_[entry.paramIndex]++;
+  if(writeQueue_.size()>=(size_t)writeCoalesceMaxEntries_){
+    writeFlushRequested_=true;
+    signal=true;
+  }
+  writeQueueMutex_.unlock();
+
+  if(signal){
+    epicsEventSignal(writeQueueEvent_);
+  }
+  return asynSuccess;
+}
+
+/** Send queued writes to one ams port as one ADSIGRP_SUMUP_WRITE request.
+ * Does not need the port lock (see adsSumWriteResults()).
+ *
+ * \param[in] entries Queued writes (same ams port).
+ * \param[in] count Number of entries.
+ * \param[out] errors ADS error of each entry (count elements).
+ * \return ADS error of the sum request (0 if sent).
+ */
+long adsAsynPortDriver::adsSumWriteSend(adsWriteQueueEntry *entries,uint32_t count,long *errors)
+{
+  const char* functionName = "adsSumWriteSend";
+  asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: %u writes\n", driverName, functionName,count);
+
+  // Request: count*(group,offset,size) followed by data. Response: count*result.
+  size_t requestSize=count*3*sizeof(uint32_t);
+  for(uint32_t i=0;i<count;i++){
+    requestSize+=entries[i].size;
+  }
+  std::vector<uint8_t> request(requestSize);
+  std::vector<uint32_t> results(count,0);
+  uint32_t *header=(uint32_t *)request.data();
+  uint8_t *payload=request.data()+count*3*sizeof(uint32_t);
+  for(uint32_t i=0;i<count;i++){
+    header[i*3]=entries[i].group;
+    header[i*3+1]=entries[i].offset;
+    header[i*3+2]=entries[i].size;
+    memcpy(payload,entries[i].data,entries[i].size);
+    payload+=entries[i].size;
+  }
+
+  AmsAddr amsServer={remoteNetId_,entries[0].amsPort};
   uint32_t bytesRead=0;
-  adsLock();
-  *error = AdsSyncReadReqEx2(adsPort_,
-                                     &amsServer,
-                                     group,
-                                     offset,
-                                     paramInfo->plcSize,
-                                     (void *)data,
+  adsLock(ADS_LANE_CONTROL_WRITE);
+  long status=AdsSyncReadWriteReqEx2(adsPort_,&amsServer,
+                                     ADSIGRP_SUMUP_WRITE,count,
+                                     count*sizeof(uint32_t),results.data(),
+                                     (uint32_t)requestSize,request.data(),
                                      &bytesRead);
   adsUnlock();
-  if(*error){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: AdsSyncReadReqEx2 failed: %s (%lu).\n", driverName, functionName,adsErrorToString(*error),*error);
-    return asynError;
+  if(!status && bytesRead!=count*sizeof(uint32_t)){
+    status=ADS_COM_ERROR_ADS_READ_BUFFER_INDEX_EXCEEDED_SIZE;  //results missing
   }
+  adsTrace(ADS_TRACE_SUM_WRITE,driverIndex_,entries[0].amsPort,count,(int32_t)status,0);
+  if(status){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: ADS sum write (%u writes) failed with: %s (0x%lx)\n", driverName, functionName,count,adsErrorToString(status),status);
+  }
+  for(uint32_t i=0;i<count;i++){
+    errors[i]=status ? status : (long)results[i];
+  }
+  return status;
+}
 
-  if(bytesRead!=paramInfo->plcSize){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Read bytes differ from parameter plc size (%u vs %u).\n", driverName, functionName,bytesRead,paramInfo->plcSize);
-    return asynError;
+/** Set the write alarm of each parameter of sent queued writes from its
+ * result. Call with port lock.
+ *
+ * \param[in] entries Queued writes.
+ * \param[in] count Number of entries.
+ * \param[in] errors ADS error of each entry (see adsSumWriteSend()).
+ */
+void adsAsynPortDriver::adsSumWriteResults(adsWriteQueueEntry *entries,uint32_t count,const long *errors)
+{
+  const char* functionName = "adsSumWriteResults";
+
+  writeQueueEntries_+=count;
+  for(uint32_t i=0;i<count;i++){
+    adsParamInfo *paramInfo=getAdsParamInfo(entries[i].paramIndex);
+    if(!paramInfo){
+      continue;
+    }
+    if(errors[i]){
+      writeQueueErrors_++;
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Queued ADS write of %s failed with: %s (0x%lx)\n", driverName, functionName,paramInfo->drvInfo,adsErrorToString(errors[i]),errors[i]);
+      setAlarmParam(paramInfo,WRITE_ALARM,INVALID_ALARM);
+    }
+    else if(paramInfo->hot->alarmStatus==WRITE_ALARM){
+      setAlarmParam(paramInfo,NO_ALARM,NO_ALARM);
+    }
   }
+}
 
-  //No timestamp available
-  paramInfo->plcTimeStampRaw=0;
-  paramInfo->firstReadDone=true;
+/** Send the queued writes of a parameter now (before a direct write of the
+ * same parameter, so that the direct write is not overtaken). Waits for a
+ * batch being sent by the write queue thread, but only if the parameter has
+ * writes queued or in that batch (writeQueued_). Call with port lock.
+ *
+ * \param[in] paramInfo Parameter information.
+ */
+void adsAsynPortDriver::adsFlushQueuedWrites(adsParamInfo *paramInfo)
+{
+  if(writeQueued_[paramInfo->paramIndex].load()==0){
+    return;
+  }
 
-  asynStatus stat =asynSuccess;
-  if(updateAsynPar){
-    stat=adsUpdateParameterLock(paramInfo,(const void *)data,bytesRead);
+  std::vector<adsWriteQueueEntry> pending;
+  std::vector<long> errors;
+
+  writeSendMutex_.lock();
+  writeQueueMutex_.lock();
+  std::vector<adsWriteQueueEntry>::iterator keep=writeQueue_.begin();
+  for(std::vector<adsWriteQueueEntry>::iterator it=writeQueue_.begin();it!=writeQueue_.end();++it){
+    if(it->paramIndex==paramInfo->paramIndex){
+      pending.push_back(*it);
+    }
+    else{
+      *keep++=*it;
+    }
   }
+  writeQueue_.erase(keep,writeQueue_.end());
+  writeQueueMutex_.unlock();
+  if(!pending.empty()){
+    errors.resize(pending.size());
+    adsSumWriteSend(pending.data(),(uint32_t)pending.size(),errors.data());
+    writeQueued_[paramInfo->paramIndex]-=(int)pending.size();
+  }
+  writeSendMutex_.unlock();
 
-  return stat;
+  if(pending.empty()){
+    return;
+  }
+  writeQueueBatches_++;
+  adsSumWriteResults(pending.data(),(uint32_t)pending.size(),errors.data());
+  for(adsWriteQueueEntry &entry : pending){
+    free(entry.data);
+  }
 }
 
 /** Read state of amsport in TwinCAT
@@ -3706,7 +6549,7 @@ asynStatus adsAsynPortDriver::adsReadState(uint16_t amsport,uint16_t *adsState,b
   AmsAddr amsServer={remoteNetId_,amsport};
 
   uint16_t devState;
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   const long status = AdsSyncReadStateReqEx(adsPort_, &amsServer, adsState, &devState);
   *error=status;
   adsUnlock();
@@ -3770,6 +6613,21 @@ adsParamInfo *adsAsynPortDriver::getAdsParamInfo(int index)
   }
 }
 
+/** Get hot parameter data for a certain index/reason (pasynUser->reason).
+ * Used in the update paths (notifications and bulk reads).
+ *
+ * \param[in] index index/reason (pasynUser->reason).
+ *
+ * \return Hot parameter data (see adsParamHot) or NULL.
+ */
+adsParamHot *adsAsynPortDriver::getAdsParamHot(int index)
+{
+  if(index>=0 && index<adsParamArrayCount_){
+    return &pAdsParamHot_[index];
+  }
+  return NULL;
+}
+
 /** Get current parameter count.
  *
  * \return Current parameter count.
@@ -3781,47 +6639,39 @@ int adsAsynPortDriver::getAdsParamCount()
 
 /** Update timestamp of parameter.
  *
- * \param[in] paramInfo Parameter information.
+ * \param[in] hot Parameter data (see adsParamHot).
  *
  * \return asynSuccess or asynError.
  *
- * Refreshes and sets timestamp depending on time source (PLC or EPICS).
+ * Refreshes the timestamp of the parameter depending on time source (PLC or
+ * EPICS). The port timestamp is not touched, it is set per parameter right
+ * before callbacks (fireCallbacks()).
  */
-asynStatus adsAsynPortDriver::refreshParamTime(adsParamInfo *paramInfo)
+asynStatus adsAsynPortDriver::refreshParamTime(adsParamHot *hot)
 {
   const char* functionName = "refreshParamTime";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s: plcTime %" PRIuMAX ".\n", driverName, functionName,
-            (uintmax_t)paramInfo->plcTimeStampRaw);
-
-  //Convert plc timeStamp (windows format) to epicsTimeStamp
-  if(windowsToEpicsTimeStamp(paramInfo->plcTimeStampRaw,&paramInfo->plcTimeStamp)){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: windowsToEpicsTimeStamp() failed.\n", driverName, functionName);
-    return asynError;
-  }
-
-  epicsTimeStamp ts;
+            (uintmax_t)hot->plcTimeStampRaw);
 
-  //Update time stamp
-  if(paramInfo->timeBase==ADS_TIME_BASE_EPICS || paramInfo->plcTimeStampRaw==0){
-    if(updateTimeStamp()!=asynSuccess){
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: updateTimeStamp() failed.\n", driverName, functionName);
+  //Convert plc timeStamp (windows format) to epicsTimeStamp (if not already done for a burst)
+  if(hot->plcTimeStampRaw && hot->plcTimeStampRaw!=hot->plcTimeStampConverted){
+    if(windowsToEpicsTimeStamp(hot->plcTimeStampRaw,&hot->plcTimeStamp)){
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: windowsToEpicsTimeStamp() failed.\n", driverName, functionName);
       return asynError;
     }
+    hot->plcTimeStampConverted=hot->plcTimeStampRaw;
   }
-  else{ //ADS_TIME_BASE_PLC
-    if(setTimeStamp(&paramInfo->plcTimeStamp)!=asynSuccess){
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: updateTimeStamp() failed.\n", driverName, functionName);
+
+  if(hot->timeBase==ADS_TIME_BASE_EPICS || hot->plcTimeStampRaw==0){
+    if(epicsTimeGetCurrent(&hot->epicsTimestamp)!=epicsTimeOK){
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: epicsTimeGetCurrent() failed.\n", driverName, functionName);
       return asynError;
     }
   }
-
-  if(getTimeStamp(&ts)!=asynSuccess){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: getTimeStamp() failed.\n", driverName, functionName);
-    return asynError;
+  else{ //ADS_TIME_BASE_PLC
+    hot->epicsTimestamp=hot->plcTimeStamp;
   }
 
-  paramInfo->epicsTimestamp=ts;
-
   return asynSuccess;
 }
 
@@ -3836,10 +6686,7 @@ asynStatus adsAsynPortDriver::refreshParamTime(adsParamInfo *paramInfo)
  */
 asynStatus adsAsynPortDriver::adsUpdateParameterLock(adsParamInfo* paramInfo,const void *data)
 {
-  lock();
-  asynStatus stat=adsUpdateParameter(paramInfo,data);
-  unlock();
-  return stat;
+  return adsUpdateParameterLock(paramInfo->hot,data,paramInfo->hot->lastCallbackSize);
 }
 
 /** Update asyn parameter or callback (for arrays).
@@ -3854,12 +6701,204 @@ asynStatus adsAsynPortDriver::adsUpdateParameterLock(adsParamInfo* paramInfo,con
  */
 asynStatus adsAsynPortDriver::adsUpdateParameterLock(adsParamInfo* paramInfo,const void *data,size_t dataSize)
 {
+  return adsUpdateParameterLock(paramInfo->hot,data,dataSize);
+}
+
+/** Update asyn parameter or callback (for arrays) and the parameters that
+ * share its subscription (see adsShareSubscription()).
+ *
+ * \param[in] hot Parameter data (see adsParamHot).
+ * \param[in] data Data to write to parameter (or callback to EPICS).
+ * \param[in] dataSize Size of data to write.
+ *
+ * \return asynSuccess or asynError.
+ *
+ * Thread safe. Array data is copied to the array store before the port
+ * lock is taken.
+ */
+asynStatus adsAsynPortDriver::adsUpdateParameterLock(adsParamHot* hot,const void *data,size_t dataSize)
+{
+  const void *plcData=data;
+  if(hot && data && hot->plcDataIsArray){
+    arrayPublishers_++;  //Before reading the store (see adsFreeRetiredArrayStores())
+    asynStatus stat=asynSuccess;
+    if(hot->arrayStore && hot->updateKernel){
+      stat=adsPublishArray(hot->info,data,dataSize);
+      data=NULL;  //Already published
+    }
+    arrayPublishers_--;
+    if(stat!=asynSuccess){
+      return asynError;
+    }
+  }
+
   lock();
-  asynStatus stat=adsUpdateParameter(paramInfo,data,dataSize);
+  if(!retiredArrayStores_.empty()){
+    adsFreeRetiredArrayStores();
+  }
+  asynStatus stat=adsUpdateParameter(hot,data,dataSize);
+  if(hot && hot->nextShared && plcData){
+    adsUpdateFollowers(hot,plcData,dataSize,hot->info->bCallbackNotifyValid ? ADS_PATH_NOTIFICATION : ADS_PATH_READ,adsClockHostNs());
+  }
   unlock();
   return stat;
 }
 
+/** Update the parameters that share the subscription of a parameter
+ * (see adsShareSubscription()). Each follower gets the PLC time of the
+ * subscription and applies its own time base and conversion.
+ *
+ * The subscription runs at the fastest rate of the chain, so each follower
+ * is throttled to its own sample time. Data arriving earlier is kept (last
+ * value wins) and delivered by the first update after the sample time, or
+ * by adsFlushFollowers() if the subscription does not update again.
+ *
+ * \param[in] hot Parameter data of the parameter holding the subscription.
+ * \param[in] data PLC data.
+ * \param[in] dataSize Size of PLC data.
+ * \param[in] path Path the data came on (statistics).
+ * \param[in] hostNs IOC time of the data (adsClockHostNs()).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsUpdateFollowers(adsParamHot* hot,const void *data,size_t dataSize,ADSPATH path,int64_t hostNs)
+{
+  asynStatus stat=asynSuccess;
+  for(adsParamHot *follower=hot->nextShared;follower;follower=follower->nextShared){
+    adsParamInfo *paramInfo=follower->info;
+    follower->plcTimeStampRaw=hot->plcTimeStampRaw;
+    follower->plcTimeStampConverted=hot->plcTimeStampConverted;
+    follower->plcTimeStamp=hot->plcTimeStamp;
+    if(hostNs>=paramInfo->sharedNextNs){
+      if(adsUpdateFollower(follower,data,dataSize,path,hostNs)!=asynSuccess){
+        stat=asynError;
+      }
+      continue;
+    }
+    // Too early for this follower: keep the data for later
+    if(paramInfo->sharedPendingCapacity<dataSize){
+      uint8_t *buffer=(uint8_t*)realloc(paramInfo->sharedPending,dataSize);
+      if(!buffer){
+        stat=asynError;
+        continue;
+      }
+      paramInfo->sharedPending=buffer;
+      paramInfo->sharedPendingCapacity=dataSize;
+    }
+    if(!paramInfo->sharedPendingSize){
+      sharedPendingCount_++;
+    }
+    memcpy(paramInfo->sharedPending,data,dataSize);
+    paramInfo->sharedPendingSize=dataSize;
+    paramInfo->sharedPendingPath=path;
+    paramInfo->sharedPendingTimeRaw=hot->plcTimeStampRaw;
+    paramInfo->sharedPendingTimeConverted=hot->plcTimeStampConverted;
+    paramInfo->sharedPendingTime=hot->plcTimeStamp;
+  }
+  return stat;
+}
+
+/** Deliver data to a parameter that shares a subscription (see
+ * adsUpdateFollowers()) and start its next sample time. Call with port lock.
+ *
+ * \param[in] follower Parameter data (PLC time already set).
+ * \param[in] data PLC data.
+ * \param[in] dataSize Size of PLC data.
+ * \param[in] path Path the data came on (statistics).
+ * \param[in] hostNs IOC time of the data (adsClockHostNs()).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsUpdateFollower(adsParamHot* follower,const void *data,size_t dataSize,ADSPATH path,int64_t hostNs)
+{
+  adsParamInfo *paramInfo=follower->info;
+  if(paramInfo->sharedPendingSize){
+    paramInfo->sharedPendingSize=0;  //Newer data replaces it
+    sharedPendingCount_--;
+  }
+  paramInfo->sharedNextNs=hostNs+(int64_t)(paramInfo->sampleTimeMS*1E6);
+  follower->lastCallbackSize=dataSize;
+  adsParamStatsUpdate(follower->stats,path,dataSize,(uint64_t)(hostNs/1000));
+  return adsUpdateParameter(follower,data,dataSize);
+}
+
+/** Deliver the data held back for followers of shared subscriptions whose
+ * sample time has passed (see adsUpdateFollowers()). Call with port lock.
+ */
+void adsAsynPortDriver::adsFlushFollowers()
+{
+  if(!sharedPendingCount_){
+    return;
+  }
+  int64_t hostNs=adsClockHostNs();
+  for(int i=0;i<adsParamArrayCount_;i++){
+    adsParamInfo *paramInfo=pAdsParamArray_[i];
+    if(!paramInfo || !paramInfo->sharedPendingSize || hostNs<paramInfo->sharedNextNs){
+      continue;
+    }
+    adsParamHot *follower=paramInfo->hot;
+    follower->plcTimeStampRaw=paramInfo->sharedPendingTimeRaw;
+    follower->plcTimeStampConverted=paramInfo->sharedPendingTimeConverted;
+    follower->plcTimeStamp=paramInfo->sharedPendingTime;
+    size_t dataSize=paramInfo->sharedPendingSize;
+    adsUpdateFollower(follower,paramInfo->sharedPending,dataSize,paramInfo->sharedPendingPath,hostNs);
+  }
+}
+
+/** Free array stores replaced in updateParamInfoWithPLCInfo() once no thread
+ * publishes without port lock (a publisher counts itself in arrayPublishers_
+ * before it reads hot->arrayStore, so later publishers see the new store).
+ * Call with port lock.
+ */
+void adsAsynPortDriver::adsFreeRetiredArrayStores()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);  //Store swap before the count
+  if(retiredArrayStores_.empty() || arrayPublishers_.load()!=0){
+    return;
+  }
+  for(adsArrayStore *store : retiredArrayStores_){
+    adsArrayStoreDestroy(store);
+  }
+  retiredArrayStores_.clear();
+}
+
+/** Copy (and convert) PLC array data to the back buffer of the array store
+ * and publish it. Does not need the port lock.
+ *
+ * \param[in] paramInfo Parameter information.
+ * \param[in] data PLC data.
+ * \param[in] dataSize Size of PLC data.
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::adsPublishArray(adsParamInfo* paramInfo,const void *data,size_t dataSize)
+{
+  adsArrayStore *store=paramInfo->hot->arrayStore;
+  if(!store){
+    return asynError;
+  }
+
+  void *buffer=adsArrayStoreWriteLock(store);
+  size_t bytesUsed=dataSize;
+  if(paramInfo->arrayReadKernel){
+    size_t epicsElementSize=adsTypeSize(paramInfo->arrayEpicsType);
+    size_t nElements=dataSize/paramInfo->plcElementSize;
+    if(store->size/epicsElementSize<nElements){
+      nElements=store->size/epicsElementSize;
+    }
+    paramInfo->arrayReadKernel(data,buffer,nElements);
+    bytesUsed=nElements*epicsElementSize;
+  }
+  else{
+    if(store->size<bytesUsed){
+      bytesUsed=store->size;
+    }
+    memcpy(buffer,data,bytesUsed);
+  }
+  adsArrayStoreWriteUnlock(store,bytesUsed);
+  return asynSuccess;
+}
+
 /** Update asyn parameter or callback (for arrays).
  *
  * \param[in] paramInfo Parameter information.
@@ -3870,349 +6909,107 @@ asynStatus adsAsynPortDriver::adsUpdateParameterLock(adsParamInfo* paramInfo,con
  */
 asynStatus adsAsynPortDriver::adsUpdateParameter(adsParamInfo* paramInfo,const void *data)
 {
-  return adsUpdateParameter(paramInfo,data,paramInfo->lastCallbackSize);
+  return adsUpdateParameter(paramInfo->hot,data,paramInfo->hot->lastCallbackSize);
 }
 
 /** Update asyn parameter or callback (for arrays).
  *
- * \param[in] paramInfo Parameter information.
- * \param[in] data Data to write to parameter (or callback to EPICS).
+ * \param[in] hot Parameter data (see adsParamHot).
+ * \param[in] data Data to write to parameter (or callback to EPICS). NULL
+ *                 for arrays already published with adsPublishArray().
  * \param[in] dataSize Size of data to write.
  *
  * \return asynSuccess or asynError.
  *
  */
-asynStatus adsAsynPortDriver::adsUpdateParameter(adsParamInfo* paramInfo,const void *data,size_t dataSize)
+asynStatus adsAsynPortDriver::adsUpdateParameter(adsParamHot* hot,const void *data,size_t dataSize)
 {
   const char* functionName = "adsUpdateParameter";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
-  if(!paramInfo){
+  if(!hot){
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: paramInfo NULL.\n", driverName, functionName);
     return asynError;
   }
 
-  if(!data){
+  if(!data && !hot->arrayStore){
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: data NULL.\n", driverName, functionName);
     return asynError;
   }
 
-  if(refreshParamTime(paramInfo)!=asynSuccess){
+  if(refreshParamTime(hot)!=asynSuccess){
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: refreshParamTime() failed.\n", driverName, functionName);
     return asynError;
   }
 
   asynStatus ret=asynError;
 
-  //Ensure check if array
-  if(paramInfo->plcDataIsArray){
-    if(!paramInfo->arrayDataBuffer){
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Array but buffer is NULL.\n", driverName, functionName);
-      return asynError;
-    }
-    //Copy data to param buffer
-    memcpy(paramInfo->arrayDataBuffer,data,paramInfo->lastCallbackSize);
-  }
-
-  switch(paramInfo->plcDataType){
-    case ADST_INT8:
-      int8_t *ADST_INT8Var;
-      ADST_INT8Var=((int8_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_INT8Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_INT8Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_INT8Var));
-          break;
-        case asynParamInt8Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-
-    case ADST_INT16:
-      int16_t *ADST_INT16Var;
-      ADST_INT16Var=((int16_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_INT16Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(int)(*ADST_INT16Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_INT16Var));
-          break;
-        case asynParamInt16Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_INT32:
-      int32_t *ADST_INT32Var;
-      ADST_INT32Var=((int32_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_INT32Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(int)(*ADST_INT32Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_INT32Var));
-          break;
-        case asynParamInt32Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_INT64:
-      int64_t *ADST_INT64Var;
-      ADST_INT64Var=((int64_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_INT64Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_INT64Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_INT64Var));
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_UINT8:
-      uint8_t *ADST_UINT8Var;
-      ADST_UINT8Var=((uint8_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_UINT8Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_UINT8Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_UINT8Var));
-          break;
-        // Arrays of unsigned not supported
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_UINT16:
-      uint16_t *ADST_UINT16Var;
-      ADST_UINT16Var=((uint16_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_UINT16Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_UINT16Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_UINT16Var));
-          break;
-        // Arrays of unsigned not supported
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_UINT32:
-      uint32_t *ADST_UINT32Var;
-      ADST_UINT32Var=((uint32_t*)data);
-      //Asyn types
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_UINT32Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_UINT32Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_UINT32Var));
-          break;
-        // Arrays of unsigned not supported
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_UINT64:
-      uint64_t *ADST_UINT64Var;
-      ADST_UINT64Var=((uint64_t*)data);
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_UINT64Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_UINT64Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_UINT64Var));
-          break;
-        // Arrays of unsigned not supported
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_REAL32:
-      float *ADST_REAL32Var;
-      ADST_REAL32Var=((float*)data);
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_REAL32Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_REAL32Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_REAL32Var));
-          break;
-        case asynParamFloat32Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_REAL64:
-      double *ADST_REAL64Var;
-      ADST_REAL64Var=((double*)data);
-      switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_REAL64Var));
-          break;
-#ifndef NO_ADS_ASYN_ASYNPARAMINT64
-        case asynParamInt64:
-          ret=setInteger64Param(paramInfo->paramIndex,(epicsInt64)(*ADST_REAL64Var));
-          break;
-#endif
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_REAL64Var));
-          break;
-        case asynParamFloat64Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
+  if(!hot->updateKernel){
+    // Type combination not supported (reported once in selectConversionKernels())
+    return asynError;
+  }
 
-    case ADST_BIT:
-      int8_t *ADST_BitVar;
-      ADST_BitVar=((int8_t*)data);
-       switch(paramInfo->asynType){
-        case asynParamInt32:
-          ret=setIntegerParam(paramInfo->paramIndex,(int)(*ADST_BitVar));
-          break;
-        case asynParamFloat64:
-          ret=setDoubleParam(paramInfo->paramIndex,(double)(*ADST_BitVar));
-          break;
-        case asynParamInt8Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-     case ADST_STRING:
-      switch(paramInfo->asynType){
-        case asynParamInt8Array:
-          // handled in fireCallbacks()
-          ret=asynSuccess;
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-        }
-      break;
-    default:
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-      return asynError;
-      break;
+  //Arrays: publish to array store (if not already done without port lock)
+  if(hot->arrayStore && data){
+    ret=adsPublishArray(hot->info,data,dataSize);
+    if(ret!=asynSuccess){
+      return ret;
+    }
   }
 
+  ret=hot->updateKernel(this,hot,data);
+
   if(ret!=asynSuccess){
     return ret;
   }
 
-  ret=setAlarmParam(paramInfo,NO_ALARM, NO_ALARM);
+  ret=setAlarmParam(hot,NO_ALARM, NO_ALARM);
   if(ret!=asynSuccess){
     return ret;
   }
 
   if(allowCallbackEpicsState){
-    return fireCallbacks(paramInfo);
+    return fireCallbacks(hot);
   }
 
    return asynSuccess;
 }
 
+/** Publish the write-behind totals (sent, collapsed, failed) to the
+ * parameters of the .WRITEBEHINDSENT., .WRITEBEHINDCOLLAPSED. and
+ * .WRITEBEHINDFAILED. commands. Call with port lock.
+ */
+void adsAsynPortDriver::adsPublishWriteBehindStats()
+{
+  if(writeBehindStatsParams_.empty()){
+    return;
+  }
+  writeBehindMutex_.lock();
+  unsigned long collapsed=writeBehindCollapsed_;
+  writeBehindMutex_.unlock();
+
+  for(adsParamInfo *paramInfo : writeBehindStatsParams_){
+    uint32_t value=0;
+    switch(paramInfo->dataSource){
+      case ADS_DATASOURCE_WRITE_BEHIND_SENT:
+        value=(uint32_t)writeBehindSent_;
+        break;
+      case ADS_DATASOURCE_WRITE_BEHIND_COLLAPSED:
+        value=(uint32_t)collapsed;
+        break;
+      default:
+        value=(uint32_t)writeBehindFailed_;
+        break;
+    }
+    paramInfo->hot->lastCallbackSize=sizeof(value);
+    adsUpdateParameter(paramInfo->hot,&value,sizeof(value));
+  }
+}
+
 /** Call callbacks for all parameters.
+ *
+ * One callback per parameter so each record gets the time stamp of its own
+ * data (runs once, at scan init).
  *
  * \return asynSuccess or asynError.
  */
@@ -4223,9 +7020,7 @@ asynStatus adsAsynPortDriver::fireAllCallbacksLock()
 
   lock();
   for(int i=0;i<adsParamArrayCount_;i++){
-    if(pAdsParamArray_[i]){
-      fireCallbacks(pAdsParamArray_[i]);
-    }
+    fireCallbacks(&pAdsParamHot_[i]);
   }
   unlock();
   return asynSuccess;
@@ -4238,110 +7033,36 @@ asynStatus adsAsynPortDriver::fireAllCallbacksLock()
  * \return asynSuccess or asynError.
  */
 asynStatus adsAsynPortDriver::fireCallbacks(adsParamInfo* paramInfo)
+{
+  return fireCallbacks(paramInfo->hot);
+}
+
+/** Call callbacks for a parameter.
+ *
+ * \param[in] hot Parameter data (see adsParamHot).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::fireCallbacks(adsParamHot* hot)
 {
   const char* functionName = "fireCallbacks";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
-  if(!paramInfo->plcDataIsArray){
-    return callParamCallbacks();
+  if(hot->stats){
+    hot->stats->callbacks.fetch_add(1,std::memory_order_relaxed);
   }
-
-  if(paramInfo->lastCallbackSize<=0){
-    return asynSuccess;
+  if(traceCallbacks){
+    adsTrace(ADS_TRACE_CALLBACK,driverIndex_,hot->paramIndex,(uint32_t)hot->lastCallbackSize,0,hot->plcTimeStampRaw);
   }
 
-  asynStatus ret=asynError;
-
-  //Array
-  switch(paramInfo->plcDataType){
-    case ADST_INT8:
-      switch(paramInfo->asynType){
-        case asynParamInt8Array:
-          ret=doCallbacksInt8Array((epicsInt8 *)paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-
-    case ADST_INT16:
-      switch(paramInfo->asynType){
-        case asynParamInt16Array:
-          ret=doCallbacksInt16Array((epicsInt16 *)paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_INT32:
-      switch(paramInfo->asynType){
-        case asynParamInt32Array:
-          ret=doCallbacksInt32Array((epicsInt32 *)paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-
-    case ADST_REAL32:
-      switch(paramInfo->asynType){
-        case asynParamFloat32Array:
-          ret=doCallbacksFloat32Array((epicsFloat32 *)paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-
-    case ADST_REAL64:
-      switch(paramInfo->asynType){
-        case asynParamFloat64Array:
-          ret=doCallbacksFloat64Array((epicsFloat64 *)paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-
-    case ADST_BIT:
-      switch(paramInfo->asynType){
-        case asynParamInt8Array:
-          ret=doCallbacksInt8Array((epicsInt8 *) paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-      }
-      break;
-    case ADST_STRING:
-      switch(paramInfo->asynType){
-        case asynParamInt8Array:
-          ret=doCallbacksInt8Array((epicsInt8 *) paramInfo->arrayDataBuffer,paramInfo->lastCallbackSize, paramInfo->paramIndex,paramInfo->asynAddr);
-          break;
-        default:
-          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-          return asynError;
-          break;
-        }
-      break;
-
-    default:
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Type combination not supported. PLC type = %s, ASYN type= %s\n", driverName, functionName,adsTypeToString(paramInfo->plcDataType),asynTypeToString(paramInfo->asynType));
-      return asynError;
-      break;
+  // Callbacks use the port timestamp: set it to the time of this parameter (port locked)
+  setTimeStamp(&hot->epicsTimestamp);
+  if(!hot->callbackKernel){
+    // Not resolved yet or type combination not supported
+    return hot->plcDataIsArray ? asynError : callParamCallbacks();
   }
-  return ret;
+
+  return hot->callbackKernel(this,hot,hot->lastCallbackSize);
 }
 
 /** Set parameter alarm state.
@@ -4353,89 +7074,116 @@ asynStatus adsAsynPortDriver::fireCallbacks(adsParamInfo* paramInfo)
  * \return asynSuccess or asynError.
  */
 asynStatus adsAsynPortDriver::setAlarmParam(adsParamInfo *paramInfo,int alarm,int severity)
+{
+  if(!paramInfo){
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:setAlarmParam: paramInfo==NULL.\n", driverName);
+    return asynError;
+  }
+  return setAlarmParam(paramInfo->hot,alarm,severity);
+}
+
+/** Set parameter alarm state.
+ *
+ * \param[in] hot Parameter data (see adsParamHot).
+ * \param[in] alarm Alarm type (EPICS def).
+ * \param[in] severity Alarm severity (EPICS def).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setAlarmParam(adsParamHot *hot,int alarm,int severity)
 {
   const char* functionName = "setAlarmParam";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
-  if(!paramInfo){
+  if(!hot){
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: paramInfo==NULL.\n", driverName, functionName);
     return asynError;
   }
 
+  bool doCallbacks=false;
+  asynStatus stat=setAlarmParamState(hot,alarm,severity,&doCallbacks);
+  if(stat!=asynSuccess){
+    return stat;
+  }
+
+  if(!doCallbacks || !allowCallbackEpicsState){
+    return asynSuccess;
+  }
+  //Alarm status or severity changed=>Do callbacks with old buffered data (if nElemnts==0 then no data in record...)
+  //Alarms are stamped with the current time, alarm clear with the time of the data
+  if(alarm!=NO_ALARM){
+    updateTimeStamp();
+  }
+  else{
+    setTimeStamp(&hot->epicsTimestamp);
+  }
+  if(hot->plcDataIsArray && hot->arrayStore && hot->callbackKernel){
+    stat=hot->callbackKernel(this,hot,hot->arrayStore->size);
+  }
+  else{
+      stat=callParamCallbacks();
+  }
+
+  return stat;
+}
+
+/** Set parameter alarm status and severity without callbacks.
+ *
+ * \param[in] hot Parameter data (see adsParamHot).
+ * \param[in] alarm Alarm type (EPICS def).
+ * \param[in] severity Alarm severity (EPICS def).
+ * \param[out] changed Set to true if status or severity changed (callbacks needed).
+ *
+ * \return asynSuccess or asynError.
+ */
+asynStatus adsAsynPortDriver::setAlarmParamState(adsParamHot *hot,int alarm,int severity,bool *changed)
+{
+  const char* functionName = "setAlarmParamState";
+
+  if(alarm!=hot->alarmStatus){
+    adsTrace(ADS_TRACE_ALARM,driverIndex_,hot->paramIndex,0,alarm,0);
+  }
+
   asynStatus stat;
   int oldAlarmStatus=0;
-  stat=getParamAlarmStatus(paramInfo->paramIndex,&oldAlarmStatus);
+  stat=getParamAlarmStatus(hot->paramIndex,&oldAlarmStatus);
   if(stat!=asynSuccess){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: getParamAlarmStatus failed for parameter %s (%d).\n", driverName, functionName,paramInfo->drvInfo,paramInfo->paramIndex);
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: getParamAlarmStatus failed for parameter %s (%d).\n", driverName, functionName,hot->info->drvInfo,hot->paramIndex);
     return asynError;
   }
 
-  bool doCallbacks=false;
-
   if(oldAlarmStatus!=alarm){
-    stat=setParamAlarmStatus(paramInfo->paramIndex,alarm);
+    stat=setParamAlarmStatus(hot->paramIndex,alarm);
     if(stat!=asynSuccess){
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed set alarm status for parameter %s (%d).\n", driverName, functionName,paramInfo->drvInfo,paramInfo->paramIndex);
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed set alarm status for parameter %s (%d).\n", driverName, functionName,hot->info->drvInfo,hot->paramIndex);
       return asynError;
     }
-    paramInfo->alarmStatus=alarm;
-    doCallbacks=true;
+    hot->alarmStatus=alarm;
+    *changed=true;
+    //Count errors on alarm changes only (setAlarmPort() calls this for every parameter)
+    if(alarm!=NO_ALARM && hot->stats){
+      hot->stats->errors.fetch_add(1,std::memory_order_relaxed);
+    }
   }
 
   int oldAlarmSeverity=0;
-  stat=getParamAlarmSeverity(paramInfo->paramIndex,&oldAlarmSeverity);
+  stat=getParamAlarmSeverity(hot->paramIndex,&oldAlarmSeverity);
   if(stat!=asynSuccess){
-    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: getParamAlarmStatus failed for parameter %s (%d).\n", driverName, functionName,paramInfo->drvInfo,paramInfo->paramIndex);
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: getParamAlarmStatus failed for parameter %s (%d).\n", driverName, functionName,hot->info->drvInfo,hot->paramIndex);
     return asynError;
   }
 
   if(oldAlarmSeverity!=severity){
-    stat=setParamAlarmSeverity(paramInfo->paramIndex,severity);
+    stat=setParamAlarmSeverity(hot->paramIndex,severity);
     if(stat!=asynSuccess){
-      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed set alarm severity for parameter %s (%d).\n", driverName, functionName,paramInfo->drvInfo,paramInfo->paramIndex);
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Failed set alarm severity for parameter %s (%d).\n", driverName, functionName,hot->info->drvInfo,hot->paramIndex);
       return asynError;
     }
-    paramInfo->alarmSeverity=severity;
-    doCallbacks=true;
-  }
-
-  if(!doCallbacks || !allowCallbackEpicsState){
-    return asynSuccess;
-  }
-  //Write size used for arrays
-  size_t writeSize=paramInfo->arrayDataBufferSize;
-  if(paramInfo->plcSize<writeSize){
-    writeSize=paramInfo->plcSize;
-  }
-
-  //Alarm status or severity changed=>Do callbacks with old buffered data (if nElemnts==0 then no data in record...)
-  if(paramInfo->plcDataIsArray && paramInfo->arrayDataBuffer and paramInfo->arrayDataBufferSize>0 && allowCallbackEpicsState){
-    switch(paramInfo->asynType){
-      case asynParamInt8Array:
-        stat=doCallbacksInt8Array((epicsInt8 *)paramInfo->arrayDataBuffer,writeSize/sizeof(epicsInt8), paramInfo->paramIndex,paramInfo->asynAddr);
-        break;
-      case asynParamInt16Array:
-        stat=doCallbacksInt16Array((epicsInt16 *)paramInfo->arrayDataBuffer,writeSize/sizeof(epicsInt16), paramInfo->paramIndex,paramInfo->asynAddr);
-        break;
-      case asynParamInt32Array:
-        stat=doCallbacksInt32Array((epicsInt32 *)paramInfo->arrayDataBuffer,writeSize/sizeof(epicsInt32), paramInfo->paramIndex,paramInfo->asynAddr);
-        break;
-      case asynParamFloat32Array:
-        stat=doCallbacksFloat32Array((epicsFloat32 *)paramInfo->arrayDataBuffer,writeSize/sizeof(epicsFloat32), paramInfo->paramIndex,paramInfo->asynAddr);
-        break;
-      case asynParamFloat64Array:
-        stat=doCallbacksFloat64Array((epicsFloat64 *)paramInfo->arrayDataBuffer,writeSize/sizeof(epicsFloat64), paramInfo->paramIndex,paramInfo->asynAddr);
-        break;
-      default:
-        stat=callParamCallbacks();
-        break;
-    }
-  }
-  else{
-      stat=callParamCallbacks();
+    hot->alarmSeverity=severity;
+    *changed=true;
   }
 
-  return stat;
+  return asynSuccess;
 }
 
 /** Set parameter alarm state.
@@ -4458,6 +7206,11 @@ asynStatus adsAsynPortDriver::setAlarmPortLock(uint16_t amsPort,int alarm,int se
 }
 
 /** Set alarm for all parameter on a ams-port.
+ *
+ * Status and severity of all parameters are set first, then the changed
+ * scalars get one callParamCallbacks() pass (instead of one per parameter)
+ * and the changed arrays one callback each. All are stamped with the
+ * current time.
  *
  * \param[in] amsPort Ams-port.
  * \param[in] alarm Alarm type (EPICS def).
@@ -4470,31 +7223,70 @@ asynStatus adsAsynPortDriver::setAlarmPort(uint16_t amsPort,int alarm,int severi
   const char* functionName = "setAlarmPort";
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
+  struct timeval start, now;
+  gettimeofday(&start, NULL);
+
+  asynStatus stat=asynSuccess;
+  bool scalarsChanged=false;
+  std::vector<adsParamHot*> arraysChanged;
   for(int i=0;i<adsParamArrayCount_;i++){
-    if(!pAdsParamArray_[i]){
+    if(!pAdsParamArray_[i] || pAdsParamArray_[i]->amsPort!=amsPort ||
+       pAdsParamArray_[i]->dataSource>=ADS_DATASOURCE_WRITE_BEHIND_SENT){  //Driver counters stay valid
       continue;
     }
-    if(pAdsParamArray_[i]->amsPort==amsPort){
-      if(setAlarmParam(pAdsParamArray_[i],alarm,severity)!=asynSuccess){
-        return asynError;
+    adsParamHot *hot=&pAdsParamHot_[i];
+    bool changed=false;
+    if(setAlarmParamState(hot,alarm,severity,&changed)!=asynSuccess){
+      stat=asynError;
+      continue;
+    }
+    if(!changed){
+      continue;
+    }
+    if(hot->plcDataIsArray && hot->arrayStore && hot->callbackKernel){
+      arraysChanged.push_back(hot);
+    }
+    else{
+      scalarsChanged=true;
+    }
+  }
+
+  if(allowCallbackEpicsState && (scalarsChanged || !arraysChanged.empty())){
+    updateTimeStamp();
+    if(scalarsChanged && callParamCallbacks()!=asynSuccess){
+      stat=asynError;
+    }
+    for(adsParamHot *hot : arraysChanged){
+      if(hot->callbackKernel(this,hot,hot->arrayStore->size)!=asynSuccess){
+        stat=asynError;
       }
     }
   }
-  return asynSuccess;
+
+  gettimeofday(&now, NULL);
+  amsPortInfo *port=getAmsPortObject(amsPort);
+  if(port){
+    port->lastAlarmUs=(uint64_t)(now.tv_sec-start.tv_sec)*1000000+now.tv_usec-start.tv_usec;
+  }
+  asynPrint(pasynUserSelf, ASYN_TRACE_INFO, "%s:%s: Alarm %d set for ams-port %u in %.3lf ms (%zu arrays).\n",
+            driverName, functionName, alarm, amsPort,
+            ((now.tv_sec-start.tv_sec)*1E6+(now.tv_usec-start.tv_usec))/1E3, arraysChanged.size());
+  return stat;
 }
 
 /** Take adsLib lock.
+ * \param[in] lane Priority lane of the request (see ADSLANE).
  */
-void adsAsynPortDriver::adsLock()
+void adsAsynPortDriver::adsLock(ADSLANE lane)
 {
-  adsMutex.lock();
+  adsPriorityLockAcquire(&adsMutex,lane);
 }
 
 /** Release adsLib lock.
  */
 void adsAsynPortDriver::adsUnlock()
 {
-  adsMutex.unlock();
+  adsPriorityLockRelease(&adsMutex);
 }
 
 /** Delete ads route
@@ -4524,7 +7316,7 @@ asynStatus adsAsynPortDriver::adsDelRoute(int force)
  */
 asynStatus adsAsynPortDriver::adsDelRouteLock(int force)
 {
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   asynStatus stat=adsDelRoute(force);
   adsUnlock();
   return stat;
@@ -4542,7 +7334,7 @@ asynStatus adsAsynPortDriver::adsAddRouteLock()
   asynPrint(pasynUserSelf,ASYN_TRACE_FLOW, "%s:%s:\n", driverName, functionName);
 
   // add local route to your ADS Master
-  adsLock();
+  adsLock(ADS_LANE_SUBSCRIPTION);
   const long addRouteStatus = AdsAddRoute(remoteNetId_, ipaddr_);
   adsUnlock();
   if(addRouteStatus){
@@ -4664,6 +7456,11 @@ extern "C" {
       defaultTimeSource=ADS_TIME_BASE_PLC;
     }
 
+    if(adsAsynPortObjCount>=ADS_MAX_DRIVERS){
+      printf("adsAsynPortDriverConfigure: ERROR: Max %d drivers.\n",ADS_MAX_DRIVERS);
+      return asynError;
+    }
+
     adsAsynPortObj=new adsAsynPortDriver(portName,
                                          ipaddr,
                                          amsaddr,
@@ -4749,6 +7546,191 @@ extern "C" {
     adsAsynPortObj->poll_info(args[0].sval);
   }
 
+  /*
+   * adsSetOctetBufferSize(size)
+   */
+  static const iocshArg adsSetOctetBufferSizeArg0 = {"size (bytes)", iocshArgInt};
+  static const iocshArg *adsSetOctetBufferSizeArgs[] = {&adsSetOctetBufferSizeArg0};
+  static const iocshFuncDef adsSetOctetBufferSizeFuncDef = {"adsSetOctetBufferSize",1,adsSetOctetBufferSizeArgs};
+
+  static void adsSetOctetBufferSizeCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsSetOctetBufferSize";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    if(args[0].ival<=0){
+      printf("%s:%s: Invalid size: %d.\n", driverName, functionName,args[0].ival);
+      return;
+    }
+    adsAsynPortObj->setOctetBufferSize((size_t)args[0].ival);
+  }
+
+  /*
+   * adsSetChunkSize(size, poll)
+   */
+  static const iocshArg adsSetChunkSizeArg0 = {"size (bytes, 0=no chunks, chunked writes are not atomic)", iocshArgInt};
+  static const iocshArg adsSetChunkSizeArg1 = {"poll (1=poll large I/O Intr arrays in chunks)", iocshArgInt};
+  static const iocshArg *adsSetChunkSizeArgs[] = {&adsSetChunkSizeArg0,&adsSetChunkSizeArg1};
+  static const iocshFuncDef adsSetChunkSizeFuncDef = {"adsSetChunkSize",2,adsSetChunkSizeArgs};
+
+  static void adsSetChunkSizeCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsSetChunkSize";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    if(args[0].ival<0){
+      printf("%s:%s: Invalid size: %d.\n", driverName, functionName,args[0].ival);
+      return;
+    }
+    adsAsynPortObj->setChunkSize((uint32_t)args[0].ival,args[1].ival!=0);
+  }
+
+  /*
+   * adsTopTalkers(count, order, reset)
+   */
+  static const iocshArg adsTopTalkersArg0 = {"count", iocshArgInt};
+  static const iocshArg adsTopTalkersArg1 = {"order (rate/bytes)", iocshArgString};
+  static const iocshArg adsTopTalkersArg2 = {"reset (1=reset counters)", iocshArgInt};
+  static const iocshArg *adsTopTalkersArgs[] = {&adsTopTalkersArg0,&adsTopTalkersArg1,&adsTopTalkersArg2};
+  static const iocshFuncDef adsTopTalkersFuncDef = {"adsTopTalkers",3,adsTopTalkersArgs};
+
+  static void adsTopTalkersCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsTopTalkers";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    int count=args[0].ival>0 ? args[0].ival : 20;
+    const char *order=args[1].sval ? args[1].sval : "rate";
+    if(strcmp(order,"rate")!=0 && strcmp(order,"bytes")!=0){
+      printf("%s:%s: Invalid order: %s (rate or bytes).\n", driverName, functionName,order);
+      return;
+    }
+    adsAsynPortObj->topTalkers(count,order,args[2].ival);
+  }
+
+  /*
+   * adsTraceDump(count, file)
+   */
+  static const iocshArg adsTraceDumpArg0 = {"count (0=all)", iocshArgInt};
+  static const iocshArg adsTraceDumpArg1 = {"file (empty=live trace)", iocshArgString};
+  static const iocshArg *adsTraceDumpArgs[] = {&adsTraceDumpArg0,&adsTraceDumpArg1};
+  static const iocshFuncDef adsTraceDumpFuncDef = {"adsTraceDump",2,adsTraceDumpArgs};
+
+  static void adsTraceDumpCallFunc(const iocshArgBuf *args)
+  {
+    adsTraceDump(stdout,args[0].ival,args[1].sval);
+  }
+
+  /*
+   * adsTraceSave(file)
+   */
+  static const iocshArg adsTraceSaveArg0 = {"file name", iocshArgString};
+  static const iocshArg *adsTraceSaveArgs[] = {&adsTraceSaveArg0};
+  static const iocshFuncDef adsTraceSaveFuncDef = {"adsTraceSave",1,adsTraceSaveArgs};
+
+  static void adsTraceSaveCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsTraceSave";
+    if(!args[0].sval || strlen(args[0].sval)==0){
+      printf("%s:%s: No file name given.\n", driverName, functionName);
+      return;
+    }
+    adsTraceSave(args[0].sval);
+  }
+
+  /*
+   * adsSetHeartbeat(periodMS)
+   */
+  static const iocshArg adsSetHeartbeatArg0 = {"period (ms)", iocshArgInt};
+  static const iocshArg *adsSetHeartbeatArgs[] = {&adsSetHeartbeatArg0};
+  static const iocshFuncDef adsSetHeartbeatFuncDef = {"adsSetHeartbeat",1,adsSetHeartbeatArgs};
+
+  static void adsSetHeartbeatCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsSetHeartbeat";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    if(adsAsynPortObj->setHeartbeat(args[0].ival)!=asynSuccess){
+      printf("%s:%s: Invalid period: %d ms.\n", driverName, functionName,args[0].ival);
+    }
+  }
+
+  /*
+   * adsSetClockRead(periodMS, amsPort, group, offset)
+   */
+  static const iocshArg adsSetClockReadArg0 = {"period (ms, 0=disabled)", iocshArgInt};
+  static const iocshArg adsSetClockReadArg1 = {"ams-port (0=TwinCAT system service time)", iocshArgInt};
+  static const iocshArg adsSetClockReadArg2 = {"index group", iocshArgInt};
+  static const iocshArg adsSetClockReadArg3 = {"index offset", iocshArgInt};
+  static const iocshArg *adsSetClockReadArgs[] = {&adsSetClockReadArg0,&adsSetClockReadArg1,&adsSetClockReadArg2,&adsSetClockReadArg3};
+  static const iocshFuncDef adsSetClockReadFuncDef = {"adsSetClockRead",4,adsSetClockReadArgs};
+
+  static void adsSetClockReadCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsSetClockRead";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    if(args[1].ival<0 || args[1].ival>0xFFFF){
+      printf("%s:%s: Invalid ams-port: %d.\n", driverName, functionName,args[1].ival);
+      return;
+    }
+    if(adsAsynPortObj->setClockRead(args[0].ival,(uint16_t)args[1].ival,(uint32_t)args[2].ival,(uint32_t)args[3].ival)!=asynSuccess){
+      printf("%s:%s: Invalid period: %d ms.\n", driverName, functionName,args[0].ival);
+    }
+  }
+
+  /*
+   * adsSetSymbolCache(path)
+   */
+  static const iocshArg adsSetSymbolCacheArg0 = {"file name", iocshArgString};
+  static const iocshArg *adsSetSymbolCacheArgs[] = {&adsSetSymbolCacheArg0};
+  static const iocshFuncDef adsSetSymbolCacheFuncDef = {"adsSetSymbolCache",1,adsSetSymbolCacheArgs};
+
+  static void adsSetSymbolCacheCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsSetSymbolCache";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    if(!args[0].sval || strlen(args[0].sval)==0){
+      printf("%s:%s: No file name.\n", driverName, functionName);
+      return;
+    }
+    adsAsynPortObj->setSymbolCache(args[0].sval);
+  }
+
+  /*
+   * adsSetWriteCoalescing(windowMS, maxEntries)
+   */
+  static const iocshArg adsSetWriteCoalescingArg0 = {"window (ms, 0=disable)", iocshArgInt};
+  static const iocshArg adsSetWriteCoalescingArg1 = {"max entries per sum write", iocshArgInt};
+  static const iocshArg *adsSetWriteCoalescingArgs[] = {&adsSetWriteCoalescingArg0,&adsSetWriteCoalescingArg1};
+  static const iocshFuncDef adsSetWriteCoalescingFuncDef = {"adsSetWriteCoalescing",2,adsSetWriteCoalescingArgs};
+
+  static void adsSetWriteCoalescingCallFunc(const iocshArgBuf *args)
+  {
+    const char* functionName = "adsSetWriteCoalescing";
+    if(!adsAsynPortObj){
+      printf("%s:%s: No adsAsynPortDriver configured (call adsAsynPortDriverConfigure() first).\n", driverName, functionName);
+      return;
+    }
+    int maxEntries=args[1].ival>0 ? args[1].ival : BULKSIZ;
+    if(adsAsynPortObj->setWriteCoalescing(args[0].ival,maxEntries)!=asynSuccess){
+      printf("%s:%s: Invalid window (%d ms) or max entries (%d, max %d).\n", driverName, functionName,args[0].ival,maxEntries,BULKSIZ);
+    }
+  }
+
   /*
    * This routine is called before multitasking has started, so there's
    * no race condition in the test/set of firstTime.
@@ -4759,6 +7741,15 @@ extern "C" {
     iocshRegister(&adsAsynPortDriverConfigureFuncDef,adsAsynPortDriverConfigureCallFunc);
     iocshRegister(&adsSetLocalAddressFuncDef,adsSetLocalAddressCallFunc);
     iocshRegister(&adsPollInfoFuncDef, adsPollInfoCallFunc);
+    iocshRegister(&adsSetOctetBufferSizeFuncDef, adsSetOctetBufferSizeCallFunc);
+    iocshRegister(&adsSetChunkSizeFuncDef, adsSetChunkSizeCallFunc);
+    iocshRegister(&adsSetSymbolCacheFuncDef, adsSetSymbolCacheCallFunc);
+    iocshRegister(&adsSetHeartbeatFuncDef, adsSetHeartbeatCallFunc);
+    iocshRegister(&adsSetClockReadFuncDef, adsSetClockReadCallFunc);
+    iocshRegister(&adsTopTalkersFuncDef, adsTopTalkersCallFunc);
+    iocshRegister(&adsTraceDumpFuncDef, adsTraceDumpCallFunc);
+    iocshRegister(&adsTraceSaveFuncDef, adsTraceSaveCallFunc);
+    iocshRegister(&adsSetWriteCoalescingFuncDef, adsSetWriteCoalescingCallFunc);
   }
 
   epicsExportRegistrar(adsAsynPortDriverRegister);
@@ -18,8 +18,13 @@
 #include <dbStaticLib.h>
 #include "AdsLib.h"
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
 #include "adsAsynPortDriverUtils.h"
+#include "adsAsynPortDriverClock.h"
 #include <mutex>
+#include <sys/time.h>
 
 /** Class derived of asynPortDriver for ads communication with TwinCAT plc:s */
 
@@ -95,21 +100,48 @@ public:
                                        size_t nElements);
   asynStatus adsUpdateParameterLock(adsParamInfo* paramInfo,
                                     const void *data);
+  asynStatus adsUpdateParameterLock(adsParamHot* hot,
+                                    const void *data,
+                                    size_t dataSize);
   asynStatus invalidateParamsLock(uint16_t amsPort);
   asynStatus refreshParamsLock(uint16_t amsPort);
+  asynStatus refreshChangedParamsLock(uint16_t amsPort);
+  asynStatus restoreParamsLock(uint16_t amsPort);
   asynStatus adsDelRouteLock(int force);
   asynStatus adsAddRouteLock();
   asynStatus fireAllCallbacksLock();
   asynUser *getTraceAsynUser();
+  int getDriverIndex();
+  adsClockModel *getClockModel();
   int getParamTableSize();
   adsParamInfo *getAdsParamInfo(int index);
+  adsParamHot *getAdsParamHot(int index);
   int getAdsParamCount();
   bool isCallbackAllowed(adsParamInfo *paramInfo);
   bool isCallbackAllowed(uint16_t amsPort);
 
   void cyclicThread();
+  void connectThread();
   void bulkReadThread();
+  void writeQueueThread();
+  void writeBehindThread();
   void poll_info(char *name);
+  void topTalkers(int count,
+                  const char *order,
+                  int reset);
+  asynStatus setOctetBufferSize(size_t size);
+  asynStatus setChunkSize(uint32_t size,bool poll);
+  asynStatus setHeartbeat(int heartbeatMS);
+  asynStatus setClockRead(int periodMS,
+                          uint16_t amsPort,
+                          uint32_t group,
+                          uint32_t offset);
+  void adsStateNotify(uint16_t amsPort,
+                      uint16_t adsState);
+  asynStatus setWriteCoalescing(int windowMS,int maxEntries);
+  asynStatus flushWriteQueue();
+  asynStatus setSymbolCache(const char *path);
+  asynStatus writeSymbolCacheLock();
 protected:
 
 private:
@@ -118,17 +150,32 @@ private:
   asynStatus disconnectLock(asynUser *pasynUser);
 
   asynStatus validateDrvInfo(const char *drvInfo);
+  asynStatus findParamIndex(const char *drvInfo,int *index);
+  void buildRecordIndex();
   asynStatus getRecordInfoFromDrvInfo(const char *drvInfo,
                                       adsParamInfo *paramInfo);
   asynStatus parsePlcInfofromDrvInfo(const char* drvInfo,
                                      adsParamInfo *paramInfo);
+  asynStatus selectConversionKernels(adsParamInfo *paramInfo);
   asynStatus refreshParams();
   asynStatus refreshParams(uint16_t amsPort);
   asynStatus invalidateParams(uint16_t amsPort);
+  asynStatus refreshChangedParams(uint16_t amsPort);
+  asynStatus restoreParams(uint16_t amsPort);
+  asynStatus loadSymbolCache();
+  void unloadSymbolCache();
+  asynStatus writeSymbolCache();
+  bool symbolCacheLookup(adsParamInfo *paramInfo);
+  bool adsSymbolsUnchanged(amsPortInfo *port);
   asynStatus adsUpdateParameter(adsParamInfo* paramInfo,
                                  const void *data);
-  asynStatus adsUpdateParameter(adsParamInfo* paramInfo,
+  asynStatus adsUpdateParameter(adsParamHot* hot,
                                  const void *data,size_t dataSize);
+  void       adsPublishWriteBehindStats();
+  asynStatus adsPublishArray(adsParamInfo* paramInfo,
+                             const void *data,
+                             size_t dataSize);
+  void       adsFreeRetiredArrayStores();
   asynStatus adsUpdateParameterLock(adsParamInfo* paramInfo,
                                     const void *data,
                                     size_t dataSize);
@@ -141,6 +188,8 @@ private:
                                         bool blockErrorMsg);
   asynStatus adsAddSymbolsChangedCallback(amsPortInfo *port);
   asynStatus adsDelSymbolsChangedCallback(amsPortInfo *port);
+  asynStatus adsAddStateCallback(amsPortInfo *port);
+  asynStatus adsDelStateCallback(amsPortInfo *port);
   asynStatus adsGetSymInfoByName(adsParamInfo *paramInfo);
   asynStatus adsGetSymInfoByName(uint16_t amsPort,
                                  const char * varName,
@@ -155,11 +204,24 @@ private:
   asynStatus adsReleaseSymbolicHandle(adsParamInfo *paramInfo);
   asynStatus adsReleaseSymbolicHandle(adsParamInfo *paramInfo,
                                       bool blockErrorMsg);
+  asynStatus adsSumReadWrite(uint16_t amsPort,
+                             ADSLANE lane,
+                             adsSumRequest *requests,
+                             uint32_t count);
+  bool       adsSumTargetPortLost(const adsSumRequest *requests,
+                                  uint32_t count);
+  asynStatus adsResolveBatch(uint16_t amsPort,
+                             adsParamInfo **params,
+                             uint32_t count);
   asynStatus adsConnect();
   asynStatus adsDisconnect();
   asynStatus adsWriteParam(adsParamInfo *paramInfo,
                       const void *binaryBuffer,
                       uint32_t bytesToWrite);
+  asynStatus adsWriteParam(adsParamInfo *paramInfo,
+                      const void *binaryBuffer,
+                      uint32_t bytesToWrite,
+                      bool *deferred);
   asynStatus adsReadParam(adsParamInfo *paramInfo);
   asynStatus adsReadParam(adsParamInfo *paramInfo,
                           long *error,
@@ -190,48 +252,113 @@ private:
                                  size_t nEpicsBufferBytes,
                                  size_t *nBytesRead);
   asynStatus adsReadVersion(amsPortInfo *port);
+  asynStatus adsReadSymVersion(amsPortInfo *port,
+                               uint8_t *symVersion);
+  asynStatus adsReadPlcClock();
+  asynStatus adsReadSymUploadInfo(amsPortInfo *port,
+                                  uint32_t *symCount,
+                                  uint32_t *symSize);
+  asynStatus adsReadSymbolCacheKey(amsPortInfo *port,
+                                   adsSymbolCachePort *key);
+  void       adsSaveSymbolKey(amsPortInfo *port);
   asynStatus updateParamInfoWithPLCInfo(adsParamInfo *paramInfo);
-  asynStatus refreshParamTime(adsParamInfo *paramInfo);
+  asynStatus refreshParamTime(adsParamHot *hot);
   asynStatus setAlarmPortLock(uint16_t amsPort,int alarm,int severity);
   asynStatus setAlarmPort(uint16_t amsPort,int alarm,int severity);
   asynStatus setAlarmParam(adsParamInfo *paramInfo,int alarm,int severity);
+  asynStatus setAlarmParam(adsParamHot *hot,int alarm,int severity);
+  asynStatus setAlarmParamState(adsParamHot *hot,int alarm,int severity,bool *changed);
   asynStatus fireCallbacks(adsParamInfo* paramInfo);
+  asynStatus fireCallbacks(adsParamHot* hot);
   asynStatus addNewAmsPortToList(uint16_t amsPort);
   amsPortInfo* getAmsPortObject(uint16_t amsPort);
-  void       adsLock();
+  void       adsLock(ADSLANE lane);
   void       adsUnlock();
   asynStatus adsAddToBulkRead(adsParamInfo* paramInfo);
+  bool adsShareSubscription(adsParamInfo* paramInfo);
+  void adsUnshareSubscription(adsParamInfo* paramInfo);
+  void adsRecheckSharedChain(adsParamInfo* leader,bool keep);
+  void adsSharedRate(adsParamInfo* leader,double *sampleTimeMS,double *maxDelayTimeMS);
+  asynStatus adsUpdateFollowers(adsParamHot* hot,const void *data,size_t dataSize,ADSPATH path,int64_t hostNs);
+  asynStatus adsUpdateFollower(adsParamHot* follower,const void *data,size_t dataSize,ADSPATH path,int64_t hostNs);
+  void       adsFlushFollowers();
+  void adsUpdateBulkPlan(int bulkIndex);
+  asynStatus adsAddToChunkedPoll(adsParamInfo* paramInfo);
+  void       adsRemoveFromChunkedPoll(adsParamInfo* paramInfo);
+  bool       adsUseChunkedPoll(adsParamInfo* paramInfo);
+  void       adsSetChunkProgress(adsParamInfo *paramInfo,uint32_t done,uint32_t total);
+  void       adsGetChunkProgress(adsParamInfo *paramInfo,uint32_t *done,uint32_t *total);
+  asynStatus adsQueueWrite(adsParamInfo *paramInfo,
+                           uint32_t group,
+                           uint32_t offset,
+                           const void *data,
+                           uint32_t dataSize);
+  long       adsSumWriteSend(adsWriteQueueEntry *entries,
+                             uint32_t count,
+                             long *errors);
+  void       adsSumWriteResults(adsWriteQueueEntry *entries,
+                                uint32_t count,
+                                const long *errors);
+  void       adsFlushQueuedWrites(adsParamInfo *paramInfo);
+  asynStatus adsWriteBehind(adsParamInfo *paramInfo,
+                            uint32_t group,
+                            uint32_t offset,
+                            const void *data,
+                            uint32_t dataSize);
+  void       adsPollChunked();
+  asynStatus adsReadChunked(adsParamInfo *paramInfo,
+                            uint32_t group,
+                            uint32_t offset,
+                            void *data,
+                            uint32_t dataSize,
+                            uint32_t *bytesRead,
+                            long *error);
+  asynStatus adsWriteChunked(adsParamInfo *paramInfo,
+                             uint32_t group,
+                             uint32_t offset,
+                             const void *data,
+                             uint32_t dataSize,
+                             long *error);
   int        adsFindBulkTimeStamp(uint16_t amsPort);
+  void       adsUpdateBulkTimeStamp(int bulkIndex);
+  void       adsRefreshBulkTimeStamps(uint16_t amsPort);
 
   //Octet interface methods (ascii command parser through readoctet() and writeoctet())
-  int        octetCMDreadIt(char *outbuf,
-                            size_t outlen);
-  int        octetCMDwriteIt(const char *inbuf,
+  adsOctetSession* octetSessionAcquire(asynUser *pasynUser);
+  void       octetSessionRelease(adsOctetSession *session);
+  void       octetSessionFree(adsOctetSession *session);
+  void       octetSessionFreeIdle();
+  int        octetCMDreadIt(adsOctetSession *session,
+                            char *outbuf,
+                            size_t outlen,
+                            size_t *bytesRead);
+  int        octetCMDwriteIt(adsOctetSession *session,
+                             const char *inbuf,
                              size_t inlen);
   int        octetCmdHandleInputLine(const char *input_line,
-                                     adsOctetOutputBufferType *buffer);
+                                     adsOctetSession *session);
   int        octetMotorHandleOneArg(const char *myarg_1,
-                                    adsOctetOutputBufferType *buffer);
+                                    adsOctetSession *session);
   int        octetMotorHandleADRCmd(const char *arg,
                                     uint16_t adsport,
-                                    adsOctetOutputBufferType *buffer);
+                                    adsOctetSession *session);
   int        octetAdsReadByName(uint16_t amsPort,
                                 const char *variableAddr,
-                                adsOctetOutputBufferType* outBuffer);
+                                adsOctetSession *session);
   int        octetAdsWriteByName(uint16_t amsPort,
                                  const char *variableAddr,
                                  const char *asciiValueToWrite,
-                                 adsOctetOutputBufferType *outBuffer);
+                                 adsOctetSession *session);
   int        octetAdsReadByGroupOffset(uint16_t amsPort,
                                        adsSymbolEntry *info,
-                                       adsOctetOutputBufferType *outBuffer);
+                                       adsOctetSession *session);
   int        octetAdsWriteByGroupOffset(uint16_t amsPort,
                                         uint32_t group,
                                         uint32_t offset,
                                         uint16_t dataType,
                                         uint32_t dataSize,
                                         const char *asciiValueToWrite,
-                                        adsOctetOutputBufferType *asciiResponseBuffer);
+                                        adsOctetSession *session);
 
   char                           *ipaddr_;
   char                           *amsaddr_;
@@ -250,14 +377,26 @@ private:
   unsigned int                   priority_;
   AmsNetId                       remoteNetId_;
   adsParamInfo                   **pAdsParamArray_;
+  adsParamHot                    *pAdsParamHot_;   //Hot data of parameters (indexed by paramIndex, see adsParamHot)
   std::vector<amsPortInfo*>      amsPortList_;
+  int                            driverIndex_;  //Index in driver registry (upper 8 bits of hUser)
+  int                            heartbeatMS_;  //Link supervision period (ams states by notification)
+  epicsEventId                   cyclicEvent_;  //Wakes cyclicThread() on ads state change
+  int                            clockReadMS_;  //Explicit PLC time read period (0=disabled, see adsReadPlcClock())
+  uint16_t                       clockReadAmsPort_;
+  uint32_t                       clockReadGroup_;
+  uint32_t                       clockReadOffset_;
+  int64_t                        clockReadNextNs_;
+  long                           clockReadError_;  //Last error (logged on change)
+  uint64_t                       statsStartUs_; //Start of traffic statistics window
   ADSTIMESOURCE                  defaultTimeSource_;
-  std::mutex                     adsMutex;
+  adsPriorityLock                adsMutex;
 
   //octet
-  adsOctetOutputBufferType       octetAsciiBuffer_;
-  uint8_t                        octetBinaryBuffer_[ADS_CMD_BUFFER_SIZE];
-  int                            octetReturnVarName_;
+  std::map<const asynUser*,adsOctetSession*> octetSessions_;
+  std::mutex                     octetSessionMutex_;
+  size_t                         octetBufferSize_;
+  unsigned long                  octetSessionCounter_;
 
   //bulk read
 #define MAXTSENTRY 10
@@ -266,25 +405,87 @@ private:
       uint32_t iHandleH;
       uint32_t iHandleL;
       int refreshNeeded;
+      uint64_t cycleTimeStamp; // Time stamp shared by all bulk reads of the port in a cycle
+      unsigned long cycle;     // Bulk cycle of cycleTimeStamp
   } bulkTS[MAXTSENTRY];
   int bulkTScnt;
 #define MAXBULK 2000
 #define BULKSIZ 500
+  struct bulkPlanEntry {
+      adsParamHot *hot;      // Destination (NULL for the time stamp elements)
+      uint32_t offset;       // Offset of the data in the reply data area
+      uint32_t size;         // Size of the data (iSize of the request)
+  };
   struct {
       int cnt;               // Number of variables in this read
       uint16_t amsPort;      // The port this goes to!
+      int tsSlots;           // 2 if sum[0]/sum[1] read the time stamp (first read of the port), else 0
+      int tsIndex;           // Index in bulkTS of the port
       struct {
           uint32_t iGroup;
           uint32_t iOffset;
           uint32_t iSize;
       } sum[BULKSIZ];        // The actual request!
       int paramID[BULKSIZ];  // The asyn parameter handles
+      bulkPlanEntry plan[BULKSIZ]; // Decode plan of the reply (see adsUpdateBulkPlan())
       int readSize;          // The total size of the read expected (including status).
       int refreshNeeded;
   } bulk[MAXBULK];
   int bulk_delay_us;         // Rate to process bulk reads.
+  unsigned long bulkCycle;   // Bulk read cycle counter (bulk read thread).
   uint8_t *bulkdata;         // A read buffer of maximum size.
   int bulkdatasize;          // Size of the read buffer.
+  uint32_t chunkSize_;       // Max bytes per ADS request for large arrays (0=no chunks).
+  bool chunkedPoll_;         // Poll large I/O Intr arrays in chunks (instead of notification).
+  std::mutex chunkProgressMutex_; // Protects chunksDone/chunksTotal of all params.
+  std::vector<int> chunkedPollList_; // Large arrays polled in chunks (protected by adsMutex).
+  adsClockModel clockModel_;  // PLC clock offset/drift (time stamps of bulk reads without PLC time)
+
+  //write coalescing
+  std::vector<adsWriteQueueEntry> writeQueue_;
+  std::mutex                     writeQueueMutex_;
+  std::mutex                     writeSendMutex_;  //held while queued writes are sent (before writeQueueMutex_)
+  std::atomic<int>               *writeQueued_;    //Queued or sending writes per parameter index (checked without mutex)
+  epicsEventId                   writeQueueEvent_;
+  int                            writeCoalesceWindowMS_;  //0=disabled
+  int                            writeCoalesceMaxEntries_;
+  bool                           writeFlushRequested_;
+  uint64_t                       writeQueueFirstUs_;
+  unsigned long                  writeQueueBatches_;
+  unsigned long                  writeQueueEntries_;
+  unsigned long                  writeQueueErrors_;
+
+  //write-behind
+  std::vector<int>               writeBehindPendingList_;
+  std::mutex                     writeBehindMutex_;
+  epicsEventId                   writeBehindEvent_;
+  unsigned long                  writeBehindSent_;       //Totals of all parameters (port lock)
+  unsigned long                  writeBehindFailed_;     //(port lock)
+  unsigned long                  writeBehindCollapsed_;  //(writeBehindMutex_)
+  std::vector<adsParamInfo*>     writeBehindStatsParams_; //Parameters publishing the totals (see adsPublishWriteBehindStats())
+
+  //symbol cache
+  char                           *symbolCachePath_;
+  void                           *symbolCacheMap_;
+  size_t                         symbolCacheMapSize_;
+  std::map<std::string,const adsSymbolCacheEntry*> symbolCacheIndex_;  //"amsPort:name"
+  std::map<uint16_t,adsSymbolCachePort> symbolCachePorts_;  //amsPort -> symbol version and upload info
+
+  //parameter lookup in drvUserCreate()
+  std::unordered_map<std::string,int> paramIndexMap_;          //drvInfo -> parameter index (protected by lock())
+  std::unordered_map<std::string,std::string> recordIndex_;   //drvInfo -> name of first record linked to this port
+  bool                           recordIndexBuilt_;
+  int                            linkCount_;         //Parameters created (startup progress)
+  struct timeval                 linkStart_;
+  double                         linkCreateParamS_;  //Time in asynPortDriver::createParam() (duplicate scan in asyn)
+
+  //shared subscriptions
+  std::map<std::string,int>      sharedSubscriptions_;  //"amsPort:plcAdrStr" -> parameter holding the subscription
+  int                            sharedPendingCount_;   //Followers with data held back (see adsFlushFollowers())
+
+  //array stores
+  std::vector<adsArrayStore*>    retiredArrayStores_;  //Replaced stores (see adsFreeRetiredArrayStores())
+  std::atomic<int>               arrayPublishers_;     //Threads in adsPublishArray() without port lock
  public:
   int bulkOK;                // OK to process bulk reads!
   int bulk_elapsed_us;       // Time of last bulk read loop.
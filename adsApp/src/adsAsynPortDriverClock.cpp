@@ -0,0 +1,226 @@
+/*
+    This file is part of epics-twincat-ads.
+
+    epics-twincat-ads is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+    epics-twincat-ads is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with epics-twincat-ads. If not, see <https://www.gnu.org/licenses/>.
+
+*/
+/*
+* adsAsynPortDriverClock.cpp
+*
+* Model of the PLC clock (see adsAsynPortDriverClock.h).
+*
+* Created October 19, 2026
+*/
+
+#include "adsAsynPortDriverClock.h"
+#include <time.h>
+#include <math.h>
+
+#define FILETIME_TICKS_AT_UNIX_EPOCH 116444736000000000LL  //100ns ticks 1601-01-01 to 1970-01-01
+
+/** Get IOC time.
+ * \return Nanoseconds since 1970-01-01 (CLOCK_REALTIME).
+ */
+int64_t adsClockHostNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME,&now);
+  return (int64_t)now.tv_sec*1000000000+now.tv_nsec;
+}
+
+static int64_t fileTimeToNs(uint64_t plcTime)
+{
+  return ((int64_t)plcTime-FILETIME_TICKS_AT_UNIX_EPOCH)*100;
+}
+
+static uint64_t nsToFileTime(int64_t ns)
+{
+  return (uint64_t)(ns/100+FILETIME_TICKS_AT_UNIX_EPOCH);
+}
+
+/** Forget all samples (call with mutex or before the model is used).
+ * \param[in] model Clock model.
+ * \return void
+ */
+static void adsClockModelClear(adsClockModel *model)
+{
+  model->windowHasSample=false;
+  model->windowStartNs=0;
+  model->windowHostNs=0;
+  model->windowOffsetNs=0;
+  model->pointCount=0;
+  model->pointNext=0;
+  model->valid=false;
+  model->refHostNs=0;
+  model->offsetNs=0;
+  model->drift=0;
+  model->latencyNs=0;
+  model->jitter2=0;
+  model->outliersInRow=0;
+}
+
+/** Reset clock model (all samples and statistics).
+ * \param[in] model Clock model.
+ * \return void
+ */
+void adsClockModelReset(adsClockModel *model)
+{
+  std::lock_guard<std::mutex> guard(model->mutex);
+  adsClockModelClear(model);
+  model->nextSampleNs=0;
+  model->samples=0;
+  model->explicitSamples=0;
+  model->skippedSamples=0;
+  model->resets=0;
+  model->outliers=0;
+}
+
+/** Least squares fit of offset and drift to the window minima (call with mutex).
+ * \param[in] model Clock model.
+ * \return void
+ */
+static void adsClockModelFit(adsClockModel *model)
+{
+  int newest=(model->pointNext+ADS_CLOCK_POINTS-1)%ADS_CLOCK_POINTS;
+  model->refHostNs=model->points[newest].hostNs;
+  int64_t refOffsetNs=model->points[newest].offsetNs;
+
+  // x [s] and y [ns] relative to the newest point (keeps doubles exact)
+  double sx=0,sy=0,sxx=0,sxy=0;
+  int n=model->pointCount;
+  for(int i=0;i<n;i++){
+    double x=(double)(model->points[i].hostNs-model->refHostNs)/1e9;
+    double y=(double)(model->points[i].offsetNs-refOffsetNs);
+    sx+=x;
+    sy+=y;
+    sxx+=x*x;
+    sxy+=x*y;
+  }
+  double denominator=n*sxx-sx*sx;
+  double slope=0;  //[ns/s]
+  if(n>=2 && denominator>1e-9){
+    slope=(n*sxy-sx*sy)/denominator;
+  }
+  double intercept=(sy-slope*sx)/n;
+  model->offsetNs=(double)refOffsetNs+intercept;
+  model->drift=slope/1e9;
+  model->valid=true;
+}
+
+/** Add a pair of PLC and IOC time.
+ * Notification samples are used at most every ADS_CLOCK_SAMPLE_MS, the
+ * others return before taking the mutex.
+ * \param[in] model Clock model.
+ * \param[in] plcTime PLC time (Windows FILETIME, 100ns since 1601-01-01).
+ * \param[in] hostNs IOC time when received (adsClockHostNs()). For explicit
+ *            reads the middle of the request.
+ * \param[in] explicitRead Sample from an explicit time read (not a notification).
+ * \return void
+ */
+void adsClockModelAddSample(adsClockModel *model,uint64_t plcTime,int64_t hostNs,bool explicitRead)
+{
+  if(plcTime==0){
+    return;
+  }
+  if(!explicitRead){
+    int64_t nextNs=model->nextSampleNs.load(std::memory_order_relaxed);
+    if(hostNs<nextNs ||
+       !model->nextSampleNs.compare_exchange_strong(nextNs,hostNs+(int64_t)ADS_CLOCK_SAMPLE_MS*1000000,std::memory_order_relaxed)){
+      model->skippedSamples.fetch_add(1,std::memory_order_relaxed);
+      return;
+    }
+  }
+  int64_t offsetNs=hostNs-fileTimeToNs(plcTime);
+
+  std::lock_guard<std::mutex> guard(model->mutex);
+  model->samples++;
+  if(explicitRead){
+    model->explicitSamples++;
+  }
+
+  if(model->valid){
+    double residual=(double)offsetNs-(model->offsetNs+model->drift*(double)(hostNs-model->refHostNs));
+    if(fabs(residual)>ADS_CLOCK_RESET_NS){
+      //Single outliers (a stalled IOC thread, a late notification) are dropped.
+      //Several in a row: PLC (or IOC) time was set, start over
+      model->outliers++;
+      if(++model->outliersInRow<ADS_CLOCK_RESET_SAMPLES){
+        return;
+      }
+      adsClockModelClear(model);
+      model->resets++;
+    }
+    else{
+      model->outliersInRow=0;
+      double delta=residual-model->latencyNs;
+      model->latencyNs+=ADS_CLOCK_JITTER_WEIGHT*delta;
+      model->jitter2=(1-ADS_CLOCK_JITTER_WEIGHT)*(model->jitter2+ADS_CLOCK_JITTER_WEIGHT*delta*delta);
+    }
+  }
+
+  if(!model->windowHasSample){
+    model->windowHasSample=true;
+    model->windowStartNs=hostNs;
+    model->windowHostNs=hostNs;
+    model->windowOffsetNs=offsetNs;
+  }
+  else if(offsetNs<model->windowOffsetNs){
+    model->windowHostNs=hostNs;
+    model->windowOffsetNs=offsetNs;
+  }
+
+  //Window done: add minimum to the fit. First window is closed at once to get a model quickly
+  if(hostNs-model->windowStartNs>=(int64_t)ADS_CLOCK_WINDOW_MS*1000000 || model->pointCount==0){
+    model->points[model->pointNext].hostNs=model->windowHostNs;
+    model->points[model->pointNext].offsetNs=model->windowOffsetNs;
+    model->pointNext=(model->pointNext+1)%ADS_CLOCK_POINTS;
+    if(model->pointCount<ADS_CLOCK_POINTS){
+      model->pointCount++;
+    }
+    model->windowHasSample=false;
+    adsClockModelFit(model);
+  }
+}
+
+/** Estimate PLC time at an IOC time.
+ * \param[in] model Clock model.
+ * \param[in] hostNs IOC time (adsClockHostNs()).
+ * \param[out] plcTime PLC time (Windows FILETIME).
+ * \return 0 or -1 if no samples yet.
+ */
+int adsClockModelPlcTime(adsClockModel *model,int64_t hostNs,uint64_t *plcTime)
+{
+  std::lock_guard<std::mutex> guard(model->mutex);
+  if(!model->valid){
+    return -1;
+  }
+  double offsetNs=model->offsetNs+model->drift*(double)(hostNs-model->refHostNs);
+  *plcTime=nsToFileTime(hostNs-(int64_t)offsetNs);
+  return 0;
+}
+
+/** Print clock model diagnostics.
+ * \param[in] model Clock model.
+ * \param[in] fp Output file.
+ * \return void
+ */
+void adsClockModelReport(adsClockModel *model,FILE *fp)
+{
+  std::lock_guard<std::mutex> guard(model->mutex);
+  if(!model->valid){
+    fprintf(fp, "  No PLC time samples yet (%lu samples).\n",(unsigned long)model->samples);
+    return;
+  }
+  double offsetNs=model->offsetNs+model->drift*(double)(adsClockHostNs()-model->refHostNs);
+  fprintf(fp, "  Offset IOC-PLC [ms]:         %.3lf\n",offsetNs/1e6);
+  fprintf(fp, "  Drift [ppm]:                 %.3lf\n",model->drift*1e6);
+  fprintf(fp, "  Latency (mean) [ms]:         %.3lf\n",model->latencyNs/1e6);
+  fprintf(fp, "  Jitter (std) [ms]:           %.3lf\n",sqrt(model->jitter2)/1e6);
+  fprintf(fp, "  Samples:                     %lu (%lu explicit reads, %lu notifications skipped), %d windows, %lu outliers, %lu resets\n",
+          (unsigned long)model->samples,(unsigned long)model->explicitSamples,(unsigned long)model->skippedSamples.load(),
+          model->pointCount,(unsigned long)model->outliers,(unsigned long)model->resets);
+}
@@ -0,0 +1,77 @@
+/*
+    This file is part of epics-twincat-ads.
+
+    epics-twincat-ads is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+    epics-twincat-ads is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with epics-twincat-ads. If not, see <https://www.gnu.org/licenses/>.
+
+*/
+/*
+* adsAsynPortDriverClock.h
+*
+* Model of the PLC clock (offset and drift relative to the IOC clock).
+* Fed with pairs of PLC time (Windows FILETIME) and IOC receive time from
+* ADS notifications and explicit time reads. Used to time stamp data that
+* has no PLC time of its own (bulk reads) in the PLC time domain.
+*
+* Created October 19, 2026
+*/
+
+#ifndef ADSASYNPORTDRIVERCLOCK_H_
+#define ADSASYNPORTDRIVERCLOCK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <mutex>
+#include <atomic>
+
+#define ADS_CLOCK_WINDOW_MS 1000          //Length of window for lower envelope of offset samples
+#define ADS_CLOCK_POINTS 60               //Windows used for the offset/drift fit
+#define ADS_CLOCK_RESET_NS 1000000000LL   //Samples deviating more are outliers (dropped)
+#define ADS_CLOCK_RESET_SAMPLES 5         //Model reset after this many outliers in a row (PLC time set)
+#define ADS_CLOCK_JITTER_WEIGHT 0.01      //Weight of new sample in latency and jitter (moving mean/variance)
+#define ADS_CLOCK_SAMPLE_MS 10            //Min time between notification samples (explicit reads always used)
+
+/* Offset (IOC time - PLC time) sampled as the minimum of a window. Transport
+   delays only add to the offset so the minimum is the best estimate.*/
+typedef struct {
+  int64_t hostNs;
+  int64_t offsetNs;
+} adsClockPoint;
+
+typedef struct adsClockModel{
+  std::mutex     mutex;
+  std::atomic<int64_t> nextSampleNs;  //Notification samples before this time are skipped (no mutex)
+  //current window
+  bool           windowHasSample;
+  int64_t        windowStartNs;
+  int64_t        windowHostNs;
+  int64_t        windowOffsetNs;
+  //lower envelope (ring of window minima)
+  adsClockPoint  points[ADS_CLOCK_POINTS];
+  int            pointCount;
+  int            pointNext;
+  //fit: offset(hostNs)=offsetNs+drift*(hostNs-refHostNs)
+  bool           valid;
+  int64_t        refHostNs;
+  double         offsetNs;
+  double         drift;         //[ns/ns]
+  double         latencyNs;     //Moving mean of sample residuals (transport delay) [ns]
+  double         jitter2;       //Moving variance of sample residuals [ns^2]
+  uint64_t       samples;
+  uint64_t       explicitSamples;
+  std::atomic<uint64_t> skippedSamples;  //Notification samples skipped (ADS_CLOCK_SAMPLE_MS)
+  uint64_t       resets;
+  uint64_t       outliers;      //Samples dropped (deviation > ADS_CLOCK_RESET_NS)
+  int            outliersInRow;
+}adsClockModel;
+
+int64_t adsClockHostNs();
+void adsClockModelReset(adsClockModel *model);
+void adsClockModelAddSample(adsClockModel *model,uint64_t plcTime,int64_t hostNs,bool explicitRead);
+int adsClockModelPlcTime(adsClockModel *model,int64_t hostNs,uint64_t *plcTime);
+void adsClockModelReport(adsClockModel *model,FILE *fp);
+
+#endif /* ADSASYNPORTDRIVERCLOCK_H_ */
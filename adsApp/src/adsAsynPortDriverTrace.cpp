@@ -0,0 +1,305 @@
+/*
+    This file is part of epics-twincat-ads.
+
+    epics-twincat-ads is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+    epics-twincat-ads is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with epics-twincat-ads. If not, see <https://www.gnu.org/licenses/>.
+
+*/
+/*
+* adsAsynPortDriverTrace.cpp
+*
+* Binary event trace of the driver hot paths (see adsAsynPortDriverTrace.h).
+*
+* Created October 19, 2026
+*/
+
+#include "adsAsynPortDriverTrace.h"
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <epicsThread.h>
+
+#if (ADS_TRACE_RING_SIZE & (ADS_TRACE_RING_SIZE-1))
+#error ADS_TRACE_RING_SIZE must be a power of 2
+#endif
+
+/* Ring of one thread. Only the owning thread writes, head is the number of
+   events ever written (next slot is head & (ADS_TRACE_RING_SIZE-1)).
+   Rings are never freed (driver and AdsLib threads live as long as the IOC).*/
+typedef struct {
+  std::atomic<uint64_t> head;
+  char                  threadName[ADS_TRACE_THREAD_NAME_SIZE];
+  adsTraceRecord        records[ADS_TRACE_RING_SIZE];
+} adsTraceRing;
+
+/* Record together with the ring (thread) it was recorded in.*/
+typedef struct {
+  adsTraceRecord record;
+  uint32_t       ring;
+} adsTraceItem;
+
+static thread_local adsTraceRing *traceRing=NULL;
+static std::vector<adsTraceRing*> traceRings;
+static std::mutex traceRingsMutex;
+
+static const char *traceEventNames[ADS_TRACE_MAX]={
+  "NONE","NOTIFY","BULK","BULKEL","READ","WRITE","SUMWR","CALLBK","ALARM"
+};
+
+/** Allocate and register the ring of the calling thread.
+ * \return ring or NULL if out of memory.
+ */
+static adsTraceRing *adsTraceRingCreate()
+{
+  adsTraceRing *ring=new (std::nothrow) adsTraceRing;
+  if(!ring){
+    return NULL;
+  }
+  memset(ring->records,0,sizeof(ring->records));
+  ring->head.store(0,std::memory_order_relaxed);
+  const char *name=epicsThreadGetNameSelf();
+  strncpy(ring->threadName,name ? name : "unknown",sizeof(ring->threadName)-1);
+  ring->threadName[sizeof(ring->threadName)-1]='\0';
+
+  std::lock_guard<std::mutex> guard(traceRingsMutex);
+  traceRings.push_back(ring);
+  traceRing=ring;
+  return ring;
+}
+
+/** Record one event in the ring of the calling thread (lock free).
+ * \param[in] event Event type.
+ * \param[in] driver Driver index.
+ * \param[in] index Parameter index (or bulk index/ams port, see ADSTRACEEVENT).
+ * \param[in] size Data size [bytes].
+ * \param[in] status ADS error code or alarm.
+ * \param[in] plcTime PLC time stamp (Windows FILETIME) or 0.
+ * \return void
+ */
+void adsTrace(ADSTRACEEVENT event,int driver,int32_t index,uint32_t size,int32_t status,uint64_t plcTime)
+{
+  adsTraceRing *ring=traceRing;
+  if(!ring){
+    ring=adsTraceRingCreate();
+    if(!ring){
+      return;
+    }
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME,&now);
+
+  uint64_t head=ring->head.load(std::memory_order_relaxed);
+  adsTraceRecord *record=&ring->records[head & (ADS_TRACE_RING_SIZE-1)];
+  record->timeNs=(uint64_t)now.tv_sec*1000000000+now.tv_nsec;
+  record->plcTime=plcTime;
+  record->event=(uint16_t)event;
+  record->driver=(uint16_t)driver;
+  record->index=index;
+  record->size=size;
+  record->status=status;
+  ring->head.store(head+1,std::memory_order_release);
+}
+
+/** Copy the events of one ring (oldest first). Events that were overwritten
+ * by the owning thread while copying are dropped.
+ * \param[in] ring Ring.
+ * \param[out] records Copied events.
+ * \return void
+ */
+static void adsTraceRingSnapshot(adsTraceRing *ring,std::vector<adsTraceRecord> &records)
+{
+  records.clear();
+  uint64_t head=ring->head.load(std::memory_order_acquire);
+  uint64_t first=head>ADS_TRACE_RING_SIZE ? head-ADS_TRACE_RING_SIZE : 0;
+  for(uint64_t i=first;i<head;i++){
+    records.push_back(ring->records[i & (ADS_TRACE_RING_SIZE-1)]);
+  }
+  // The event at headAfter might be half written over event headAfter-ADS_TRACE_RING_SIZE
+  uint64_t headAfter=ring->head.load(std::memory_order_acquire);
+  if(headAfter+1>first+ADS_TRACE_RING_SIZE){
+    uint64_t drop=std::min<uint64_t>(headAfter+1-ADS_TRACE_RING_SIZE-first,records.size());
+    records.erase(records.begin(),records.begin()+drop);
+  }
+}
+
+/** Copy the events of all rings.
+ * \param[out] items Events (unsorted).
+ * \param[out] names Thread name of each ring.
+ * \return void
+ */
+static void adsTraceSnapshot(std::vector<adsTraceItem> &items,std::vector<std::string> &names)
+{
+  std::vector<adsTraceRecord> records;
+  std::lock_guard<std::mutex> guard(traceRingsMutex);
+  for(size_t i=0;i<traceRings.size();i++){
+    adsTraceRingSnapshot(traceRings[i],records);
+    names.push_back(traceRings[i]->threadName);
+    for(size_t j=0;j<records.size();j++){
+      adsTraceItem item={records[j],(uint32_t)i};
+      items.push_back(item);
+    }
+  }
+}
+
+/** Read events from a file written by adsTraceSave().
+ * \param[in] fileName File name.
+ * \param[out] items Events.
+ * \param[out] names Thread name of each ring.
+ * \return 0 or -1 if file could not be read.
+ */
+static int adsTraceLoad(const char *fileName,std::vector<adsTraceItem> &items,std::vector<std::string> &names)
+{
+  FILE *fp=fopen(fileName,"rb");
+  if(!fp){
+    printf("adsTraceDump: Failed to open %s.\n",fileName);
+    return -1;
+  }
+
+  adsTraceFileHeader header;
+  if(fread(&header,sizeof(header),1,fp)!=1 || header.magic!=ADS_TRACE_FILE_MAGIC ||
+     header.format!=ADS_TRACE_FILE_FORMAT || header.recordSize!=sizeof(adsTraceRecord)){
+    printf("adsTraceDump: %s is not a trace file (or of another format).\n",fileName);
+    fclose(fp);
+    return -1;
+  }
+
+  for(uint32_t i=0;i<header.ringCount;i++){
+    adsTraceFileRing ring;
+    if(fread(&ring,sizeof(ring),1,fp)!=1 || ring.count>ADS_TRACE_RING_SIZE){
+      printf("adsTraceDump: %s is truncated or corrupt.\n",fileName);
+      fclose(fp);
+      return -1;
+    }
+    ring.threadName[sizeof(ring.threadName)-1]='\0';
+    names.push_back(ring.threadName);
+    for(uint32_t j=0;j<ring.count;j++){
+      adsTraceItem item;
+      item.ring=i;
+      if(fread(&item.record,sizeof(item.record),1,fp)!=1){
+        printf("adsTraceDump: %s is truncated or corrupt.\n",fileName);
+        fclose(fp);
+        return -1;
+      }
+      items.push_back(item);
+    }
+  }
+  fclose(fp);
+  return 0;
+}
+
+static bool adsTraceItemOlder(const adsTraceItem &a,const adsTraceItem &b)
+{
+  return a.record.timeNs<b.record.timeNs;
+}
+
+/** Print the latest events of all threads, merged in time order.
+ * \param[in] fp Output stream.
+ * \param[in] count Number of events to print (<=0 prints all).
+ * \param[in] fileName Decode this file (written by adsTraceSave()) instead of the live rings (NULL or empty).
+ * \return void
+ */
+void adsTraceDump(FILE *fp,int count,const char *fileName)
+{
+  std::vector<adsTraceItem> items;
+  std::vector<std::string> names;
+
+  if(fileName && strlen(fileName)>0){
+    if(adsTraceLoad(fileName,items,names)){
+      return;
+    }
+  }
+  else{
+    adsTraceSnapshot(items,names);
+  }
+
+  std::stable_sort(items.begin(),items.end(),adsTraceItemOlder);
+  size_t first=0;
+  if(count>0 && items.size()>(size_t)count){
+    first=items.size()-count;
+  }
+
+  fprintf(fp,"%-20s %10s %-20s %3s %-6s %8s %8s %10s %20s\n",
+          "Time [s]","Delta [us]","Thread","Drv","Event","Index","Size","Status","PLC time [100ns]");
+  uint64_t lastNs=first<items.size() ? items[first].record.timeNs : 0;
+  for(size_t i=first;i<items.size();i++){
+    const adsTraceRecord *record=&items[i].record;
+    fprintf(fp,"%10" PRIu64 ".%09" PRIu64 " %10.1lf %-20.20s %3u %-6s %8d %8u %10d %20" PRIu64 "\n",
+            record->timeNs/1000000000,record->timeNs%1000000000,
+            (double)(record->timeNs-lastNs)/1000.0,
+            names[items[i].ring].c_str(),
+            (unsigned)record->driver,adsTraceEventToString(record->event),
+            record->index,record->size,record->status,record->plcTime);
+    lastNs=record->timeNs;
+  }
+  fprintf(fp,"%zu of %zu events from %zu threads.\n",items.size()-first,items.size(),names.size());
+}
+
+/** Save a snapshot of all rings to file (for post-mortem analysis with adsTraceDump).
+ * \param[in] fileName File name.
+ * \return 0 or -1 if file could not be written.
+ */
+int adsTraceSave(const char *fileName)
+{
+  std::vector<adsTraceItem> items;
+  std::vector<std::string> names;
+  adsTraceSnapshot(items,names);
+
+  std::string tmpName=std::string(fileName)+".tmp";
+  FILE *fp=fopen(tmpName.c_str(),"wb");
+  if(!fp){
+    printf("adsTraceSave: Failed to open %s.\n",tmpName.c_str());
+    return -1;
+  }
+
+  adsTraceFileHeader header={ADS_TRACE_FILE_MAGIC,ADS_TRACE_FILE_FORMAT,(uint32_t)sizeof(adsTraceRecord),(uint32_t)names.size()};
+  bool ok=fwrite(&header,sizeof(header),1,fp)==1;
+
+  // Items are grouped per ring (in ring order) by adsTraceSnapshot()
+  size_t item=0;
+  for(uint32_t i=0;ok && i<names.size();i++){
+    adsTraceFileRing ring;
+    memset(&ring,0,sizeof(ring));
+    strncpy(ring.threadName,names[i].c_str(),sizeof(ring.threadName)-1);
+    size_t end=item;
+    while(end<items.size() && items[end].ring==i){
+      end++;
+    }
+    ring.count=(uint32_t)(end-item);
+    ok=fwrite(&ring,sizeof(ring),1,fp)==1;
+    for(;ok && item<end;item++){
+      ok=fwrite(&items[item].record,sizeof(adsTraceRecord),1,fp)==1;
+    }
+  }
+
+  if(fclose(fp)!=0 || !ok){
+    printf("adsTraceSave: Failed to write %s.\n",tmpName.c_str());
+    remove(tmpName.c_str());
+    return -1;
+  }
+  if(rename(tmpName.c_str(),fileName)!=0){
+    printf("adsTraceSave: Failed to rename %s to %s.\n",tmpName.c_str(),fileName);
+    remove(tmpName.c_str());
+    return -1;
+  }
+  printf("adsTraceSave: %zu events from %zu threads saved to %s.\n",items.size(),names.size(),fileName);
+  return 0;
+}
+
+const char *adsTraceEventToString(int event)
+{
+  if(event<0 || event>=ADS_TRACE_MAX){
+    return "UNKNOWN";
+  }
+  return traceEventNames[event];
+}
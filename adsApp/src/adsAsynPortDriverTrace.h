@@ -0,0 +1,76 @@
+/*
+    This file is part of epics-twincat-ads.
+
+    epics-twincat-ads is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+    epics-twincat-ads is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with epics-twincat-ads. If not, see <https://www.gnu.org/licenses/>.
+
+*/
+/*
+* adsAsynPortDriverTrace.h
+*
+* Binary event trace of the driver hot paths. Every thread that records an
+* event gets its own preallocated ring (no locks when recording). The rings
+* can be printed (adsTraceDump) or saved to a file for post-mortem analysis
+* (adsTraceSave). Always enabled.
+*
+* Created October 19, 2026
+*/
+
+#ifndef ADSASYNPORTDRIVERTRACE_H_
+#define ADSASYNPORTDRIVERTRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ADS_TRACE_RING_SIZE 4096          //Events per thread (power of 2)
+#define ADS_TRACE_THREAD_NAME_SIZE 32
+#define ADS_TRACE_FILE_MAGIC 0x54534441   //"ADST"
+#define ADS_TRACE_FILE_FORMAT 1
+
+typedef enum{
+  ADS_TRACE_NOTIFICATION=1,   //index=param, size=bytes, plcTime=notification time
+  ADS_TRACE_BULK_READ=2,      //index=bulk read, size=bytes, status=ads error
+  ADS_TRACE_BULK_ELEMENT=3,   //index=param, status=ads error (failed elements only)
+  ADS_TRACE_READ=4,           //index=param, size=bytes, status=ads error
+  ADS_TRACE_WRITE=5,          //index=param, size=bytes, status=ads error
+  ADS_TRACE_SUM_WRITE=6,      //index=ams port, size=writes, status=ads error
+  ADS_TRACE_CALLBACK=7,       //index=param (not for bulk reads, see ADS_TRACE_BULK_READ)
+  ADS_TRACE_ALARM=8,          //index=param, status=alarm
+  ADS_TRACE_MAX
+} ADSTRACEEVENT;
+
+/* One event (32 bytes). Also the record format of the trace file.*/
+typedef struct {
+  uint64_t timeNs;     //EPICS host time (CLOCK_REALTIME) [ns]
+  uint64_t plcTime;    //PLC time (Windows FILETIME, 100ns) or 0
+  uint16_t event;
+  uint16_t driver;     //Driver index (adsAsynPortDriver)
+  int32_t  index;
+  uint32_t size;
+  int32_t  status;
+} adsTraceRecord;
+
+/* Trace file: adsTraceFileHeader, then for each thread one
+   adsTraceFileRing followed by count adsTraceRecord (oldest first).*/
+typedef struct {
+  uint32_t magic;
+  uint32_t format;
+  uint32_t recordSize;
+  uint32_t ringCount;
+} adsTraceFileHeader;
+
+typedef struct {
+  char     threadName[ADS_TRACE_THREAD_NAME_SIZE];
+  uint32_t count;
+  uint32_t reserved;
+} adsTraceFileRing;
+
+void adsTrace(ADSTRACEEVENT event,int driver,int32_t index,uint32_t size,int32_t status,uint64_t plcTime);
+void adsTraceDump(FILE *fp,int count,const char *fileName);
+int adsTraceSave(const char *fileName);
+const char *adsTraceEventToString(int event);
+
+#endif /* ADSASYNPORTDRIVERTRACE_H_ */
@@ -21,6 +21,11 @@
 #include "adsAsynPortDriverUtils.h"
 #include <string.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 #include <initHooks.h>
 #include "epicsTime.h"
 
@@ -564,6 +569,491 @@ int windowsToEpicsTimeStamp(uint64_t plcTime, epicsTimeStamp *ts)
   return 0;
 }
 
+/** Set PLC timestamp of a parameter from an already converted timestamp.
+ *
+ * \param[in] hot Parameter data (see adsParamHot).
+ * \param[in] plcTime Timestamp from ams router (Windows format).
+ * \param[in] ts plcTime converted with windowsToEpicsTimeStamp().
+ *
+ * Used when a burst of updates (sum read or notifications) share the same
+ * PLC time so that it is only converted once.
+ */
+void adsSetParamPlcTime(adsParamHot *hot,uint64_t plcTime,const epicsTimeStamp *ts)
+{
+  hot->plcTimeStampRaw=plcTime;
+  hot->plcTimeStamp=*ts;
+  hot->plcTimeStampConverted=plcTime;
+}
+
+/** Get ADS type of the elements of an asyn array type.
+ *
+ * \param[in] asynType Asyn array type.
+ *
+ * \return ADS type or ADST_VOID if not an array type.
+ */
+long asynArrayTypeToAdsType(long asynType)
+{
+  switch(asynType){
+    case asynParamInt8Array:
+      return ADST_INT8;
+    case asynParamInt16Array:
+      return ADST_INT16;
+    case asynParamInt32Array:
+      return ADST_INT32;
+    case asynParamFloat32Array:
+      return ADST_REAL32;
+    case asynParamFloat64Array:
+      return ADST_REAL64;
+    default:
+      return ADST_VOID;
+  }
+}
+
+/** Check if a PLC array can be copied as is to/from an EPICS array.
+ *
+ * \param[in] plcType ADS type of PLC array elements.
+ * \param[in] epicsType ADS type of EPICS array elements.
+ *
+ * \return true if no conversion needed.
+ */
+bool adsArrayTypesIdentical(long plcType,long epicsType)
+{
+  if(plcType==epicsType){
+    return true;
+  }
+  // String and bool arrays are accessed as int8array (special case)
+  return epicsType==ADST_INT8 && (plcType==ADST_STRING || plcType==ADST_BIT || plcType==ADST_UINT8);
+}
+
+/*
+ * Array conversion kernels. Plain element loops on restrict pointers so that
+ * the compiler can vectorize them (widening, narrowing and int<->float).
+ */
+template<typename SRC,typename DST,
+         bool SATURATE=std::is_floating_point<SRC>::value && std::is_integral<DST>::value>
+struct convertArrayElement{
+  static inline DST convert(SRC value){
+    return (DST)value;
+  }
+};
+
+// Float to integer: a plain cast is undefined for NaN and out of range
+// values, so clamp to the range of DST and map NaN to 0.
+template<typename SRC,typename DST>
+struct convertArrayElement<SRC,DST,true>{
+  static inline DST convert(SRC value){
+    if(std::isnan(value)){
+      return 0;
+    }
+    if(value<=(SRC)std::numeric_limits<DST>::min()){
+      return std::numeric_limits<DST>::min();
+    }
+    if(value>=(SRC)std::numeric_limits<DST>::max()){
+      return std::numeric_limits<DST>::max();
+    }
+    return (DST)value;
+  }
+};
+
+template<typename SRC,typename DST>
+static void convertArrayKernel(const void *src,void *dst,size_t nElements)
+{
+  const SRC * __restrict srcData=(const SRC *)src;
+  DST * __restrict dstData=(DST *)dst;
+  for(size_t i=0;i<nElements;i++){
+    dstData[i]=convertArrayElement<SRC,DST>::convert(srcData[i]);
+  }
+}
+
+template<typename SRC>
+static void convertArrayToBitKernel(const void *src,void *dst,size_t nElements)
+{
+  const SRC * __restrict srcData=(const SRC *)src;
+  uint8_t * __restrict dstData=(uint8_t *)dst;
+  for(size_t i=0;i<nElements;i++){
+    dstData[i]=srcData[i]!=0;
+  }
+}
+
+template<typename SRC>
+static adsArrayConvertKernel getArrayConvertKernel(long toType)
+{
+  switch(toType){
+    case ADST_INT8:
+      return convertArrayKernel<SRC,int8_t>;
+    case ADST_UINT8:
+      return convertArrayKernel<SRC,uint8_t>;
+    case ADST_INT16:
+      return convertArrayKernel<SRC,int16_t>;
+    case ADST_UINT16:
+      return convertArrayKernel<SRC,uint16_t>;
+    case ADST_INT32:
+      return convertArrayKernel<SRC,int32_t>;
+    case ADST_UINT32:
+      return convertArrayKernel<SRC,uint32_t>;
+    case ADST_INT64:
+      return convertArrayKernel<SRC,int64_t>;
+    case ADST_UINT64:
+      return convertArrayKernel<SRC,uint64_t>;
+    case ADST_REAL32:
+      return convertArrayKernel<SRC,float>;
+    case ADST_REAL64:
+      return convertArrayKernel<SRC,double>;
+    case ADST_BIT:
+      return convertArrayToBitKernel<SRC>;
+    default:
+      return NULL;
+  }
+}
+
+/** Get kernel for element wise conversion of arrays.
+ *
+ * \param[in] fromType ADS type of source elements.
+ * \param[in] toType ADS type of destination elements.
+ *
+ * \return Kernel or NULL if conversion not supported.
+ */
+adsArrayConvertKernel adsGetArrayConvertKernel(long fromType,long toType)
+{
+  switch(fromType){
+    case ADST_INT8:
+      return getArrayConvertKernel<int8_t>(toType);
+    case ADST_UINT8:
+      return getArrayConvertKernel<uint8_t>(toType);
+    case ADST_BIT:
+      return getArrayConvertKernel<uint8_t>(toType);
+    case ADST_INT16:
+      return getArrayConvertKernel<int16_t>(toType);
+    case ADST_UINT16:
+      return getArrayConvertKernel<uint16_t>(toType);
+    case ADST_INT32:
+      return getArrayConvertKernel<int32_t>(toType);
+    case ADST_UINT32:
+      return getArrayConvertKernel<uint32_t>(toType);
+    case ADST_INT64:
+      return getArrayConvertKernel<int64_t>(toType);
+    case ADST_UINT64:
+      return getArrayConvertKernel<uint64_t>(toType);
+    case ADST_REAL32:
+      return getArrayConvertKernel<float>(toType);
+    case ADST_REAL64:
+      return getArrayConvertKernel<double>(toType);
+    default:
+      return NULL;
+  }
+}
+
+const char *adsLaneToString(int lane)
+{
+  switch(lane){
+    case ADS_LANE_CONTROL_WRITE:
+      return "CONTROL_WRITE";
+    case ADS_LANE_ONDEMAND_READ:
+      return "ONDEMAND_READ";
+    case ADS_LANE_SUBSCRIPTION:
+      return "SUBSCRIPTION";
+    case ADS_LANE_POLL:
+      return "POLL";
+    default:
+      return "UNKNOWN_LANE";
+  }
+}
+
+/** Count new data of a parameter (lock free).
+ * \param[in] stats Statistics of parameter.
+ * \param[in] path How the data arrived.
+ * \param[in] bytes Data size.
+ * \param[in] nowUs Time of the event in us (taken once per notification
+ *                  or sum read and shared by its parameters).
+ */
+void adsParamStatsUpdate(adsParamStats *stats,ADSPATH path,size_t bytes,uint64_t nowUs)
+{
+  if(!stats){
+    return;
+  }
+  stats->updates.fetch_add(1,std::memory_order_relaxed);
+  stats->bytes.fetch_add(bytes,std::memory_order_relaxed);
+  stats->path[path].fetch_add(1,std::memory_order_relaxed);
+  uint64_t lastUs=stats->lastUs.exchange(nowUs,std::memory_order_relaxed);
+  if(!lastUs || nowUs<=lastUs){
+    return;
+  }
+  stats->lastIntervalUs.store(nowUs-lastUs,std::memory_order_relaxed);
+  if(nowUs-lastUs>stats->maxIntervalUs.load(std::memory_order_relaxed)){
+    stats->maxIntervalUs.store(nowUs-lastUs,std::memory_order_relaxed);
+  }
+}
+
+void adsParamStatsReset(adsParamStats *stats)
+{
+  if(!stats){
+    return;
+  }
+  stats->updates.store(0,std::memory_order_relaxed);
+  stats->bytes.store(0,std::memory_order_relaxed);
+  stats->callbacks.store(0,std::memory_order_relaxed);
+  stats->errors.store(0,std::memory_order_relaxed);
+  stats->lastUs.store(0,std::memory_order_relaxed);
+  stats->lastIntervalUs.store(0,std::memory_order_relaxed);
+  stats->maxIntervalUs.store(0,std::memory_order_relaxed);
+  for(int i=0;i<ADS_PATH_MAX;i++){
+    stats->path[i].store(0,std::memory_order_relaxed);
+  }
+}
+
+/** Priority lock: Initialize (not locked, statistics cleared).
+ * \param[in] lock Lock.
+ */
+void adsPriorityLockInit(adsPriorityLock *lock)
+{
+  lock->busy=false;
+  lock->agedWaiting=0;
+  for(int i=0;i<ADS_LANE_MAX;i++){
+    lock->waiting[i]=0;
+    lock->aged[i]=0;
+    lock->count[i]=0;
+    lock->maxWaitUs[i]=0;
+    for(int j=0;j<ADS_LANE_HIST_BINS;j++){
+      lock->hist[i][j]=0;
+    }
+  }
+}
+
+/** Priority lock: Take lock. Waits until the lock is free and no higher
+ * priority lane is waiting. After ADS_LANE_MAX_WAIT_MS the caller is aged and
+ * only waits for the lock and other aged waiters.
+ * \param[in] lock Lock.
+ * \param[in] lane Lane of the caller.
+ */
+void adsPriorityLockAcquire(adsPriorityLock *lock,ADSLANE lane)
+{
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  std::chrono::steady_clock::time_point deadline=
+    std::chrono::steady_clock::now()+std::chrono::milliseconds(ADS_LANE_MAX_WAIT_MS);
+  bool aged=false;
+
+  std::unique_lock<std::mutex> guard(lock->mutex);
+  lock->waiting[lane]++;
+  auto ready=[lock,lane,&aged]{
+    if(lock->busy){
+      return false;
+    }
+    if(aged){
+      return true;
+    }
+    if(lock->agedWaiting>0){
+      return false;
+    }
+    for(int i=0;i<lane;i++){
+      if(lock->waiting[i]>0){
+        return false;
+      }
+    }
+    return true;
+  };
+  while(!ready()){
+    if(aged){
+      lock->cond.wait(guard);
+    }
+    else if(lock->cond.wait_until(guard,deadline)==std::cv_status::timeout && !ready()){
+      aged=true;
+      lock->agedWaiting++;
+    }
+  }
+  if(aged){
+    lock->agedWaiting--;
+    lock->aged[lane]++;
+  }
+  lock->waiting[lane]--;
+  lock->busy=true;
+
+  gettimeofday(&end, NULL);
+  double waitUs=(end.tv_sec-start.tv_sec)*1e6+(end.tv_usec-start.tv_usec);
+  int bin=0;
+  for(double limit=10;bin<ADS_LANE_HIST_BINS-1 && waitUs>=limit;limit*=10){
+    bin++;
+  }
+  lock->hist[lane][bin]++;
+  lock->count[lane]++;
+  if(waitUs>lock->maxWaitUs[lane]){
+    lock->maxWaitUs[lane]=waitUs;
+  }
+}
+
+/** Priority lock: Release lock (wakes waiters, highest lane gets it).
+ * \param[in] lock Lock.
+ */
+void adsPriorityLockRelease(adsPriorityLock *lock)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock->mutex);
+    lock->busy=false;
+  }
+  lock->cond.notify_all();
+}
+
+/** Array store: Allocate triple buffered store.
+ * \param[in] size Size of each buffer in bytes.
+ * \return New store or NULL if allocation failed.
+ */
+adsArrayStore *adsArrayStoreCreate(size_t size)
+{
+  adsArrayStore *store=new adsArrayStore();
+  store->size=size;
+  for(int i=0;i<3;i++){
+    store->buffer[i]=calloc(size>0 ? size : 1,1);
+    store->bytesUsed[i]=0;
+    if(!store->buffer[i]){
+      adsArrayStoreDestroy(store);
+      return NULL;
+    }
+  }
+  store->front=0;
+  store->ready=1;
+  store->back=2;
+  store->publishCount=0;
+  return store;
+}
+
+/** Array store: Free store and buffers.
+ * \param[in] store Store (NULL allowed).
+ */
+void adsArrayStoreDestroy(adsArrayStore *store)
+{
+  if(!store){
+    return;
+  }
+  for(int i=0;i<3;i++){
+    free(store->buffer[i]);
+  }
+  delete store;
+}
+
+/** Array store: Get back buffer for writing. Must be followed by
+ * adsArrayStoreWriteUnlock().
+ * \param[in] store Store.
+ * \return Back buffer (store->size bytes).
+ */
+void *adsArrayStoreWriteLock(adsArrayStore *store)
+{
+  store->writeMutex.lock();
+  return store->buffer[store->back];
+}
+
+/** Array store: Publish back buffer. The previously published buffer (if not
+ * picked up by a reader) becomes the new back buffer.
+ * \param[in] store Store.
+ * \param[in] bytesUsed Bytes of valid data in back buffer.
+ */
+void adsArrayStoreWriteUnlock(adsArrayStore *store,size_t bytesUsed)
+{
+  store->bytesUsed[store->back]=bytesUsed;
+  store->back=store->ready.exchange(store->back | ADS_ARRAY_STORE_DIRTY) & 0x3;
+  store->publishCount++;
+  store->writeMutex.unlock();
+}
+
+/** Array store: Get latest published buffer for reading. Must be followed
+ * by adsArrayStoreReadUnlock(). The buffer is not touched by writers.
+ * \param[in] store Store.
+ * \param[out] bytesUsed Bytes of valid data.
+ * \return Front buffer.
+ */
+const void *adsArrayStoreReadLock(adsArrayStore *store,size_t *bytesUsed)
+{
+  store->readMutex.lock();
+  if(store->ready.load() & ADS_ARRAY_STORE_DIRTY){
+    store->front=store->ready.exchange(store->front) & 0x3;
+  }
+  *bytesUsed=store->bytesUsed[store->front];
+  return store->buffer[store->front];
+}
+
+/** Array store: Release front buffer.
+ * \param[in] store Store.
+ */
+void adsArrayStoreReadUnlock(adsArrayStore *store)
+{
+  store->readMutex.unlock();
+}
+
+/** Octet interface: Allocate buffer.
+ *
+ * \param[in] buffer Output data buffer.
+ * \param[in] size Initial size of buffer.
+ * \param[in] maxSize Maximum size the buffer is allowed to grow to.
+ *
+ * \return 0 or error code.
+ */
+int octetInitBuffer(adsOctetOutputBufferType *buffer,size_t size,size_t maxSize)
+{
+  if(buffer==NULL || size==0){
+    return __LINE__;
+  }
+
+  buffer->buffer=(char*)malloc(size);
+  if(!buffer->buffer){
+    return __LINE__;
+  }
+  buffer->bufferSize=size;
+  buffer->maxSize=maxSize<size ? size : maxSize;
+  buffer->bytesUsed=0;
+  buffer->readPos=0;
+  buffer->overflow=false;
+  return 0;
+}
+
+/** Octet interface: Free buffer.
+ *
+ * \param[in] buffer Output data buffer.
+ */
+void octetFreeBuffer(adsOctetOutputBufferType *buffer)
+{
+  if(buffer==NULL){
+    return;
+  }
+  free(buffer->buffer);
+  buffer->buffer=NULL;
+  buffer->bufferSize=0;
+  buffer->bytesUsed=0;
+  buffer->readPos=0;
+}
+
+/** Octet interface: Grow buffer (data is linearized to start at index 0).
+ *
+ * \param[in] buffer Output data buffer.
+ * \param[in] minSize Minimum new size of buffer.
+ *
+ * \return 0 or error code.
+ */
+static int growBuffer(adsOctetOutputBufferType *buffer,size_t minSize)
+{
+  if(minSize>buffer->maxSize){
+    return ADS_COM_ERROR_BUFFER_TO_EPICS_FULL;
+  }
+
+  size_t newSize=buffer->bufferSize*2;
+  if(newSize<minSize){
+    newSize=minSize;
+  }
+  if(newSize>buffer->maxSize){
+    newSize=buffer->maxSize;
+  }
+
+  char *newBuffer=(char*)malloc(newSize);
+  if(!newBuffer){
+    return ADS_COM_ERROR_BUFFER_TO_EPICS_FULL;
+  }
+  size_t bytesRead=octetReadFromBuffer(buffer,newBuffer,buffer->bytesUsed);
+  free(buffer->buffer);
+  buffer->buffer=newBuffer;
+  buffer->bufferSize=newSize;
+  buffer->readPos=0;
+  buffer->bytesUsed=bytesRead;
+  return 0;
+}
+
 /** Octet interface: Add data to buffer.
  *
  * \param[in] buffer Output data buffer.
@@ -574,17 +1064,25 @@ int windowsToEpicsTimeStamp(uint64_t plcTime, epicsTimeStamp *ts)
  */
 int addToBuffer(adsOctetOutputBufferType *buffer,const char *addText, size_t addLength)
 {
-  if(buffer==NULL){
+  if(buffer==NULL || buffer->buffer==NULL){
     return __LINE__;
   }
 
-  if(addLength>=buffer->bufferSize-buffer->bytesUsed-1){
-    return __LINE__;
+  if(addLength>buffer->bufferSize-buffer->bytesUsed){
+    if(growBuffer(buffer,buffer->bytesUsed+addLength)){
+      buffer->overflow=true;
+      return ADS_COM_ERROR_BUFFER_TO_EPICS_FULL;
+    }
   }
 
-  memcpy(&buffer->buffer[buffer->bytesUsed], addText, addLength);
+  size_t writePos=(buffer->readPos+buffer->bytesUsed)%buffer->bufferSize;
+  size_t firstPart=buffer->bufferSize-writePos;
+  if(firstPart>addLength){
+    firstPart=addLength;
+  }
+  memcpy(&buffer->buffer[writePos], addText, firstPart);
+  memcpy(&buffer->buffer[0], addText+firstPart, addLength-firstPart);
   buffer->bytesUsed+=addLength;
-  buffer->buffer[buffer->bytesUsed] = '\0';
   return 0;
 }
 
@@ -598,15 +1096,29 @@ int addToBuffer(adsOctetOutputBufferType *buffer,const char *addText, size_t add
  */
 static int cmd_buf_vprintf(adsOctetOutputBufferType *buffer,  const char* format, va_list arg)
 {
-  const static size_t len = 4096;
+  char buf[1024];
+  va_list argCopy;
+
+  va_copy(argCopy,arg);
+  int res = vsnprintf(buf, sizeof(buf), format, argCopy);
+  va_end(argCopy);
+  if (res < 0) {
+    return __LINE__;
+  }
+
+  if ((size_t)res < sizeof(buf)) {
+    return addToBuffer(buffer, buf, res);
+  }
 
-  char *buf = (char *)calloc(len, 1);
-  int res = vsnprintf(buf, len-1, format, arg);
-  if (res >= 0) {
-    addToBuffer(buffer, buf, res);
+  // Does not fit in stack buffer
+  char *heapBuf = (char *)malloc(res + 1);
+  if (!heapBuf) {
+    return __LINE__;
   }
-  free(buf);
-  return res;
+  vsnprintf(heapBuf, res + 1, format, arg);
+  int error = addToBuffer(buffer, heapBuf, res);
+  free(heapBuf);
+  return error;
 }
 
 /** Octet interface: Print data to buffer.
@@ -624,9 +1136,34 @@ int octetCmdBuf_printf(adsOctetOutputBufferType *buffer,const char *format, ...)
   }
   va_list ap;
   va_start(ap, format);
-  (void)cmd_buf_vprintf(buffer, format, ap);
+  int error=cmd_buf_vprintf(buffer, format, ap);
   va_end(ap);
-  return 0;
+  return error;
+}
+
+/** Octet interface: Copy data out of buffer and remove it from the buffer.
+ *
+ * \param[in] buffer Output data buffer.
+ * \param[out] outBuffer Destination (no null termination is added).
+ * \param[in] len Size of outBuffer.
+ *
+ * \return Bytes copied to outBuffer.
+ */
+size_t octetReadFromBuffer(adsOctetOutputBufferType *buffer,char *outBuffer,size_t len)
+{
+  if(buffer==NULL || outBuffer==NULL){
+    return 0;
+  }
+
+  size_t bytesToRead=buffer->bytesUsed<len ? buffer->bytesUsed : len;
+  size_t firstPart=buffer->bufferSize-buffer->readPos;
+  if(firstPart>bytesToRead){
+    firstPart=bytesToRead;
+  }
+  memcpy(outBuffer,&buffer->buffer[buffer->readPos],firstPart);
+  memcpy(outBuffer+firstPart,&buffer->buffer[0],bytesToRead-firstPart);
+  octetRemoveFromBuffer(buffer,bytesToRead);
+  return bytesToRead;
 }
 
 /** Octet interface: Remove data from buffer.
@@ -642,14 +1179,17 @@ int octetRemoveFromBuffer(adsOctetOutputBufferType *buffer,size_t len)
     return __LINE__;
   }
 
-  int bytesToMove= buffer->bytesUsed-len;
-  if(bytesToMove<0){
+  if(len>buffer->bytesUsed){
     return __LINE__;
   }
 
-  memmove(&buffer->buffer[0],&buffer->buffer[len],bytesToMove);
-  buffer->bytesUsed=bytesToMove;
-  buffer->buffer[buffer->bytesUsed] = '\0';
+  buffer->bytesUsed-=len;
+  if(buffer->bytesUsed==0){
+    buffer->readPos=0;
+  }
+  else{
+    buffer->readPos=(buffer->readPos+len)%buffer->bufferSize;
+  }
   return 0;
 }
 
@@ -665,7 +1205,8 @@ int octetClearBuffer(adsOctetOutputBufferType *buffer)
     return __LINE__;
   }
   buffer->bytesUsed=0;
-  buffer->buffer[0]='\0';
+  buffer->readPos=0;
+  buffer->overflow=false;
   return 0;
 }
 
@@ -1032,7 +1573,7 @@ int octetBinary2ascii(bool returnVarName,
       error=ADS_COM_ERROR_ADS_READ_BUFFER_INDEX_EXCEEDED_SIZE;
       //printf("Buffer size exceeded. Error: %d\n",error);
     }
-    if((asciiBuffer->bufferSize-asciiBuffer->bytesUsed)<20){
+    if((asciiBuffer->maxSize-asciiBuffer->bytesUsed)<20){
       error=ADS_COM_ERROR_BUFFER_TO_EPICS_FULL;
       //printf("Buffer size exceeded. Error: %d\n",error);
     }
@@ -25,6 +25,9 @@
 #include "AdsLib.h"          //error codes
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 //Error codes
 #define ADS_COM_ERROR_INVALID_DATA_TYPE 1004
@@ -41,8 +44,27 @@
 #define ADS_OPTION_TIMEBASE_EPICS "EPICS"
 #define ADS_OPTION_TIMEBASE_PLC "PLC"
 #define ADS_OPTION_ADSPORT "ADSPORT"
+#define ADS_OPTION_WRITE_BEHIND "WRITE_BEHIND"  //1=write returns directly, latest value sent in background
 #define ADS_OCTET_FEATURES_COMMAND ".THIS.sFeatures?"
 #define ADS_AMS_STATE_COMMAND ".AMSPORTSTATE."
+#define ADS_WRITE_FLUSH_COMMAND ".WRITEFLUSH."
+#define ADS_WRITE_BEHIND_SENT_COMMAND ".WRITEBEHINDSENT."
+#define ADS_WRITE_BEHIND_COLLAPSED_COMMAND ".WRITEBEHINDCOLLAPSED."
+#define ADS_WRITE_BEHIND_FAILED_COMMAND ".WRITEBEHINDFAILED."
+#define ADS_DEFAULT_CHUNK_SIZE (1024*1024)  //Larger arrays are transferred in chunks
+#define ADS_MAX_DRIVERS 256                 //Driver index is stored in the upper 8 bits of hUser
+#define ADS_HUSER(driverIndex,index) ((((uint32_t)(driverIndex))<<24) | ((uint32_t)(index) & 0xFFFFFF))
+#define ADS_HUSER_DRIVER(hUser) ((hUser)>>24)
+#define ADS_HUSER_INDEX(hUser) ((hUser) & 0xFFFFFF)
+#define ADS_DEFAULT_HEARTBEAT_MS 500       //Link supervision (read state) period
+#define ADS_RESOLVE_BATCH_SIZE 100          //Symbols resolved per sum request after reconnect
+#ifndef ADSIGRP_SUMUP_READWRITE
+#define ADSIGRP_SUMUP_READWRITE 0xF082
+#endif
+#define ADS_CLOCK_READ_AMSPORT 10000        //TwinCAT system service (explicit PLC time read)
+#define ADS_CLOCK_READ_GROUP 400            //SYSTEMSERVICE_TIMESERVICES
+#define ADS_CLOCK_READ_OFFSET 2             //TIMESERVICE_SYSTEMTIMES (FILETIME, UTC)
+#define ADS_DEFAULT_CLOCK_READ_MS 0         //Explicit PLC time read period (0=disabled, see adsSetClockRead)
 
 #ifndef ASYN_TRACE_INFO
   #define ASYN_TRACE_INFO      0x0040
@@ -57,10 +79,121 @@ typedef enum{
 typedef enum{
   ADS_DATASOURCE_PLC=0,       //Data in PLC (Normal/default)
   ADS_DATASOURCE_AMS_STATE=1, //Special case parameter linked to ads status (not plc "data")
-  ADS_DATASOURCE_MAX=2,
+  ADS_DATASOURCE_WRITE_FLUSH=2, //Special case parameter, write flushes the write queue
+  ADS_DATASOURCE_WRITE_BEHIND_SENT=3,      //Special case parameter, write-behind values sent (all parameters)
+  ADS_DATASOURCE_WRITE_BEHIND_COLLAPSED=4, //Special case parameter, write-behind values replaced before sent
+  ADS_DATASOURCE_WRITE_BEHIND_FAILED=5,    //Special case parameter, write-behind writes failed
+  ADS_DATASOURCE_MAX=6,
 } ADSDATASOURCE;
 
+/* Lanes of the ADS request lock (lower value = higher priority).*/
+typedef enum{
+  ADS_LANE_CONTROL_WRITE=0,   //Writes from records (and octet commands)
+  ADS_LANE_ONDEMAND_READ=1,   //Reads requested by records/octet
+  ADS_LANE_SUBSCRIPTION=2,    //Handles, notifications, symbol info, state
+  ADS_LANE_POLL=3,            //Background polling (bulk reads, chunked polls)
+  ADS_LANE_MAX
+} ADSLANE;
+
+/* Priority lock for ADS requests. When the lock is released it is given to
+   the highest priority lane with waiters. A waiter that waited longer than
+   ADS_LANE_MAX_WAIT_MS is aged: it is served before all waiters that are not
+   aged, so lower lanes (polling) cannot starve. Time spent waiting is recorded
+   in a histogram per lane (bins: <10us, <100us, <1ms, <10ms, <100ms, <1s, >=1s).*/
+#define ADS_LANE_HIST_BINS 7
+#define ADS_LANE_MAX_WAIT_MS 100
+typedef struct adsPriorityLock{
+  std::mutex              mutex;
+  std::condition_variable cond;
+  bool                    busy;
+  int                     waiting[ADS_LANE_MAX];
+  int                     agedWaiting;            //Waiters (all lanes) waiting longer than ADS_LANE_MAX_WAIT_MS
+  unsigned long           aged[ADS_LANE_MAX];     //Requests served by aging
+  unsigned long           count[ADS_LANE_MAX];
+  unsigned long           hist[ADS_LANE_MAX][ADS_LANE_HIST_BINS];
+  double                  maxWaitUs[ADS_LANE_MAX];
+}adsPriorityLock;
+
+/* How new data of a parameter arrived (traffic statistics).*/
+typedef enum{
+  ADS_PATH_NOTIFICATION=0,    //ADS device notification
+  ADS_PATH_BULK=1,            //Bulk (sum) read
+  ADS_PATH_READ=2,            //Single read (first read, on-demand, chunked poll)
+  ADS_PATH_MAX
+} ADSPATH;
+
+/* Traffic statistics of a parameter. Updated from several threads without
+   locks (relaxed atomics), read by adsTopTalkers. */
+typedef struct adsParamStats{
+  std::atomic<uint64_t> updates;
+  std::atomic<uint64_t> bytes;
+  std::atomic<uint64_t> callbacks;
+  std::atomic<uint64_t> errors;
+  std::atomic<uint64_t> lastUs;         //Time of last update
+  std::atomic<uint64_t> lastIntervalUs; //Time between the last two updates
+  std::atomic<uint64_t> maxIntervalUs;  //Max time between updates
+  std::atomic<uint64_t> path[ADS_PATH_MAX];
+}adsParamStats;
+
+class adsAsynPortDriver;
+struct adsParamInfo;
+struct adsParamHot;
+
+/* Conversion kernels. Selected once per parameter when the PLC data type is
+   known (see adsAsynPortDriver::selectConversionKernels()).*/
+typedef asynStatus (*adsUpdateKernel)(adsAsynPortDriver *driver,
+                                      struct adsParamHot *hot,
+                                      const void *data);
+typedef asynStatus (*adsCallbackKernel)(adsAsynPortDriver *driver,
+                                        struct adsParamHot *hot,
+                                        size_t nBytes);
+typedef uint32_t (*adsWriteKernel)(const void *epicsValue,void *plcBuffer);
+typedef void (*adsArrayConvertKernel)(const void *src,void *dst,size_t nElements);
+
+/* Triple buffered array store (data in EPICS representation). The writer
+   fills the back buffer and publishes it by swapping index with "ready".
+   Readers pick up the latest published buffer by swapping it with their
+   front buffer, so data is never copied between the buffers and writers
+   never wait for readers.*/
+#define ADS_ARRAY_STORE_DIRTY 0x4
+typedef struct adsArrayStore{
+  size_t           size;        //bytes per buffer
+  void             *buffer[3];
+  size_t           bytesUsed[3];
+  int              back;        //writer only (writeMutex)
+  int              front;       //readers only (readMutex)
+  std::atomic<int> ready;       //latest published index | ADS_ARRAY_STORE_DIRTY
+  std::mutex       writeMutex;
+  std::mutex       readMutex;
+  unsigned long    publishCount;
+}adsArrayStore;
+
+/* Parameter data used for every update (notification, bulk read, read).
+   Kept in one array in the driver indexed by paramIndex so that updates
+   only touch this (and not the strings and settings in adsParamInfo).*/
+typedef struct adsParamHot{
+  int               paramIndex;
+  int               asynAddr;
+  uint32_t          plcSize;
+  ADSTIMESOURCE     timeBase;
+  size_t            lastCallbackSize;
+  adsUpdateKernel   updateKernel;        //PLC data -> asyn parameter
+  adsCallbackKernel callbackKernel;      //Asyn callbacks (scalar or array)
+  adsArrayStore     *arrayStore;
+  uint64_t          plcTimeStampRaw;
+  uint64_t          plcTimeStampConverted;  //plcTimeStampRaw that plcTimeStamp was converted from
+  epicsTimeStamp    plcTimeStamp;
+  epicsTimeStamp    epicsTimestamp;
+  int               alarmStatus;
+  int               alarmSeverity;
+  bool              plcDataIsArray;
+  adsParamStats     *stats;
+  struct adsParamInfo *info;             //Settings and metadata
+  struct adsParamHot *nextShared;        //Next parameter fed by this subscription (see adsShareSubscription())
+}adsParamHot;
+
 typedef struct adsParamInfo{
+  adsParamHot    *hot;           //Data used for every update (see adsParamHot)
   char           *recordName;
   char           *recordType;
   char           *scan;
@@ -82,31 +215,79 @@ typedef struct adsParamInfo{
   char           *plcAdrStr;
   uint32_t       plcAbsAdrGroup;
   uint32_t       plcAbsAdrOffset;
-  uint32_t       plcSize;
   uint32_t       plcDataType;
   bool           plcDataTypeWarn;
-  bool           plcDataIsArray;
   uint32_t       hCallbackNotify;
   bool           bCallbackNotifyValid;
   uint32_t       hSymbolicHandle;
   bool           bSymbolicHandleValid;
-  size_t         lastCallbackSize;
-  size_t         arrayDataBufferSize;
-  void*          arrayDataBuffer;
   bool           refreshNeeded;  //Communication broken update handles and callbacks
+  bool           symInfoPrefetched;   //Symbol info already read in a batch (refreshParams())
+  bool           symHandlePrefetched; //Symbol handle already created in a batch (refreshParams())
+  bool           symbolMissing;       //Symbol not found in PLC (does not block recovery of the ams port)
   ADSDATASOURCE  dataSource;          //Variable in PLC or in driver (not in PLC)
-  //timing
-  ADSTIMESOURCE  timeBase;
-  uint64_t       plcTimeStampRaw;
-  epicsTimeStamp plcTimeStamp;
-  epicsTimeStamp epicsTimestamp;
-  int            alarmStatus;
-  int            alarmSeverity;
   bool           firstReadDone;
   int            bulkIndex;
   int            bulkOffset;
+  int            sharedLeader;   //Parameter holding the subscription of the same PLC variable (-1 if none)
+  int64_t        sharedNextNs;   //Follower: next update allowed by sampleTimeMS (see adsUpdateFollowers())
+  uint8_t        *sharedPending;          //Follower: last data held back by sampleTimeMS
+  size_t         sharedPendingSize;       //Bytes in sharedPending (0 if nothing pending)
+  size_t         sharedPendingCapacity;
+  ADSPATH        sharedPendingPath;
+  uint64_t       sharedPendingTimeRaw;
+  uint64_t       sharedPendingTimeConverted;
+  epicsTimeStamp sharedPendingTime;
+  //chunked transfer (arrays larger than chunk size)
+  bool           isChunkedPoll;
+  uint64_t       chunkedPollLastUs;
+  uint32_t       chunksTotal;
+  uint32_t       chunksDone;
+  //write-behind (latest value wins, protected by writeBehindMutex_)
+  bool           isWriteBehind;
+  bool           writeBehindPending;
+  uint32_t       writeBehindGroup;
+  uint32_t       writeBehindOffset;
+  uint32_t       writeBehindSize;
+  uint32_t       writeBehindBufferSize;
+  uint8_t        *writeBehindBuffer;
+  unsigned long  writeBehindSent;
+  unsigned long  writeBehindCollapsed;
+  unsigned long  writeBehindFailed;
+  //conversion
+  adsWriteKernel  writeInt32Kernel;    //epicsInt32 -> PLC data
+  adsWriteKernel  writeFloat64Kernel;  //epicsFloat64 -> PLC data
+  long           arrayEpicsType;       //ADS type of EPICS array elements
+  size_t         plcElementSize;
+  adsArrayConvertKernel arrayReadKernel;   //PLC array -> EPICS array (NULL if same type)
+  adsArrayConvertKernel arrayWriteKernel;  //EPICS array -> PLC array (NULL if same type)
+  size_t         arrayConvBufferSize;
+  void*          arrayConvBuffer;      //Preallocated for write conversions
 }adsParamInfo;
 
+/* Queued write (write coalescing). Sent with other queued writes to the
+   same ams port in one ADSIGRP_SUMUP_WRITE request.*/
+typedef struct {
+  int      paramIndex;
+  uint16_t amsPort;
+  uint32_t group;
+  uint32_t offset;
+  uint32_t size;
+  uint8_t  *data;
+} adsWriteQueueEntry;
+
+/* One sub request of an ADSIGRP_SUMUP_READWRITE request.*/
+typedef struct {
+  uint32_t   group;
+  uint32_t   offset;
+  uint32_t   readLen;
+  uint32_t   writeLen;
+  const void *writeData;
+  void       *readData;
+  uint32_t   bytesRead;
+  long       error;
+} adsSumRequest;
+
 typedef struct amsPortInfo{
   uint16_t amsPort;
   int connectedOld;
@@ -120,8 +301,61 @@ typedef struct amsPortInfo{
   uint32_t      hCallbackNotify;
   bool          bCallbackNotifyValid;
   bool          refreshNeeded;  //Communication broken update handles and callbacks
+  //recovery after link loss
+  bool          recovering;         //Disconnected, params not yet refreshed
+  bool          targetPortLost;     //GLOBALERR_TARGET_PORT during refresh, retry next cycle
+  uint64_t      disconnectTimeUs;
+  uint64_t      lastRecoveryUs;     //Disconnect until all params refreshed
+  uint64_t      lastAlarmUs;        //Duration of last alarm update of all params (setAlarmPort())
+  uint32_t      disconnectCount;
+  uint32_t      recoveryCount;
+  uint32_t      fastRecoveryCount;  //Recoveries without re-resolving symbols
+  uint8_t       symVersion;         //ADSIGRP_SYM_VERSION when params were last resolved
+  uint32_t      symCount;           //ADSIGRP_SYM_UPLOADINFO when params were last resolved
+  uint32_t      symSize;
+  bool          symVersionValid;
+  int           symbolCacheState;   //0=not checked, 1=symbol cache valid, -1=stale
+  //ads state notification (ADSIGRP_DEVICE_DATA)
+  uint32_t      hStateNotify;
+  bool          bStateNotifyValid;
+  volatile int  adsStateNotified;   //Last state from notification
 }amsPortInfo;
 
+/* Symbol cache file (adsSetSymbolCache()). Layout:
+   adsSymbolCacheHeader, portCount*adsSymbolCachePort,
+   entryCount*adsSymbolCacheEntry, symbol names (not null terminated).
+   All fields in host byte order, file is mapped with mmap().*/
+#define ADS_SYMBOL_CACHE_MAGIC   0x43534441  //"ADSC"
+#define ADS_SYMBOL_CACHE_FORMAT  2
+
+typedef struct {
+  uint32_t magic;
+  uint32_t format;
+  uint8_t  netId[6];
+  uint16_t portCount;
+  uint32_t entryCount;
+} adsSymbolCacheHeader;
+
+/* Cache of an ams port is valid if symbol version and symbol upload info
+   (ADSIGRP_SYM_UPLOADINFO) are the same.*/
+typedef struct {
+  uint16_t amsPort;
+  uint8_t  symVersion;
+  uint8_t  reserved;
+  uint32_t symCount;
+  uint32_t symSize;
+} adsSymbolCachePort;
+
+typedef struct {
+  uint32_t nameOffset;  //From start of file
+  uint16_t nameLength;
+  uint16_t amsPort;
+  uint32_t group;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t dataType;
+} adsSymbolCacheEntry;
+
 //For info from symbolic name Actually this data type should be in the adslib (but missing)..
 typedef struct {
   uint32_t entryLen;
@@ -160,6 +394,12 @@ typedef enum{
 } ADSDATATYPEID;
 
 const char *adsErrorToString(long error);
+const char *adsLaneToString(int lane);
+void adsParamStatsUpdate(adsParamStats *stats,ADSPATH path,size_t bytes,uint64_t nowUs);
+void adsParamStatsReset(adsParamStats *stats);
+void adsPriorityLockInit(adsPriorityLock *lock);
+void adsPriorityLockAcquire(adsPriorityLock *lock,ADSLANE lane);
+void adsPriorityLockRelease(adsPriorityLock *lock);
 const char *adsTypeToString(long type);
 const char *asynTypeToString(long type);
 const char *adsStateToString(long state);
@@ -167,6 +407,16 @@ const char *epicsStateToString(int state);
 size_t adsTypeSize(long type);
 asynParamType dtypStringToAsynType(char *dtype);
 int windowsToEpicsTimeStamp(uint64_t plcTime, epicsTimeStamp *ts);
+void adsSetParamPlcTime(adsParamHot *hot,uint64_t plcTime,const epicsTimeStamp *ts);
+long asynArrayTypeToAdsType(long asynType);
+bool adsArrayTypesIdentical(long plcType,long epicsType);
+adsArrayConvertKernel adsGetArrayConvertKernel(long fromType,long toType);
+adsArrayStore *adsArrayStoreCreate(size_t size);
+void adsArrayStoreDestroy(adsArrayStore *store);
+void *adsArrayStoreWriteLock(adsArrayStore *store);
+void adsArrayStoreWriteUnlock(adsArrayStore *store,size_t bytesUsed);
+const void *adsArrayStoreReadLock(adsArrayStore *store,size_t *bytesUsed);
+void adsArrayStoreReadUnlock(adsArrayStore *store);
 
 
 /**
@@ -184,13 +434,38 @@ int windowsToEpicsTimeStamp(uint64_t plcTime, epicsTimeStamp *ts);
   }                                               \
   while(0)
 
+/* Ring buffer for octet replies. Data is stored from readPos and wraps at
+   bufferSize. The buffer grows on demand up to maxSize.*/
 typedef struct {
   size_t   bufferSize;
+  size_t   maxSize;
   size_t   bytesUsed;
-  char  buffer[ADS_CMD_BUFFER_SIZE];
+  size_t   readPos;
+  bool     overflow;
+  char     *buffer;
 } adsOctetOutputBufferType;
+/* Octet session. Each asyn client (asynUser) gets its own reply and binary
+   buffers so commands from different clients are never mixed.*/
+#define ADS_OCTET_MAX_SESSIONS 128
+typedef struct {
+  const void               *owner;
+  adsOctetOutputBufferType asciiBuffer;
+  uint8_t                  *binaryBuffer;
+  size_t                   binaryBufferSize;
+  int                      returnVarName;  //prefix replies with variable name
+  int                      inUse;
+  unsigned long            lastUsed;
+} adsOctetSession;
+
+int octetInitBuffer(adsOctetOutputBufferType *buffer,
+                    size_t size,
+                    size_t maxSize);
+void octetFreeBuffer(adsOctetOutputBufferType *buffer);
 int octetCmdBuf_printf(adsOctetOutputBufferType *buffer,
                    const char *format, ...);
+size_t octetReadFromBuffer(adsOctetOutputBufferType *buffer,
+                           char *outBuffer,
+                           size_t len);
 int octetRemoveFromBuffer(adsOctetOutputBufferType *buffer,
                      size_t len);
 int octetClearBuffer(adsOctetOutputBufferType *buffer);
@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+#    This file is part of epics-twincat-ads.
+#
+#    epics-twincat-ads is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+#
+#    epics-twincat-ads is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+#
+#    You should have received a copy of the GNU Lesser General Public License along with epics-twincat-ads. If not, see <https://www.gnu.org/licenses/>.
+#
+# Generate a database with many records on one ads port to measure startup
+# (drvUserCreate) time. The PLC does not need to have the variables: when
+# not connected, parameters are created and resolved later.
+#
+# Usage: tools/genStartupBenchDb.sh <records> [port] >bench.db
+# Then in the startup script (parameter table size >= records+1):
+#   dbLoadRecords("bench.db","P=BENCH:")
+#   iocInit
+# drvUserCreate prints the elapsed time every 1000 parameters, and the part
+# of it spent in asyn createParam() (duplicate name scan, quadratic in the
+# number of parameters).
+
+count=${1:-50000}
+port=${2:-ADS_1}
+
+i=0
+while test $i -lt $count; do
+  cat <<EOT
+record(ai,"\$(P)Var$i"){
+  field(DTYP, "asynFloat64")
+  field(INP,  "@asyn($port,0,1)ADSPORT=851/Main.aBench[$i]?")
+  field(SCAN, "I/O Intr")
+}
+EOT
+  i=$((i+1))
+done